@@ -0,0 +1,1135 @@
+// CMSC 341 - Fall 2025 - Project 3
+// Benchmark harness for the Region and Irrigator hot paths, built with
+// optimization by "make bench". Every measurement is one CSV line or one
+// JSON object per line, so runs can be diffed and tracked for regressions.
+//
+//   ./bench [--format csv|json] [--min-size N] [--max-size N]
+//           [--dist uniform|normal] [--out file] [--only name]
+#include "irrigator.h"
+#include "journal.h"
+#include "sharded.h"
+#include "relaxed.h"
+#include "cropexporter.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <algorithm>
+#include <atomic>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// ------------------------------
+// Random class copied for benchmarking
+// ------------------------------
+enum RANDOM {UNIFORMINT, UNIFORMREAL, NORMAL, SHUFFLE};
+class Random {
+public:
+    Random(){}
+    Random(int min, int max, RANDOM type=UNIFORMINT, int mean=50, int stdev=20) : m_min(min), m_max(max), m_type(type)
+    {
+        if (type == NORMAL){
+            //the case of NORMAL to generate integer numbers with normal distribution
+            m_generator = mt19937(m_device());
+            //the data set will have the mean of 50 (default) and standard deviation of 20 (default)
+            //the mean and standard deviation can change by passing new values to constructor
+            m_normdist = normal_distribution<>(mean,stdev);
+        }
+        else if (type == UNIFORMINT) {
+            //the case of UNIFORMINT to generate integer numbers
+            // Using a fixed seed value generates always the same sequence
+            // of pseudorandom numbers, e.g. reproducing scientific experiments
+            // here it helps us with testing since the same sequence repeats
+            m_generator = mt19937(10);  // 10 is the fixed seed value
+            m_unidist = uniform_int_distribution<>(min,max);
+        }
+        else if (type == UNIFORMREAL) { //the case of UNIFORMREAL to generate real numbers
+            m_generator = mt19937(10);  // 10 is the fixed seed value
+            m_uniReal = uniform_real_distribution<double>((double)min,(double)max);
+        }
+        else {  //the case of SHUFFLE to generate every number only once
+            m_generator = mt19937(m_device());
+        }
+    }
+    void setSeed(int seedNum){
+        // we have set a default value for seed in constructor
+        // we can change the seed by calling this function after constructor call
+        // this gives us more randomness
+        m_generator = mt19937(seedNum);
+    }
+    int getRandNum(){
+        // this function returns integer numbers
+        // the object must have been initialized to generate integers
+        int result = 0;
+        if(m_type == NORMAL){
+            //returns a random number in a set with normal distribution
+            //we limit random numbers by the min and max values
+            result = m_min - 1;
+            while(result < m_min || result > m_max)
+                result = m_normdist(m_generator);
+        }
+        else if (m_type == UNIFORMINT){
+            //this will generate a random number between min and max values
+            result = m_unidist(m_generator);
+        }
+        return result;
+    }
+    int getMin(){return m_min;}
+    int getMax(){return m_max;}
+private:
+    int m_min;
+    int m_max;
+    RANDOM m_type;
+    random_device m_device;
+    mt19937 m_generator;
+    normal_distribution<> m_normdist; //normal distribution
+    uniform_int_distribution<> m_unidist; //integer uniform distribution
+    uniform_real_distribution<double> m_uniReal; //real uniform distribution
+};
+
+// ------------------------------
+// Priority functions
+// ------------------------------
+int priorityFn1(const Crop &crop);// works with a MAXHEAP
+int priorityFn2(const Crop &crop);// works with a MINHEAP
+
+// ------------------------------
+// Heap accounting, every allocation carries its size in a header so the
+// bytes still allocated can be reported; the shard workers allocate too
+// ------------------------------
+static atomic<long long> s_liveBytes(0);
+static const size_t ALLOCHEADER = 16;   // keeps the returned block 16-byte aligned
+
+void* operator new(size_t bytes){
+    char* block = static_cast<char*>(malloc(bytes + ALLOCHEADER));
+    if (block == nullptr) throw bad_alloc();
+    *reinterpret_cast<size_t*>(block) = bytes;
+    s_liveBytes += bytes;
+    return block + ALLOCHEADER;
+}
+
+void operator delete(void* ptr) noexcept{
+    if (ptr == nullptr) return;
+    // integer arithmetic, the header lies before the block the compiler knows about
+    char* block = reinterpret_cast<char*>(reinterpret_cast<uintptr_t>(ptr) - ALLOCHEADER);
+    s_liveBytes -= *reinterpret_cast<size_t*>(block);
+    free(block);
+}
+
+void* operator new[](size_t bytes){
+    return operator new(bytes);
+}
+
+void operator delete[](void* ptr) noexcept{
+    operator delete(ptr);
+}
+
+// ------------------------------
+// Options and result output
+// ------------------------------
+struct Options {
+    bool json = false;
+    int minSize = 1000;
+    int maxSize = 100000;     // --max-size 10000000 for the full range
+    RANDOM dist = UNIFORMINT;
+    FILE* out = stdout;
+    const char* only = nullptr;
+};
+static Options s_options;
+
+// one result line, the time is reported in total and per operation,
+// bytes is the heap memory the benchmark keeps (0 when not measured)
+static void report(const char* benchmark, const char* structure, const char* heapType,
+                   int size, long long ops, double ms, long long bytes = 0){
+    double nsPerOp = (ops > 0) ? ms * 1e6 / ops : 0.0;
+    if (s_options.json){
+        fprintf(s_options.out, "{\"benchmark\":\"%s\",\"structure\":\"%s\",\"heaptype\":\"%s\","
+                "\"size\":%d,\"ops\":%lld,\"total_ms\":%.3f,\"ns_per_op\":%.1f,\"bytes\":%lld}\n",
+                benchmark, structure, heapType, size, ops, ms, nsPerOp, bytes);
+    }
+    else {
+        fprintf(s_options.out, "%s,%s,%s,%d,%lld,%.3f,%.1f,%lld\n",
+                benchmark, structure, heapType, size, ops, ms, nsPerOp, bytes);
+    }
+    fflush(s_options.out);
+}
+
+static bool selected(const char* group){
+    return s_options.only == nullptr || strcmp(s_options.only, group) == 0;
+}
+
+static const char* structureName(STRUCTURE structure){
+    return structure == SKEW ? "SKEW" : structure == MINMAX ? "MINMAX" : "LEFTIST";
+}
+
+static const char* heapTypeName(HEAPTYPE heapType){
+    return heapType == MINHEAP ? "MINHEAP" : "MAXHEAP";
+}
+
+// ------------------------------
+// Timing and input generation
+// ------------------------------
+typedef chrono::steady_clock Clock;
+
+// milliseconds since the given start
+static double elapsedMs(Clock::time_point start){
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+// crops with varied fields, generated up front so only the heap work is timed
+static vector<Crop> makeCrops(int count, int seed){
+    Random idGen(MINCROPID, MAXCROPID);
+    Random temperatureGen(MINTEMP, MAXTEMP, s_options.dist, 70, 15);
+    Random moistureGen(MINMOISTURE, MAXMOISTURE, s_options.dist);
+    Random timeGen(MINTIME, MAXTIME);
+    Random typeGen(MINTYPE, MAXTYPE);
+    idGen.setSeed(seed);
+    temperatureGen.setSeed(seed+1);
+    moistureGen.setSeed(seed+2);
+    timeGen.setSeed(seed+3);
+    typeGen.setSeed(seed+4);
+
+    vector<Crop> crops;
+    crops.reserve(count);
+    for (int i = 0; i < count; i++){
+        crops.push_back(Crop(idGen.getRandNum(), temperatureGen.getRandNum(),
+                             moistureGen.getRandNum(), timeGen.getRandNum(), typeGen.getRandNum()));
+    }
+    return crops;
+}
+
+static prifn_t fnFor(HEAPTYPE heapType){
+    return heapType == MINHEAP ? priorityFn2 : priorityFn1;
+}
+
+static void fill(Region& region, const vector<Crop>& crops){
+    for (size_t i = 0; i < crops.size(); i++){
+        region.insertCrop(crops[i]);
+    }
+}
+
+// ------------------------------
+// Region benchmarks
+// ------------------------------
+static void benchRegion(STRUCTURE structure, HEAPTYPE heapType, int size){
+    const char* st = structureName(structure);
+    const char* ht = heapTypeName(heapType);
+    prifn_t fn = fnFor(heapType);
+    vector<Crop> crops = makeCrops(size, 100);
+    Region region(fn, heapType, structure, 1);
+
+    Clock::time_point start = Clock::now();
+    fill(region, crops);
+    report("insertCrop", st, ht, size, size, elapsedMs(start));
+
+    start = Clock::now();
+    Region bulk(fn, heapType, structure, 1);
+    bulk.insertCrops(crops.data(), size);
+    report("insertCrops", st, ht, size, size, elapsedMs(start));
+
+    start = Clock::now();
+    Region copy(region);
+    report("copyConstructor", st, ht, size, 1, elapsedMs(start));
+
+    // the other heap type and back, so the region ends as it started
+    HEAPTYPE flipped = (heapType == MINHEAP) ? MAXHEAP : MINHEAP;
+    start = Clock::now();
+    copy.setPriorityFn(fnFor(flipped), flipped);
+    report("setPriorityFn", st, ht, size, 1, elapsedMs(start));
+
+    start = Clock::now();
+    copy.setStructure(structure == SKEW ? LEFTIST : SKEW);
+    report("setStructure", st, ht, size, 1, elapsedMs(start));
+
+    // merge two halves
+    Region left(fn, heapType, structure, 1);
+    Region right(fn, heapType, structure, 2);
+    vector<Crop> other = makeCrops(size, 200);
+    fill(left, crops);
+    fill(right, other);
+    start = Clock::now();
+    left.mergeWithQueue(right);
+    report("mergeWithQueue", st, ht, size, 1, elapsedMs(start));
+
+    // one valve group drained from a BYTYPE copy
+    Region byType(bulk);
+    byType.setPartition(BYTYPE);
+    vector<Crop> typed(size);
+    start = Clock::now();
+    int popped = byType.getNextCrops(CITRUS, size, typed.data());
+    report("getNextCrops-type", st, ht, size, popped, elapsedMs(start));
+
+    start = Clock::now();
+    long long pops = 0;
+    while (region.numCrops() > 0){
+        region.getNextCrop();
+        pops++;
+    }
+    report("getNextCrop", st, ht, size, pops, elapsedMs(start));
+}
+
+// ------------------------------
+// The region heap before the entry/slot split, as a baseline: whole Regions
+// in a binary heap by regPrior (STRICT), every sift step swaps two of them
+// through copies, getCrop takes the root region out and puts it back
+// ------------------------------
+class RegionObjectHeap {
+public:
+    struct Entry {
+        Region region;
+        int regPrior;
+    };
+    explicit RegionObjectHeap(int capacity) : m_heap(capacity + 1), m_size(0) {}
+    void push(const Entry& entry){
+        m_heap[++m_size] = entry;
+        for (int i = m_size; i > 1 && m_heap[i].regPrior < m_heap[i / 2].regPrior; i /= 2){
+            swapEntries(i, i / 2);
+        }
+    }
+    bool pop(Entry& entry){
+        if (m_size == 0) return false;
+        entry = m_heap[1];
+        m_heap[1] = m_heap[m_size--];
+        siftDown(1);
+        return true;
+    }
+    // the n-th region by regPrior, the n-1 before it are put back
+    bool popNth(Entry& entry, int n){
+        if (n <= 0 || n > m_size) return false;
+        vector<Entry> taken(n);
+        for (int i = 0; i < n; i++) pop(taken[i]);
+        entry = taken[n - 1];
+        for (int i = 0; i < n - 1; i++) push(taken[i]);
+        return true;
+    }
+    bool popCrop(Crop& crop){
+        Entry top;
+        while (pop(top)){
+            if (!top.region.popNextCrop(crop)) continue;
+            if (top.region.numCrops() > 0) push(top);
+            return true;
+        }
+        return false;
+    }
+private:
+    vector<Entry> m_heap;   // index 1 is the root
+    int m_size;
+    void swapEntries(int a, int b){
+        Entry temp(m_heap[a]);
+        m_heap[a] = m_heap[b];
+        m_heap[b] = temp;
+    }
+    void siftDown(int index){
+        while (true){
+            int smallest = index, left = 2 * index, right = left + 1;
+            if (left <= m_size && m_heap[left].regPrior < m_heap[smallest].regPrior) smallest = left;
+            if (right <= m_size && m_heap[right].regPrior < m_heap[smallest].regPrior) smallest = right;
+            if (smallest == index) return;
+            swapEntries(index, smallest);
+            index = smallest;
+        }
+    }
+};
+
+// ------------------------------
+// Irrigator benchmarks, size is the number of regions; the -objects lines
+// time the same calls on the RegionObjectHeap baseline
+// ------------------------------
+static void benchIrrigator(STRUCTURE structure, HEAPTYPE heapType, int size){
+    const int cropsPerRegion = 4;
+    const char* st = structureName(structure);
+    const char* ht = heapTypeName(heapType);
+    prifn_t fn = fnFor(heapType);
+    vector<Crop> crops = makeCrops(size * cropsPerRegion, 300);
+    Random regionGen(1, size * 10);
+
+    vector<Region> regions;
+    vector<int> priors(size);
+    regions.reserve(size);
+    for (int i = 0; i < size; i++){
+        priors[i] = regionGen.getRandNum();
+        regions.push_back(Region(fn, heapType, structure, priors[i]));
+        for (int j = 0; j < cropsPerRegion; j++){
+            regions[i].insertCrop(crops[i * cropsPerRegion + j]);
+        }
+    }
+
+    Irrigator irr(size + 1);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < size; i++){
+        irr.addRegion(regions[i]);
+    }
+    report("addRegion", st, ht, size, size, elapsedMs(start));
+
+    // getNthRegion removes n regions and puts n-1 back, so only a few are timed
+    const int nthCalls = 10;
+    Region out;
+    start = Clock::now();
+    for (int i = 0; i < nthCalls; i++){
+        irr.getNthRegion(out, size / 2 > 0 ? size / 2 : 1);
+        irr.addRegion(out);
+    }
+    report("getNthRegion", st, ht, size, nthCalls, elapsedMs(start));
+
+    start = Clock::now();
+    long long got = 0;
+    Crop crop;
+    while (irr.getCrop(crop)){
+        got++;
+    }
+    report("getCrop", st, ht, size, got, elapsedMs(start));
+
+    for (int i = 0; i < size; i++){
+        irr.addRegion(regions[i]);
+    }
+    start = Clock::now();
+    long long removed = 0;
+    while (irr.getRegion(out)){
+        removed++;
+    }
+    report("getRegion", st, ht, size, removed, elapsedMs(start));
+
+    // the entries are built beforehand, only the heap work is timed
+    vector<RegionObjectHeap::Entry> entries(size);
+    for (int i = 0; i < size; i++){
+        entries[i].region = regions[i];
+        entries[i].regPrior = priors[i];
+    }
+    RegionObjectHeap objects(size);
+    RegionObjectHeap::Entry entry;
+    start = Clock::now();
+    for (int i = 0; i < size; i++){
+        objects.push(entries[i]);
+    }
+    report("addRegion-objects", st, ht, size, size, elapsedMs(start));
+
+    start = Clock::now();
+    for (int i = 0; i < nthCalls; i++){
+        objects.popNth(entry, size / 2 > 0 ? size / 2 : 1);
+        objects.push(entry);
+    }
+    report("getNthRegion-objects", st, ht, size, nthCalls, elapsedMs(start));
+
+    start = Clock::now();
+    got = 0;
+    while (objects.popCrop(crop)){
+        got++;
+    }
+    report("getCrop-objects", st, ht, size, got, elapsedMs(start));
+
+    for (int i = 0; i < size; i++){
+        objects.push(entries[i]);
+    }
+    start = Clock::now();
+    removed = 0;
+    while (objects.pop(entry)){
+        removed++;
+    }
+    report("getRegion-objects", st, ht, size, removed, elapsedMs(start));
+}
+
+// ------------------------------
+// Crop order benchmark, moisture asc, temperature desc, crop ID asc as one
+// packed key against the same order as a comparator chain
+// ------------------------------
+struct ChainOrder {
+    // true if a comes after b, priority_queue keeps the largest on top
+    bool operator()(const Crop& a, const Crop& b) const {
+        if (a.getMoisture() != b.getMoisture()) return a.getMoisture() > b.getMoisture();
+        if (a.getTemperature() != b.getTemperature()) return a.getTemperature() < b.getTemperature();
+        return a.getCropID() > b.getCropID();
+    }
+};
+
+static void benchOrder(int size){
+    vector<Crop> crops = makeCrops(size, 800);
+    CropOrder order;
+    order.add(FIELDMOISTURE, ASCENDING);
+    order.add(FIELDTEMPERATURE, DESCENDING);
+    order.add(FIELDCROPID, ASCENDING);
+    const STRUCTURE structures[2] = {SKEW, LEFTIST};
+
+    // insert everything, then drain, the way the heaps are used
+    for (int s = 0; s < 2; s++){
+        Region region(priorityFn2, MINHEAP, structures[s], 1);
+        region.setOrder(order);
+        Clock::time_point start = Clock::now();
+        fill(region, crops);
+        while (region.numCrops() > 0){
+            region.getNextCrop();
+        }
+        report("order-region-packed", structureName(structures[s]), "MINHEAP", size, 2LL * size, elapsedMs(start));
+    }
+
+    Clock::time_point start = Clock::now();
+    priority_queue<Crop, vector<Crop>, ChainOrder> chain;
+    for (int i = 0; i < size; i++){
+        chain.push(crops[i]);
+    }
+    while (!chain.empty()){
+        chain.pop();
+    }
+    report("order-pq-chain", "BINARY", "MINHEAP", size, 2LL * size, elapsedMs(start));
+
+    start = Clock::now();
+    priority_queue<pair<long long, int>, vector<pair<long long, int> >,
+                   greater<pair<long long, int> > > packed;
+    for (int i = 0; i < size; i++){
+        packed.push(make_pair(order.key(crops[i]), i));
+    }
+    while (!packed.empty()){
+        packed.pop();
+    }
+    report("order-pq-packed", "BINARY", "MINHEAP", size, 2LL * size, elapsedMs(start));
+}
+
+// ------------------------------
+// Schedule benchmark, getCrop over SCHEDULEREGIONS regions under every schedule
+// ------------------------------
+#define SCHEDULEREGIONS 10000
+
+static void benchSchedule(){
+    const int cropsPerRegion = 4;
+    const SCHEDULE schedules[3] = {STRICT, GLOBAL, FAIRSHARE};
+    const char* addName[3] = {"addRegion-strict", "addRegion-global", "addRegion-fairshare"};
+    const char* cropName[3] = {"getCrop-strict", "getCrop-global", "getCrop-fairshare"};
+    vector<Crop> crops = makeCrops(SCHEDULEREGIONS * cropsPerRegion, 700);
+    Random regionGen(1, SCHEDULEREGIONS);
+
+    vector<Region> regions;
+    regions.reserve(SCHEDULEREGIONS);
+    for (int i = 0; i < SCHEDULEREGIONS; i++){
+        regions.push_back(Region(priorityFn2, MINHEAP, LEFTIST, regionGen.getRandNum()));
+        regions[i].insertCrops(crops.data() + i * cropsPerRegion, cropsPerRegion);
+    }
+
+    for (int m = 0; m < 3; m++){
+        Irrigator irr(SCHEDULEREGIONS + 1, schedules[m]);
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < SCHEDULEREGIONS; i++){
+            irr.addRegion(regions[i]);
+        }
+        report(addName[m], "LEFTIST", "MINHEAP", SCHEDULEREGIONS, SCHEDULEREGIONS, elapsedMs(start));
+
+        start = Clock::now();
+        long long got = 0;
+        Crop crop;
+        while (irr.getCrop(crop)){
+            got++;
+        }
+        report(cropName[m], "LEFTIST", "MINHEAP", SCHEDULEREGIONS, got, elapsedMs(start));
+    }
+}
+
+// ------------------------------
+// Layout benchmark, pops from a heap built by single inserts (its nodes are
+// scattered) against the same heap after compaction into one preorder run.
+// Two regions are filled in turn so neither gets its nodes back to back.
+// ------------------------------
+static void benchCompact(STRUCTURE structure, int size){
+    const char* st = structureName(structure);
+    vector<Crop> crops = makeCrops(size, 900);
+    Region scattered(priorityFn2, MINHEAP, structure, 1);
+    Region compacted(priorityFn2, MINHEAP, structure, 1);
+    for (int i = 0; i < size; i++){
+        scattered.insertCrop(crops[i]);
+        compacted.insertCrop(crops[i]);
+    }
+    int pops = size / 2;
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < pops; i++){
+        scattered.getNextCrop();
+    }
+    report("pop-scattered", st, "MINHEAP", size, pops, elapsedMs(start));
+
+    start = Clock::now();
+    compacted.compact();
+    report("compact", st, "MINHEAP", size, size, elapsedMs(start));
+
+    start = Clock::now();
+    for (int i = 0; i < pops; i++){
+        compacted.getNextCrop();
+    }
+    report("pop-compacted", st, "MINHEAP", size, pops, elapsedMs(start));
+}
+
+// ------------------------------
+// Rebuild benchmark, the one long setPriorityFn call against the same change
+// spread over budgeted calls: the longest single call is what a valve waits.
+// Half the crops move by rebuildStep, the first pop settles the rest.
+// ------------------------------
+#define REBUILDBUDGET 256
+
+static void benchRebuild(STRUCTURE structure, int size){
+    const char* st = structureName(structure);
+    vector<Crop> crops = makeCrops(size, 950);
+    Region full(priorityFn2, MINHEAP, structure, 1);
+    Region budgeted(priorityFn2, MINHEAP, structure, 1);
+    full.insertCrops(crops.data(), size);
+    budgeted.insertCrops(crops.data(), size);
+
+    Clock::time_point start = Clock::now();
+    full.setPriorityFn(priorityFn1, MAXHEAP);
+    report("rebuild-full", st, "MAXHEAP", size, size, elapsedMs(start));
+
+    budgeted.setRebuildBudget(REBUILDBUDGET);
+    start = Clock::now();
+    budgeted.setPriorityFn(priorityFn1, MAXHEAP);
+    double longest = elapsedMs(start);
+    long long steps = 0;
+    Clock::time_point first = Clock::now();
+    while (budgeted.numPending() > size / 2){
+        start = Clock::now();
+        budgeted.rebuildStep();
+        longest = max(longest, elapsedMs(start));
+        steps++;
+    }
+    report("rebuild-steps", st, "MAXHEAP", size, steps, elapsedMs(first));
+    report("rebuild-step-max", st, "MAXHEAP", size, 1, longest);
+
+    start = Clock::now();
+    budgeted.getNextCrop();
+    report("rebuild-settle", st, "MAXHEAP", size, 1, elapsedMs(start));
+}
+
+// ------------------------------
+// Conversion benchmark, setStructure and a MIN/MAX flip against re-merging
+// every crop into a new heap, which is what the conversions used to cost
+// ------------------------------
+static void benchConvert(int size){
+    vector<Crop> crops = makeCrops(size, 980);
+    Region region(priorityFn2, MINHEAP, SKEW, 1);
+    fill(region, crops);
+
+    // an empty CropOrder still takes the old way, one merge per node
+    Clock::time_point start = Clock::now();
+    region.setOrder(CropOrder());
+    report("convert-remerge", "SKEW", "MINHEAP", size, size, elapsedMs(start));
+
+    start = Clock::now();
+    region.setStructure(LEFTIST);
+    report("convert-to-leftist", "LEFTIST", "MINHEAP", size, size, elapsedMs(start));
+
+    start = Clock::now();
+    region.setStructure(SKEW);
+    report("convert-to-skew", "SKEW", "MINHEAP", size, size, elapsedMs(start));
+
+    start = Clock::now();
+    region.setPriorityFn(priorityFn2, MAXHEAP);
+    report("convert-flip", "SKEW", "MAXHEAP", size, size, elapsedMs(start));
+}
+
+// ------------------------------
+// Double-ended benchmark, both ends taken in turn: a MINHEAP and a MAXHEAP
+// copy of every crop with tombstones (the usual workaround) against
+// one MINMAX region
+// ------------------------------
+static void benchDoubleEnded(int size){
+    vector<Crop> crops = makeCrops(size, 995);
+    Clock::time_point start = Clock::now();
+    Region low(priorityFn2, MINHEAP, LEFTIST, 1);
+    Region high(priorityFn2, MAXHEAP, LEFTIST, 1);
+    low.insertCrops(crops.data(), size);
+    high.insertCrops(crops.data(), size);
+    // a crop taken from one end is skipped once at the other, IDs may repeat
+    unordered_map<int, int> skip[2];
+    Crop crop;
+    for (int i = 0; i < size; i++){
+        int end = i % 2;
+        while ((end == 0 ? low : high).popNextCrop(crop)){
+            unordered_map<int, int>::iterator tomb = skip[end].find(crop.getCropID());
+            if (tomb == skip[end].end()) break;
+            if (--tomb->second == 0) skip[end].erase(tomb);
+        }
+        skip[1 - end][crop.getCropID()]++;
+    }
+    report("double-mirrored", "LEFTIST", "MINHEAP", size, size, elapsedMs(start));
+
+    start = Clock::now();
+    Region both(priorityFn2, MINHEAP, MINMAX, 1);
+    both.insertCrops(crops.data(), size);
+    for (int i = 0; i < size; i++){
+        if (i % 2 == 0) both.popNextCrop(crop);
+        else crop = both.getLastCrop();
+    }
+    report("double-minmax", "MINMAX", "MINHEAP", size, size, elapsedMs(start));
+}
+
+// ------------------------------
+// Expiry benchmark, ten waves of deadlines with pops in between: draining
+// and reinserting the live crops at every wave (the usual workaround)
+// against Region::expire and its timer wheel
+// ------------------------------
+static void benchExpiry(int size){
+    vector<Crop> crops = makeCrops(size, 996);
+    for (int i = 0; i < size; i++){
+        crops[i].setDeadline(1000 * (1 + i % 10));
+    }
+    const int waves = 10;
+    int pops = size / (4 * waves);
+    Clock::time_point start = Clock::now();
+    Region scan(priorityFn2, MINHEAP, LEFTIST, 1);
+    scan.insertCrops(crops.data(), size);
+    vector<Crop> live;
+    live.reserve(size);
+    Crop crop;
+    for (int wave = 1; wave <= waves; wave++){
+        for (int i = 0; i < pops && scan.popNextCrop(crop); i++) {}
+        live.clear();
+        while (scan.popNextCrop(crop)){
+            if (crop.getDeadline() > 1000 * wave) live.push_back(crop);
+        }
+        scan.insertCrops(live.data(), (int)live.size());
+    }
+    report("expire-scan", "LEFTIST", "MINHEAP", size, size, elapsedMs(start));
+
+    start = Clock::now();
+    Region timed(priorityFn2, MINHEAP, LEFTIST, 1);
+    timed.insertCrops(crops.data(), size);
+    for (int wave = 1; wave <= waves; wave++){
+        for (int i = 0; i < pops && timed.popNextCrop(crop); i++) {}
+        timed.expire(1000 * wave);
+    }
+    report("expire-wheel", "LEFTIST", "MINHEAP", size, size, elapsedMs(start));
+}
+
+// ------------------------------
+// Aging benchmark, a standing backlog with AGINGINFLOW crops in and out every
+// tick: the usual workaround, a priority function that reads the clock and
+// AGINGREBUILDS calls of setPriorityFn spread over the run, each re-keying the
+// whole region, against Region::setAging where a tick only moves the clock.
+// The crop ID holds the insertion tick for the workaround.
+// ------------------------------
+const int AGINGINFLOW = 100;
+const int AGINGREBUILDS = 20;
+static int s_agingNow = 0;
+
+static int agedFn(const Crop &crop){
+    int age = s_agingNow - (crop.getCropID() - MINCROPID);
+    return max(1, priorityFn2(crop) - age);
+}
+// the same function under another address, setPriorityFn ignores an unchanged one
+static int agedFnCopy(const Crop &crop){
+    return agedFn(crop);
+}
+
+static void benchAging(int size){
+    vector<Crop> crops = makeCrops(size, 998);
+    int ticks = size / (2 * AGINGINFLOW);
+    int period = max(1, ticks / AGINGREBUILDS);
+    for (int i = 0; i < size; i++){
+        int tick = (i < size / 2) ? 0 : 1 + (i - size / 2) / AGINGINFLOW;
+        crops[i] = Crop(MINCROPID + tick, crops[i].getTemperature(), crops[i].getMoisture(),
+                        crops[i].getTime(), crops[i].getType());
+    }
+    Crop crop;
+    s_agingNow = 0;
+    Region rebuilt(agedFn, MINHEAP, LEFTIST, 1);
+    rebuilt.insertCrops(crops.data(), size / 2);
+    Clock::time_point start = Clock::now();
+    for (int tick = 1; tick <= ticks; tick++){
+        s_agingNow = tick;
+        if (tick % period == 0) rebuilt.setPriorityFn(tick % (2 * period) ? agedFnCopy : agedFn, MINHEAP);
+        rebuilt.insertCrops(crops.data() + size / 2 + (tick - 1) * AGINGINFLOW, AGINGINFLOW);
+        for (int i = 0; i < AGINGINFLOW; i++) rebuilt.popNextCrop(crop);
+    }
+    report("aging-rebuild", "LEFTIST", "MINHEAP", size, size, elapsedMs(start));
+
+    Region aged(priorityFn2, MINHEAP, LEFTIST, 1);
+    aged.setAging(1);
+    aged.insertCrops(crops.data(), size / 2);
+    start = Clock::now();
+    for (int tick = 1; tick <= ticks; tick++){
+        aged.expire(tick);
+        aged.insertCrops(crops.data() + size / 2 + (tick - 1) * AGINGINFLOW, AGINGINFLOW);
+        for (int i = 0; i < AGINGINFLOW; i++) aged.popNextCrop(crop);
+    }
+    report("aging-epoch", "LEFTIST", "MINHEAP", size, size, elapsedMs(start));
+}
+
+// ------------------------------
+// Irrigator merge benchmark, MERGEREGIONS regions holding size crops in all
+// join an irrigator of as many: moved one by one with getRegion and addRegion
+// (two deep copies each) against mergeWith and one heapify
+// ------------------------------
+const int MERGEREGIONS = 256;
+
+static void fillIrrigator(Irrigator& irr, const vector<Crop>& crops, int firstPrior){
+    int per = (int)crops.size() / MERGEREGIONS;
+    for (int r = 0; r < MERGEREGIONS; r++){
+        Region region(priorityFn2, MINHEAP, LEFTIST, firstPrior + r);
+        region.insertCrops(crops.data() + r * per, per);
+        irr.addRegion(region);
+    }
+}
+
+static void benchMerge(int size){
+    if (size < MERGEREGIONS) return;
+    vector<Crop> crops = makeCrops(size, 997);
+    Irrigator target(2 * MERGEREGIONS + 1, GLOBAL);
+    Irrigator source(2 * MERGEREGIONS + 1, GLOBAL);
+    fillIrrigator(target, crops, 1);
+    fillIrrigator(source, crops, MERGEREGIONS + 1);
+    Clock::time_point start = Clock::now();
+    Region region;
+    while (source.getRegion(region)){
+        target.addRegion(region);
+    }
+    report("merge-copy", "LEFTIST", "MINHEAP", size, size, elapsedMs(start));
+
+    Irrigator merged(2 * MERGEREGIONS + 1, GLOBAL);
+    fillIrrigator(merged, crops, 1);
+    fillIrrigator(source, crops, MERGEREGIONS + 1);
+    start = Clock::now();
+    merged.mergeWith(source);
+    report("merge-move", "LEFTIST", "MINHEAP", size, size, elapsedMs(start));
+}
+
+// ------------------------------
+// Export benchmark, an audit loop that pops every crop and writes it with
+// operator<< and endl against the buffered exporter, all into /dev/null
+// ------------------------------
+static void benchExport(int size){
+    vector<Crop> crops = makeCrops(size, 990);
+    Region region(priorityFn2, MINHEAP, LEFTIST, 1);
+    region.insertCrops(crops.data(), size);
+
+    ofstream lines("/dev/null");
+    Region copy(region);
+    Clock::time_point start = Clock::now();
+    Crop crop;
+    while (copy.popNextCrop(crop)){
+        lines << crop << endl;
+    }
+    report("export-endl", "LEFTIST", "MINHEAP", size, size, elapsedMs(start));
+
+    const RECORDFORMAT formats[3] = {CSVRECORD, JSONRECORD, BINARYRECORD};
+    const char* name[2][3] = {{"export-csv", "export-json", "export-binary"},
+                              {"export-sorted-csv", "export-sorted-json", "export-sorted-binary"}};
+    FILE* out = fopen("/dev/null", "wb");
+    if (out == nullptr) return;
+    for (int order = 0; order < 2; order++){
+        for (int f = 0; f < 3; f++){
+            CropExporter exporter(formats[f], order == 0 ? PREORDER : SORTEDORDER);
+            exporter.attach(out);
+            start = Clock::now();
+            exporter.writeRegion(region, 1);
+            exporter.flush();
+            report(name[order][f], "LEFTIST", "MINHEAP", size, size, elapsedMs(start), exporter.numBytes());
+        }
+    }
+    fclose(out);
+}
+
+// ------------------------------
+// Shard benchmark, SHARDREGIONS regions spread over 1 up to one shard per core.
+// Adding runs on the shard workers in parallel, getCrop merges all shards.
+// ------------------------------
+#define SHARDREGIONS 10000
+
+static void benchShards(){
+    const int cropsPerRegion = 8;
+    int cores = (int)thread::hardware_concurrency();
+    if (cores < 1) cores = 1;
+    vector<Crop> crops = makeCrops(SHARDREGIONS * cropsPerRegion, 800);
+    Random regionGen(1, SHARDREGIONS);
+
+    vector<Region> regions;
+    regions.reserve(SHARDREGIONS);
+    for (int i = 0; i < SHARDREGIONS; i++){
+        regions.push_back(Region(priorityFn2, MINHEAP, LEFTIST, regionGen.getRandNum()));
+        regions[i].insertCrops(crops.data() + i * cropsPerRegion, cropsPerRegion);
+    }
+
+    for (int shards = 1; shards <= cores; shards++){
+        char structure[32];
+        snprintf(structure, sizeof(structure), "%d-shards", shards);
+        ShardedIrrigator irr(shards, SHARDREGIONS / shards + 1, GLOBAL);
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < SHARDREGIONS; i++){
+            irr.addRegion(regions[i]);
+        }
+        irr.flush();
+        report("addRegion-sharded", structure, "MINHEAP", SHARDREGIONS, SHARDREGIONS, elapsedMs(start));
+
+        start = Clock::now();
+        long long got = 0;
+        Crop crop;
+        while (irr.getCrop(crop)){
+            got++;
+        }
+        report("getCrop-sharded", structure, "MINHEAP", SHARDREGIONS, got, elapsedMs(start));
+    }
+}
+
+// ------------------------------
+// Relaxed region benchmarks. Rank error: size crops of distinct priorities
+// are drained from one thread and every pop counts the better crops still
+// queued; a row gives the mean and the largest in place of the times. For
+// 1 up to all cores, 2 queues per thread. Throughput: the threads share size
+// operations, an insert and a pop in turn on a region prefilled with half of
+// size crops, against one Region behind one mutex.
+// ------------------------------
+static int idPriority(const Crop &crop){
+    return crop.getCropID() - DEFAULTCROPID;
+}
+
+static void reportRank(const char* structure, int size, double mean, int max){
+    if (s_options.json){
+        fprintf(s_options.out, "{\"benchmark\":\"relaxed-rank\",\"structure\":\"%s\",\"heaptype\":\"MINHEAP\","
+                "\"size\":%d,\"ops\":%d,\"mean_rank\":%.2f,\"max_rank\":%d}\n", structure, size, size, mean, max);
+    }
+    else {
+        fprintf(s_options.out, "relaxed-rank,%s,MINHEAP,%d,%d,%.2f,%d,0\n", structure, size, size, mean, max);
+    }
+    fflush(s_options.out);
+}
+
+static void benchRelaxed(int size){
+    int cores = (int)thread::hardware_concurrency();
+    if (cores < 1) cores = 1;
+    if (size > MAXCROPID - MINCROPID + 1) size = MAXCROPID - MINCROPID + 1;
+    vector<int> ids(size);
+    for (int i = 0; i < size; i++) ids[i] = MINCROPID + i;
+    shuffle(ids.begin(), ids.end(), mt19937(50));
+    char structure[32];
+    for (int threads = 1; ; threads = min(2 * threads, cores)){
+        RelaxedRegion relaxed(idPriority, MINHEAP, LEFTIST, threads);
+        for (int i = 0; i < size; i++) relaxed.insertCrop(Crop(ids[i], 70, 50, NOON, 0));
+        vector<int> tree(size + 1, 0);     // Fenwick tree of the crops still queued
+        for (int i = 1; i <= size; i++){
+            for (int k = i; k <= size; k += k & -k) tree[k]++;
+        }
+        long long total = 0;
+        int max = 0;
+        Crop crop;
+        while (relaxed.getNextCrop(crop)){
+            int pos = crop.getCropID() - MINCROPID + 1;
+            int better = 0;
+            for (int k = pos - 1; k > 0; k -= k & -k) better += tree[k];
+            for (int k = pos; k <= size; k += k & -k) tree[k]--;
+            total += better;
+            if (better > max) max = better;
+        }
+        snprintf(structure, sizeof(structure), "%d-queues", relaxed.numQueues());
+        reportRank(structure, size, (double)total / size, max);
+        if (threads == cores) break;    // powers of two, then all cores
+    }
+
+    vector<Crop> crops = makeCrops(size, 999);
+    for (int threads = 1; threads <= cores; threads++){
+        int perThread = size / threads;
+        snprintf(structure, sizeof(structure), "%d-threads", threads);
+
+        Region locked(priorityFn2, MINHEAP, LEFTIST, 1);
+        mutex lock;
+        locked.insertCrops(crops.data(), size / 2);
+        vector<thread> workers;
+        Clock::time_point start = Clock::now();
+        for (int t = 0; t < threads; t++){
+            workers.push_back(thread([&, t](){
+                Crop crop;
+                for (int i = 0; i < perThread; i += 2){
+                    lock.lock();
+                    locked.insertCrop(crops[(t * perThread + i) % size]);
+                    lock.unlock();
+                    lock.lock();
+                    locked.popNextCrop(crop);
+                    lock.unlock();
+                }
+            }));
+        }
+        for (int t = 0; t < threads; t++) workers[t].join();
+        report("locked-region", structure, "MINHEAP", size, (long long)perThread * threads, elapsedMs(start));
+
+        RelaxedRegion relaxed(priorityFn2, MINHEAP, LEFTIST, threads);
+        for (int i = 0; i < size / 2; i++) relaxed.insertCrop(crops[i]);
+        workers.clear();
+        start = Clock::now();
+        for (int t = 0; t < threads; t++){
+            workers.push_back(thread([&, t](){
+                Crop crop;
+                for (int i = 0; i < perThread; i += 2){
+                    relaxed.insertCrop(crops[(t * perThread + i) % size]);
+                    relaxed.getNextCrop(crop);
+                }
+            }));
+        }
+        for (int t = 0; t < threads; t++) workers[t].join();
+        report("relaxed-region", structure, "MINHEAP", size, (long long)perThread * threads, elapsedMs(start));
+    }
+}
+
+// ------------------------------
+// Persistent benchmarks, deep and shared copies of one region. Every
+// "what-if" version is a copy with one crop added and one removed; the
+// versions are kept alive, so bytes is the memory they hold together.
+// ------------------------------
+#define NUMVERSIONS 16
+
+static void benchPersistent(STRUCTURE structure, int size){
+    const char* st = structureName(structure);
+    vector<Crop> crops = makeCrops(size, 500);
+    vector<Crop> extra = makeCrops(NUMVERSIONS, 600);
+    const char* copyName[2] = {"copy-deep", "copy-persistent"};
+    const char* whatIfName[2] = {"whatif-deep", "whatif-persistent"};
+
+    for (int m = 0; m < 2; m++){
+        Region base(priorityFn2, MINHEAP, structure, 1);
+        base.setPersistent(m == 1);
+        base.insertCrops(crops.data(), size);
+
+        vector<Region*> versions;
+        long long before = s_liveBytes;
+        Clock::time_point start = Clock::now();
+        for (int v = 0; v < NUMVERSIONS; v++){
+            versions.push_back(new Region(base));
+        }
+        report(copyName[m], st, "MINHEAP", size, NUMVERSIONS, elapsedMs(start), s_liveBytes - before);
+
+        start = Clock::now();
+        for (int v = 0; v < NUMVERSIONS; v++){
+            versions[v]->insertCrop(extra[v]);
+            versions[v]->getNextCrop();
+        }
+        report(whatIfName[m], st, "MINHEAP", size, NUMVERSIONS, elapsedMs(start), s_liveBytes - before);
+
+        for (int v = 0; v < NUMVERSIONS; v++){
+            delete versions[v];
+        }
+    }
+}
+
+// ------------------------------
+// Journal benchmark, insert throughput with logging off and on
+// ------------------------------
+static void benchJournal(int size){
+    vector<Crop> crops = makeCrops(size, 400);
+    const char* logPath = "bench_journal.log";
+    const char* mode[3] = {"journal-off", "journal-group", "journal-fsync"};
+
+    for (int m = 0; m < 3; m++){
+        remove(logPath);
+        Journal journal;
+        Region region(priorityFn2, MINHEAP, LEFTIST, 1);
+        if (m > 0){
+            journal.open(logPath, DEFAULTGROUPBYTES, m == 2);
+            region.setJournal(&journal, 0);
+        }
+        Clock::time_point start = Clock::now();
+        fill(region, crops);
+        journal.commit();
+        report(mode[m], "LEFTIST", "MINHEAP", size, size, elapsedMs(start));
+        region.setJournal(nullptr, 0);
+    }
+    remove(logPath);
+}
+
+// ------------------------------
+// Main: parse options and run every size
+// ------------------------------
+static bool parseOptions(int argc, char** argv){
+    for (int i = 1; i < argc; i++){
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--format") == 0 && hasValue){
+            s_options.json = strcmp(argv[++i], "json") == 0;
+        }
+        else if (strcmp(argv[i], "--min-size") == 0 && hasValue){
+            s_options.minSize = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-size") == 0 && hasValue){
+            s_options.maxSize = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--dist") == 0 && hasValue){
+            s_options.dist = strcmp(argv[++i], "normal") == 0 ? NORMAL : UNIFORMINT;
+        }
+        else if (strcmp(argv[i], "--out") == 0 && hasValue){
+            s_options.out = fopen(argv[++i], "w");
+            if (s_options.out == nullptr) return false;
+        }
+        else if (strcmp(argv[i], "--only") == 0 && hasValue){
+            s_options.only = argv[++i];
+        }
+        else {
+            return false;
+        }
+    }
+    return s_options.minSize > 0 && s_options.maxSize >= s_options.minSize;
+}
+
+int main(int argc, char** argv){
+    if (!parseOptions(argc, argv)){
+        fprintf(stderr, "usage: %s [--format csv|json] [--min-size N] [--max-size N] "
+                "[--dist uniform|normal] [--out file] [--only region|irrigator|journal|persistent|order|schedule|shards|compact|rebuild|convert|export|double|expire|merge|aging|relaxed]\n", argv[0]);
+        return 1;
+    }
+    if (!s_options.json){
+        fprintf(s_options.out, "benchmark,structure,heaptype,size,ops,total_ms,ns_per_op,bytes\n");
+    }
+
+    const STRUCTURE structures[2] = {SKEW, LEFTIST};
+    const HEAPTYPE heapTypes[2] = {MINHEAP, MAXHEAP};
+    for (long long size = s_options.minSize; size <= s_options.maxSize; size *= 10){
+        for (int s = 0; s < 2; s++){
+            for (int h = 0; h < 2; h++){
+                if (selected("region")) benchRegion(structures[s], heapTypes[h], (int)size);
+                if (selected("irrigator")) benchIrrigator(structures[s], heapTypes[h], (int)size);
+            }
+        }
+        for (int s = 0; s < 2; s++){
+            if (selected("persistent")) benchPersistent(structures[s], (int)size);
+            if (selected("compact")) benchCompact(structures[s], (int)size);
+            if (selected("rebuild")) benchRebuild(structures[s], (int)size);
+        }
+        if (selected("order")) benchOrder((int)size);
+        if (selected("convert")) benchConvert((int)size);
+        if (selected("export")) benchExport((int)size);
+        if (selected("double")) benchDoubleEnded((int)size);
+        if (selected("expire")) benchExpiry((int)size);
+        if (selected("merge")) benchMerge((int)size);
+        if (selected("aging")) benchAging((int)size);
+        if (selected("relaxed")) benchRelaxed((int)size);
+        if (selected("journal")) benchJournal((int)size);
+    }
+    if (selected("schedule")) benchSchedule();
+    if (selected("shards")) benchShards();
+
+    if (s_options.out != stdout) fclose(s_options.out);
+    return 0;
+}
+
+int priorityFn1(const Crop &crop) {
+    //needs MAXHEAP
+    //priority value falls in the range [30-116]
+    //the larger value means the higher priority
+    int minValue = 30;
+    int maxValue = 116;
+    int priority = crop.getTemperature() + crop.getType();
+    if (priority >= minValue && priority <= maxValue)
+        return priority;
+    else
+        return 0; // this is an invalid order object
+}
+
+int priorityFn2(const Crop &crop) {
+    //needs MINHEAP
+    //priority value falls in the range [1-103]
+    //the smaller value means the higher priority
+    int minValue = 1;
+    int maxValue = 103;
+    int priority = crop.getMoisture() + crop.getTime();
+    if (priority >= minValue && priority <= maxValue)
+        return priority;
+    else
+        return 0; // this is an invalid order object
+}
@@ -0,0 +1,167 @@
+// CMSC 341 - Fall 2025 - Project 3
+#include "croparena.h"
+#include <cstring>
+#include <new>
+
+// constructor - no memory is taken until the first allocation or reserve
+CropArena::CropArena(int chunkNodes){
+  if (chunkNodes < 1) {
+    chunkNodes = 1;
+  }
+  m_chunkNodes = chunkNodes;
+  m_chunks = nullptr;
+  m_numChunks = 0;
+  m_chunkCapacity = 0;
+  m_free = nullptr;
+  m_next = nullptr;
+  m_end = nullptr;
+  m_live = 0;
+  m_capacity = 0;
+  m_runLeft = 0;
+  m_block = false;
+}
+
+// destructor - the chunks go back in one piece, nodes still in use are lost
+CropArena::~CropArena(){
+  for (int i = 0; i < m_numChunks; i++) {
+    delete[] m_chunks[i];
+  }
+  delete[] m_chunks;
+}
+
+// allocate - reuses a released node first, then the rest of the last chunk
+// (always the chunk while a run is reserved)
+Crop* CropArena::allocate(const Crop& crop){
+  Crop* node = new (takeSlot()) Crop(crop);
+  node->m_left = nullptr;
+  node->m_right = nullptr;
+  node->m_refs = 1;
+  node->m_arena = this;
+  return node;
+}
+
+// emplace - the crop is constructed in its slot, no copy is made
+Crop* CropArena::emplace(int ID, int temperature, int moisture, int time, int type){
+  Crop* node = new (takeSlot()) Crop(ID, temperature, moisture, time, type);
+  node->m_arena = this;
+  return node;
+}
+
+// release - puts the node on the free list
+void CropArena::release(Crop* node){
+  if (node == nullptr) {
+    return;
+  }
+  node->~Crop();
+  FreeSlot* slot = reinterpret_cast<FreeSlot*>(node);
+  slot->m_next = m_free;
+  m_free = slot;
+  m_live--;
+  if (m_block && m_live == 0) {
+    delete this;
+  }
+}
+
+// reserve - adds chunks until count more nodes fit
+void CropArena::reserve(long long count){
+  long long available = (m_end - m_next) / (long long)sizeof(Crop);
+  for (FreeSlot* slot = m_free; slot != nullptr && available < count; slot = slot->m_next) {
+    available++;
+  }
+  while (available < count) {
+    retireTail();
+    addChunk(m_chunkNodes);
+    available += m_chunkNodes;
+  }
+}
+
+// reserveRun - a run needs the tail of the last chunk or a chunk of its own,
+// a count of 0 ends the current run
+void CropArena::reserveRun(long long count){
+  if (count <= 0) {
+    m_runLeft = 0;
+    return;
+  }
+  if ((m_end - m_next) / (long long)sizeof(Crop) < count) {
+    retireTail();
+    addChunk(count > m_chunkNodes ? count : m_chunkNodes);
+  }
+  m_runLeft = count;
+}
+
+// createBlock - the arena lives as long as its nodes
+CropArena* CropArena::createBlock(long long count){
+  CropArena* block = new CropArena(1);
+  block->addChunk(count > 0 ? count : 1);
+  block->m_block = true;
+  return block;
+}
+
+long long CropArena::numLive() const {
+  return m_live;
+}
+
+long long CropArena::numChunks() const {
+  return m_numChunks;
+}
+
+long long CropArena::capacity() const {
+  return m_capacity;
+}
+
+/******************************************
+* Private function *
+******************************************/
+// takeSlot - a free node, from the free list unless a run is reserved
+void* CropArena::takeSlot(){
+  void* slot = nullptr;
+  if (m_free != nullptr && m_runLeft == 0) {
+    slot = m_free;
+    m_free = m_free->m_next;
+  }
+  else {
+    if (m_next == m_end) {
+      addChunk(m_chunkNodes);
+    }
+    slot = m_next;
+    m_next += sizeof(Crop);
+    if (m_runLeft > 0) {
+      m_runLeft--;
+    }
+  }
+  m_live++;
+  return slot;
+}
+
+// adds a chunk of the given number of nodes and makes it the one new nodes come from
+// the chunk is zeroed so its pages are touched by the calling thread now
+void CropArena::addChunk(long long nodes){
+  if (m_numChunks == m_chunkCapacity) {
+    int capacity = (m_chunkCapacity == 0) ? 8 : m_chunkCapacity * 2;
+    char** chunks = new char*[capacity];
+    for (int i = 0; i < m_numChunks; i++) {
+      chunks[i] = m_chunks[i];
+    }
+    delete[] m_chunks;
+    m_chunks = chunks;
+    m_chunkCapacity = capacity;
+  }
+
+  size_t bytes = (size_t)nodes * sizeof(Crop);
+  char* chunk = new char[bytes];
+  memset(chunk, 0, bytes);
+  m_chunks[m_numChunks++] = chunk;
+  m_next = chunk;
+  m_end = chunk + bytes;
+  m_capacity += nodes;
+}
+
+// the unused tail of the last chunk joins the free list before it is replaced
+void CropArena::retireTail(){
+  while (m_next != m_end) {
+    FreeSlot* slot = reinterpret_cast<FreeSlot*>(m_next);
+    slot->m_next = m_free;
+    m_free = slot;
+    m_next += sizeof(Crop);
+  }
+}
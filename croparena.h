@@ -0,0 +1,63 @@
+// CMSC 341 - Fall 2025 - Project 3
+// Node allocator for Regions. Crop nodes are carved out of large chunks and
+// recycled through a free list, so a region's nodes sit close together and
+// the chunks are placed in the memory of the thread that first touches them.
+#ifndef CROPARENA_H
+#define CROPARENA_H
+#include "irrigator.h"
+
+#define DEFAULTARENACHUNK 4096   // nodes per chunk
+
+class CropArena{
+    public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // for testing purposes
+    explicit CropArena(int chunkNodes = DEFAULTARENACHUNK);
+    // Releases every chunk. The arena must outlive the regions that use it.
+    ~CropArena();
+    CropArena(const CropArena& rhs) = delete;
+    CropArena& operator=(const CropArena& rhs) = delete;
+    // A node holding a copy of crop (its npl and key too), detached from any tree.
+    // Not thread-safe: one thread (or one lock holder) uses an arena at a time.
+    Crop* allocate(const Crop& crop);
+    // A node built from the crop fields like Crop(ID, temperature, moisture, time, type)
+    Crop* emplace(int ID, int temperature, int moisture, int time, int type);
+    void release(Crop* node);   // the node must come from this arena
+    // Makes sure the next count allocations need no new chunk. The chunks
+    // are written once, so their pages belong to the calling thread's node.
+    void reserve(long long count);
+    // The next count allocations take consecutive nodes of one chunk and
+    // skip the free list, so a tree copied in preorder lies in one run.
+    // 0 ends the run early.
+    void reserveRun(long long count);
+    // An arena of exactly one chunk of count nodes that deletes itself when
+    // its last allocated node is released. Nodes may outlive every region
+    // that allocated them this way, e.g. after mergeWithQueue.
+    static CropArena* createBlock(long long count);
+    long long numLive() const;      // nodes handed out and not released
+    long long numChunks() const;
+    long long capacity() const;     // nodes the chunks can hold
+
+    private:
+    // an unused slot links to the next one
+    struct FreeSlot{
+        FreeSlot* m_next;
+    };
+
+    char ** m_chunks;       // every chunk, for the destructor
+    int m_numChunks;
+    int m_chunkCapacity;    // size of m_chunks
+    int m_chunkNodes;       // nodes per chunk
+    FreeSlot* m_free;       // released nodes
+    char * m_next;          // next never used node of the last chunk
+    char * m_end;           // end of the last chunk
+    long long m_live;
+    long long m_capacity;   // nodes in all chunks
+    long long m_runLeft;    // allocations still to come from the reserved run
+    bool m_block;           // deletes itself when the last node is released
+
+    void* takeSlot();
+    void addChunk(long long nodes);
+    void retireTail();
+};
+#endif
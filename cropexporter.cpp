@@ -0,0 +1,333 @@
+// CMSC 341 - Fall 2025 - Project 3
+#include "cropexporter.h"
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+
+// names of the TIME windows and PLANT types with their lengths, indexed by value
+static const char* const TIMENAMES[MAXTIME + 1] = {"MORNING", "NOON", "AFTERNOON", "NIGHT"};
+static const int TIMELENGTHS[MAXTIME + 1] = {7, 4, 9, 5};
+static const char* const TYPENAMES[MAXTYPE + 1] = {"BEAN", "MELON", "MAIZE", "SUNFLOWER",
+                                                   "COTTON", "CITRUS", "SUGARCANE"};
+static const int TYPELENGTHS[MAXTYPE + 1] = {4, 5, 5, 9, 6, 6, 9};
+static const char CSVHEADER[] = "id,temperature,moisture,time,type,region\n";
+// the longest record: a JSON line with six 11-character numbers and the longest names
+const int MAXRECORDSIZE = 160;
+
+// constructor - allocates the buffer once, the sink is attached later
+CropExporter::CropExporter(RECORDFORMAT format, EXPORTORDER order, int bufferSize){
+  // the buffer has to hold at least a few records
+  if (bufferSize < 4 * MAXRECORDSIZE) {
+    bufferSize = 4 * MAXRECORDSIZE;
+  }
+  m_format = format;
+  m_order = order;
+  m_bufferSize = bufferSize;
+  m_buffer = new char[m_bufferSize];
+  m_used = 0;
+  m_file = nullptr;
+  m_fd = -1;
+  m_stream = nullptr;
+  m_header = false;
+  m_failed = false;
+  m_written = 0;
+  m_bytes = 0;
+  m_stack = nullptr;
+  m_frontier = nullptr;
+  m_capacity = 0;
+}
+
+CropExporter::~CropExporter(){
+  flush();
+  delete[] m_buffer;
+  delete[] m_stack;
+  delete[] m_frontier;
+}
+
+void CropExporter::attach(FILE* out){
+  flush();
+  m_file = out;
+  m_fd = -1;
+  m_stream = nullptr;
+  m_header = false;
+  m_failed = false;
+}
+
+void CropExporter::attach(int fd){
+  flush();
+  m_file = nullptr;
+  m_fd = fd;
+  m_stream = nullptr;
+  m_header = false;
+  m_failed = false;
+}
+
+void CropExporter::attach(ostream& out){
+  flush();
+  m_file = nullptr;
+  m_fd = -1;
+  m_stream = &out;
+  m_header = false;
+  m_failed = false;
+}
+
+// writeRegion - the heaps first, then the subtrees an incremental rebuild has not reached
+long long CropExporter::writeRegion(const Region& aRegion, int regionKey){
+  if (!attached()) {
+    return -1;
+  }
+  if (m_format == CSVRECORD && !m_header) {
+    room((int)sizeof(CSVHEADER));
+    writeText(CSVHEADER, (int)sizeof(CSVHEADER) - 1);
+    m_header = true;
+  }
+
+  long long before = m_written;
+  reserve(aRegion.m_size + 2);
+  if (m_order == SORTEDORDER) {
+    writeSorted(aRegion, regionKey);
+  }
+  else {
+    writePreorder(aRegion, regionKey);
+  }
+  return m_written - before;
+}
+
+long long CropExporter::writeIrrigator(const Irrigator& anIrrigator){
+  if (!attached()) {
+    return -1;
+  }
+  long long before = m_written;
+  for (int i = ROOTINDEX; i <= anIrrigator.m_size; i++) {
+    writeRegion(anIrrigator.regionAt(i), anIrrigator.regionAt(i).m_regPrior);
+  }
+  return m_written - before;
+}
+
+// flush - one write for the whole buffer (a few for a descriptor that takes less)
+bool CropExporter::flush(){
+  if (m_used > 0 && attached()) {
+    if (m_file != nullptr) {
+      m_failed = fwrite(m_buffer, 1, m_used, m_file) != (size_t)m_used || m_failed;
+      m_failed = fflush(m_file) != 0 || m_failed;
+    }
+    else if (m_stream != nullptr) {
+      m_stream->write(m_buffer, m_used);
+      m_stream->flush();
+      m_failed = !(*m_stream) || m_failed;
+    }
+    else {
+      int done = 0;
+      while (done < m_used) {
+        ssize_t wrote = write(m_fd, m_buffer + done, m_used - done);
+        if (wrote <= 0) {
+          m_failed = true;
+          break;
+        }
+        done += (int)wrote;
+      }
+    }
+    m_bytes += m_used;
+  }
+  m_used = 0;
+  return !m_failed;
+}
+
+long long CropExporter::numWritten() const {
+  return m_written;
+}
+
+long long CropExporter::numBytes() const {
+  return m_bytes + m_used;
+}
+
+/******************************************
+* Private function *
+******************************************/
+bool CropExporter::attached() const {
+  return m_file != nullptr || m_fd >= 0 || m_stream != nullptr;
+}
+
+// grows the walk arrays to hold nodes entries, they are kept for the next region
+void CropExporter::reserve(int nodes){
+  if (nodes <= m_capacity) {
+    return;
+  }
+  delete[] m_stack;
+  delete[] m_frontier;
+  m_stack = new const Crop*[nodes];
+  m_frontier = new Entry[nodes];
+  m_capacity = nodes;
+}
+
+// preorder without recursion, a skew heap may be as deep as it is large;
+// expired crops the region has not freed yet are skipped
+void CropExporter::writePreorder(const Region& aRegion, int regionKey){
+  int top = 0;
+  for (int i = aRegion.m_numPending - 1; i >= 0; i--) {
+    m_stack[top++] = aRegion.m_pending[i];
+  }
+  for (int i = aRegion.numHeaps() - 1; i >= 0; i--) {
+    if (aRegion.heapAt(i) != nullptr) {
+      m_stack[top++] = aRegion.heapAt(i);
+    }
+  }
+  while (top > 0) {
+    const Crop* node = m_stack[--top];
+    if (!aRegion.isExpired(*node)) {
+      writeCrop(*node, regionKey);
+    }
+    if (node->m_right != nullptr) m_stack[top++] = node->m_right;
+    if (node->m_left != nullptr) m_stack[top++] = node->m_left;
+  }
+}
+
+// best-first walk: a heap of the frontier nodes by their cached key, a node's
+// children join when it is written. Pending crops have no valid key yet, each
+// gets its key now and joins on its own; so does every node of a min-max heap,
+// which is not ordered parent before child. O(n log n), nothing is changed.
+void CropExporter::writeSorted(const Region& aRegion, int regionKey){
+  int size = 0;
+  int top = 0;
+  bool minMax = (aRegion.m_structure == MINMAX);
+  for (int i = 0; i < aRegion.numHeaps(); i++) {
+    if (aRegion.heapAt(i) == nullptr) {
+      continue;
+    }
+    if (minMax) {
+      m_stack[top++] = aRegion.heapAt(i);
+    }
+    else {
+      pushEntry(size, aRegion.heapAt(i)->m_key, aRegion.heapAt(i), true);
+    }
+  }
+  for (int i = 0; i < aRegion.m_numPending; i++) {
+    m_stack[top++] = aRegion.m_pending[i];
+  }
+  while (top > 0) {
+    const Crop* node = m_stack[--top];
+    long long key = minMax ? node->m_key : aRegion.keyOf(*node, aRegion.m_priorFunc(*node));
+    pushEntry(size, key, node, false);
+    if (node->m_right != nullptr) m_stack[top++] = node->m_right;
+    if (node->m_left != nullptr) m_stack[top++] = node->m_left;
+  }
+
+  while (size > 0) {
+    Entry entry = popEntry(size);
+    if (!aRegion.isExpired(*entry.m_node)) {
+      writeCrop(*entry.m_node, regionKey);
+    }
+    if (entry.m_open) {
+      const Crop* left = entry.m_node->m_left;
+      const Crop* right = entry.m_node->m_right;
+      if (left != nullptr) pushEntry(size, left->m_key, left, true);
+      if (right != nullptr) pushEntry(size, right->m_key, right, true);
+    }
+  }
+}
+
+void CropExporter::pushEntry(int& size, long long key, const Crop* node, bool open){
+  int pos = size++;
+  while (pos > 0 && m_frontier[(pos - 1) / 2].m_key > key) {
+    m_frontier[pos] = m_frontier[(pos - 1) / 2];
+    pos = (pos - 1) / 2;
+  }
+  m_frontier[pos].m_key = key;
+  m_frontier[pos].m_node = node;
+  m_frontier[pos].m_open = open;
+}
+
+CropExporter::Entry CropExporter::popEntry(int& size){
+  Entry result = m_frontier[0];
+  Entry last = m_frontier[--size];
+  int pos = 0;
+  while (2 * pos + 1 < size) {
+    int child = 2 * pos + 1;
+    if (child + 1 < size && m_frontier[child + 1].m_key < m_frontier[child].m_key) {
+      child++;
+    }
+    if (m_frontier[child].m_key >= last.m_key) {
+      break;
+    }
+    m_frontier[pos] = m_frontier[child];
+    pos = child;
+  }
+  if (size > 0) {
+    m_frontier[pos] = last;
+  }
+  return result;
+}
+
+// formats one record into the buffer
+void CropExporter::writeCrop(const Crop& crop, int regionKey){
+  room(MAXRECORDSIZE);
+  if (m_format == BINARYRECORD) {
+    int32_t field[6] = {crop.m_cropID, crop.m_temperature, crop.m_moisture,
+                        crop.m_time, crop.m_type, regionKey};
+    memcpy(m_buffer + m_used, field, BINARYRECORDSIZE);
+    m_used += BINARYRECORDSIZE;
+  }
+  else if (m_format == JSONRECORD) {
+    writeText("{\"id\":");
+    writeInt(crop.m_cropID);
+    writeText(",\"temperature\":");
+    writeInt(crop.m_temperature);
+    writeText(",\"moisture\":");
+    writeInt(crop.m_moisture);
+    writeText(",\"time\":\"");
+    writeText(TIMENAMES[crop.m_time], TIMELENGTHS[crop.m_time]);
+    writeText("\",\"type\":\"");
+    writeText(TYPENAMES[crop.m_type], TYPELENGTHS[crop.m_type]);
+    writeText("\",\"region\":");
+    writeInt(regionKey);
+    writeText("}\n");
+  }
+  else {
+    writeInt(crop.m_cropID);
+    m_buffer[m_used++] = ',';
+    writeInt(crop.m_temperature);
+    m_buffer[m_used++] = ',';
+    writeInt(crop.m_moisture);
+    m_buffer[m_used++] = ',';
+    writeInt(crop.m_time);
+    m_buffer[m_used++] = ',';
+    writeInt(crop.m_type);
+    m_buffer[m_used++] = ',';
+    writeInt(regionKey);
+    m_buffer[m_used++] = '\n';
+  }
+  m_written++;
+}
+
+// a literal, its length is known at compile time once inlined
+void CropExporter::writeText(const char* text){
+  writeText(text, (int)strlen(text));
+}
+
+// the caller made room for the text
+void CropExporter::writeText(const char* text, int length){
+  memcpy(m_buffer + m_used, text, length);
+  m_used += length;
+}
+
+// decimal digits are written back to front into a small scratch buffer
+void CropExporter::writeInt(int value){
+  char digits[12];
+  int pos = sizeof(digits);
+  unsigned int magnitude = (value < 0) ? 0u - (unsigned int)value : (unsigned int)value;
+  do {
+    digits[--pos] = (char)('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude > 0);
+  if (value < 0) {
+    digits[--pos] = '-';
+  }
+  writeText(digits + pos, (int)sizeof(digits) - pos);
+}
+
+// flushes when fewer than bytes are free
+void CropExporter::room(int bytes){
+  if (m_used + bytes > m_bufferSize) {
+    flush();
+  }
+}
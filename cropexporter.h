@@ -0,0 +1,83 @@
+// CMSC 341 - Fall 2025 - Project 3
+// Buffered crop exporter: writes the crops of Regions and Irrigators to a
+// FILE*, a file descriptor or an ostream through one large buffer. Records
+// are formatted in place (no strings, no printf), so a million crops take
+// a fraction of a second instead of a flush per line.
+#ifndef CROPEXPORTER_H
+#define CROPEXPORTER_H
+#include <cstdio>
+#include "irrigator.h"
+#include "croploader.h"
+
+// PREORDER: the nodes as they lie in the heaps, no ordering work
+// SORTEDORDER: the order getNextCrop would return them, the heaps stay untouched
+enum EXPORTORDER {PREORDER, SORTEDORDER};
+
+// CSVRECORD and BINARYRECORD are the records CropLoader reads back, the CSV
+// starts with a header line. JSONRECORD is one object per line with the
+// TIME and PLANT names, e.g.
+// {"id":100001,"temperature":70,"moisture":20,"time":"NOON","type":"BEAN","region":1}
+class CropExporter{
+    public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // for testing purposes
+    CropExporter(RECORDFORMAT format = CSVRECORD, EXPORTORDER order = PREORDER,
+                 int bufferSize = DEFAULTCHUNK);
+    ~CropExporter();    // flushes
+    CropExporter(const CropExporter& rhs) = delete;
+    CropExporter& operator=(const CropExporter& rhs) = delete;
+    // Where the records go; the previous sink is flushed first. The sink
+    // must stay open until the next flush.
+    void attach(FILE* out);
+    void attach(int fd);
+    void attach(ostream& out);
+    // Writes every crop of the region with regionKey in the region column.
+    // Returns the number of crops written, -1 without a sink.
+    long long writeRegion(const Region& aRegion, int regionKey);
+    // Writes every region in the order they lie in the irrigator's heap,
+    // each with its regPrior in the region column (SORTEDORDER sorts the
+    // crops of each region)
+    long long writeIrrigator(const Irrigator& anIrrigator);
+    // Hands the buffered bytes to the sink. False if a write failed since
+    // the sink was attached.
+    bool flush();
+    long long numWritten() const;   // crops written to all sinks
+    long long numBytes() const;     // bytes handed to all sinks
+
+    private:
+    // a frontier node of the sorted walk and its key
+    struct Entry{
+        long long m_key;
+        const Crop* m_node;
+        bool m_open;        // a heap node, its children join when it is written
+    };
+
+    RECORDFORMAT m_format;
+    EXPORTORDER m_order;
+    char * m_buffer;
+    int m_bufferSize;
+    int m_used;             // bytes waiting in m_buffer
+    FILE * m_file;          // the sink, at most one of the three is set
+    int m_fd;
+    ostream * m_stream;
+    bool m_header;          // the CSV header went to the current sink
+    bool m_failed;
+    long long m_written;
+    long long m_bytes;
+    const Crop ** m_stack;  // walk stack, reused between regions
+    Entry * m_frontier;     // sorted walk heap, reused between regions
+    int m_capacity;         // size of m_stack and m_frontier
+
+    bool attached() const;
+    void reserve(int nodes);
+    void writePreorder(const Region& aRegion, int regionKey);
+    void writeSorted(const Region& aRegion, int regionKey);
+    void pushEntry(int& size, long long key, const Crop* node, bool open);
+    Entry popEntry(int& size);
+    void writeCrop(const Crop& crop, int regionKey);
+    void writeText(const char* text);
+    void writeText(const char* text, int length);
+    void writeInt(int value);
+    void room(int bytes);
+};
+#endif
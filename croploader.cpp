@@ -0,0 +1,360 @@
+// CMSC 341 - Fall 2025 - Project 3
+#include "croploader.h"
+#include <cstring>
+#include <cstdint>
+
+// constructor - allocates the chunk buffer once, routes are added later
+CropLoader::CropLoader(int chunkSize, int batchSize){
+  // a chunk has to hold at least a few records
+  if (chunkSize < 256) {
+    chunkSize = 256;
+  }
+  if (batchSize <= 0) {
+    batchSize = 1;
+  }
+
+  m_chunkSize = chunkSize;
+  m_batchSize = batchSize;
+  m_buffer = new char[m_chunkSize];
+  m_keys = nullptr;
+  m_targets = nullptr;
+  m_staged = nullptr;
+  m_numStaged = nullptr;
+  m_numRoutes = 0;
+  m_routeCapacity = 0;
+  m_lastRoute = -1;
+  m_skipping = false;
+  m_loaded = 0;
+  m_rejected = 0;
+  m_unrouted = 0;
+}
+
+// destructor - pushes any staged crops into their regions and releases the buffers
+CropLoader::~CropLoader(){
+  flushAll();
+  for (int i = 0; i < m_numRoutes; i++) {
+    delete[] m_staged[i];
+  }
+  delete[] m_keys;
+  delete[] m_targets;
+  delete[] m_staged;
+  delete[] m_numStaged;
+  delete[] m_buffer;
+}
+
+// addRoute - registers the region that receives records with the given region key
+bool CropLoader::addRoute(int regionKey, Region & aRegion){
+  // find the sorted position of the key
+  int pos = 0;
+  while (pos < m_numRoutes && m_keys[pos] < regionKey) {
+    pos++;
+  }
+  if (pos < m_numRoutes && m_keys[pos] == regionKey) {
+    return false; // the key is already routed
+  }
+
+  // grow the route arrays
+  if (m_numRoutes == m_routeCapacity) {
+    int capacity = (m_routeCapacity == 0) ? 8 : m_routeCapacity * 2;
+    int* keys = new int[capacity];
+    Region** targets = new Region*[capacity];
+    Crop** staged = new Crop*[capacity];
+    int* numStaged = new int[capacity];
+    for (int i = 0; i < m_numRoutes; i++) {
+      keys[i] = m_keys[i];
+      targets[i] = m_targets[i];
+      staged[i] = m_staged[i];
+      numStaged[i] = m_numStaged[i];
+    }
+    delete[] m_keys;
+    delete[] m_targets;
+    delete[] m_staged;
+    delete[] m_numStaged;
+    m_keys = keys;
+    m_targets = targets;
+    m_staged = staged;
+    m_numStaged = numStaged;
+    m_routeCapacity = capacity;
+  }
+
+  // shift the larger keys and insert the new route
+  for (int i = m_numRoutes; i > pos; i--) {
+    m_keys[i] = m_keys[i-1];
+    m_targets[i] = m_targets[i-1];
+    m_staged[i] = m_staged[i-1];
+    m_numStaged[i] = m_numStaged[i-1];
+  }
+  m_keys[pos] = regionKey;
+  m_targets[pos] = &aRegion;
+  m_staged[pos] = new Crop[m_batchSize];
+  m_numStaged[pos] = 0;
+  m_numRoutes++;
+  m_lastRoute = -1;
+
+  return true;
+}
+
+// loadFile - opens the file (or stdin for "-") and streams it into the regions
+long long CropLoader::loadFile(const char* path, RECORDFORMAT format){
+  if (path == nullptr || format == JSONRECORD) {
+    return -1;
+  }
+  if (strcmp(path, "-") == 0) {
+    return loadStream(stdin, format);
+  }
+
+  FILE* in = fopen(path, format == BINARYRECORD ? "rb" : "r");
+  if (in == nullptr) {
+    return -1;
+  }
+  long long result = loadStream(in, format);
+  fclose(in);
+  return result;
+}
+
+// loadStream - reads the stream to the end, every region gets its crops bulk-built
+long long CropLoader::loadStream(FILE* in, RECORDFORMAT format){
+  if (in == nullptr || format == JSONRECORD) {
+    return -1;
+  }
+
+  long long before = m_loaded;
+  if (format == BINARYRECORD) {
+    loadBinary(in);
+  }
+  else {
+    loadCSV(in);
+  }
+
+  // the rest of the staged crops go in at the end of the input
+  flushAll();
+  return m_loaded - before;
+}
+
+long long CropLoader::numLoaded() const {
+  return m_loaded;
+}
+
+long long CropLoader::numRejected() const {
+  return m_rejected;
+}
+
+long long CropLoader::numUnrouted() const {
+  return m_unrouted;
+}
+
+/******************************************
+* Private function *
+******************************************/
+// reads text records, a partial line at the end of a chunk is carried over
+// to the front of the buffer and completed by the next read
+void CropLoader::loadCSV(FILE* in){
+  size_t carry = 0;
+  m_skipping = false;
+
+  while (true) {
+    size_t got = fread(m_buffer + carry, 1, m_chunkSize - carry, in);
+    const char* pos = m_buffer;
+    const char* stop = m_buffer + carry + got;
+
+    // parse every complete line in the chunk
+    while (pos < stop) {
+      const char* newline = static_cast<const char*>(memchr(pos, '\n', stop - pos));
+      if (newline == nullptr) {
+        break;
+      }
+      if (m_skipping) {
+        m_skipping = false; // end of the over-long line
+      }
+      else {
+        parseLine(pos, newline);
+      }
+      pos = newline + 1;
+    }
+    carry = stop - pos;
+
+    // end of input, the last line may not have a newline
+    if (got == 0) {
+      if (carry > 0 && !m_skipping) {
+        parseLine(pos, stop);
+      }
+      break;
+    }
+
+    // a line that does not fit in the buffer is rejected and skipped
+    if (carry == (size_t)m_chunkSize) {
+      if (!m_skipping) {
+        m_rejected++;
+      }
+      m_skipping = true;
+      carry = 0;
+      continue;
+    }
+    memmove(m_buffer, pos, carry);
+  }
+}
+
+// reads fixed size binary records, a partial record is carried over like a partial line
+void CropLoader::loadBinary(FILE* in){
+  // only whole records are read into the chunk
+  size_t usable = (m_chunkSize / BINARYRECORDSIZE) * BINARYRECORDSIZE;
+  size_t carry = 0;
+
+  while (true) {
+    size_t got = fread(m_buffer + carry, 1, usable - carry, in);
+    size_t total = carry + got;
+    size_t records = total / BINARYRECORDSIZE;
+
+    for (size_t i = 0; i < records; i++) {
+      int32_t field[6];
+      memcpy(field, m_buffer + i * BINARYRECORDSIZE, sizeof(field));
+      route(field[0], field[1], field[2], field[3], field[4], field[5]);
+    }
+
+    carry = total - records * BINARYRECORDSIZE;
+    if (got == 0) {
+      // a truncated record at the end of the input
+      if (carry > 0) {
+        m_rejected++;
+      }
+      break;
+    }
+    memmove(m_buffer, m_buffer + records * BINARYRECORDSIZE, carry);
+  }
+}
+
+// parses "ID,temperature,moisture,time,type,region" in place, no strings are built
+// blank lines, comments (#) and header lines (starting with a letter) are ignored
+void CropLoader::parseLine(const char* begin, const char* end){
+  // drop the carriage return of CRLF input
+  if (end > begin && end[-1] == '\r') {
+    end--;
+  }
+
+  // skip leading blanks
+  const char* pos = begin;
+  while (pos < end && (*pos == ' ' || *pos == '\t')) {
+    pos++;
+  }
+  if (pos == end || *pos == '#') {
+    return;
+  }
+  if ((*pos >= 'a' && *pos <= 'z') || (*pos >= 'A' && *pos <= 'Z')) {
+    return;
+  }
+
+  int value[6];
+  for (int i = 0; i < 6; i++) {
+    if (!parseField(pos, end, value[i])) {
+      m_rejected++;
+      return;
+    }
+    // fields are separated by commas, the last one ends the line
+    if (i < 5) {
+      if (pos == end || *pos != ',') {
+        m_rejected++;
+        return;
+      }
+      pos++;
+    }
+  }
+  if (pos != end) {
+    m_rejected++;
+    return;
+  }
+
+  route(value[0], value[1], value[2], value[3], value[4], value[5]);
+}
+
+// parses one integer field surrounded by optional blanks
+bool CropLoader::parseField(const char*& pos, const char* end, int& value) const {
+  while (pos < end && (*pos == ' ' || *pos == '\t')) {
+    pos++;
+  }
+
+  bool negative = false;
+  if (pos < end && (*pos == '-' || *pos == '+')) {
+    negative = (*pos == '-');
+    pos++;
+  }
+
+  // at least one digit, at most 9 so the value always fits in an int
+  long long result = 0;
+  int digits = 0;
+  while (pos < end && *pos >= '0' && *pos <= '9') {
+    if (digits == 9) {
+      return false;
+    }
+    result = result * 10 + (*pos - '0');
+    digits++;
+    pos++;
+  }
+  if (digits == 0) {
+    return false;
+  }
+
+  while (pos < end && (*pos == ' ' || *pos == '\t')) {
+    pos++;
+  }
+
+  value = (int)(negative ? -result : result);
+  return true;
+}
+
+// stages one record for its region, the Crop constructor applies the usual clamping
+void CropLoader::route(int ID, int temperature, int moisture, int time, int type, int regionKey){
+  int index = findRoute(regionKey);
+  if (index < 0) {
+    m_unrouted++;
+    return;
+  }
+
+  m_staged[index][m_numStaged[index]] = Crop(ID, temperature, moisture, time, type);
+  m_numStaged[index]++;
+  if (m_numStaged[index] == m_batchSize) {
+    flush(index);
+  }
+}
+
+// binary search of the sorted keys, the previous hit is tried first
+int CropLoader::findRoute(int regionKey){
+  if (m_lastRoute >= 0 && m_keys[m_lastRoute] == regionKey) {
+    return m_lastRoute;
+  }
+
+  int low = 0;
+  int high = m_numRoutes - 1;
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    if (m_keys[mid] == regionKey) {
+      m_lastRoute = mid;
+      return mid;
+    }
+    if (m_keys[mid] < regionKey) {
+      low = mid + 1;
+    }
+    else {
+      high = mid - 1;
+    }
+  }
+  return -1;
+}
+
+// bulk-builds a staging batch into its region
+void CropLoader::flush(int route){
+  int count = m_numStaged[route];
+  if (count == 0) {
+    return;
+  }
+
+  int accepted = m_targets[route]->insertCrops(m_staged[route], count);
+  m_loaded += accepted;
+  m_rejected += count - accepted;
+  m_numStaged[route] = 0;
+}
+
+void CropLoader::flushAll(){
+  for (int i = 0; i < m_numRoutes; i++) {
+    flush(i);
+  }
+}
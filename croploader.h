@@ -0,0 +1,58 @@
+// CMSC 341 - Fall 2025 - Project 3
+// Streaming crop loader: reads crop records in large chunks and bulk-builds
+// them into the Regions they are routed to.
+#ifndef CROPLOADER_H
+#define CROPLOADER_H
+#include <cstdio>
+#include "irrigator.h"
+
+#define DEFAULTCHUNK 1048576  // bytes read from the input per chunk
+#define DEFAULTBATCH 4096     // crops staged per region before a bulk build
+// a binary record is 6 native int32 values: ID, temperature, moisture, time, type, region
+const int BINARYRECORDSIZE = 24;
+
+class CropLoader{
+    public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // for testing purposes
+    CropLoader(int chunkSize = DEFAULTCHUNK, int batchSize = DEFAULTBATCH);
+    ~CropLoader();
+    CropLoader(const CropLoader& rhs) = delete;
+    CropLoader& operator=(const CropLoader& rhs) = delete;
+    // Records whose region column equals regionKey go into aRegion.
+    // The region must outlive the loader. Returns false for a duplicate key.
+    bool addRoute(int regionKey, Region & aRegion);
+    // Reads a whole file ("-" is stdin). Returns the number of crops inserted
+    // by this call, or -1 if the file cannot be opened or the format is JSONRECORD.
+    long long loadFile(const char* path, RECORDFORMAT format);
+    long long loadStream(FILE* in, RECORDFORMAT format);
+    long long numLoaded() const;    // crops inserted into regions so far
+    long long numRejected() const;  // malformed records and crops a region refused
+    long long numUnrouted() const;  // well-formed records with an unknown region
+
+    private:
+    char * m_buffer;        // chunk buffer, reused for the whole input
+    int m_chunkSize;        // size of m_buffer
+    int m_batchSize;        // crops staged per route before insertCrops
+    int * m_keys;           // region keys, kept sorted
+    Region ** m_targets;    // target region of every key
+    Crop ** m_staged;       // staging batch of every key
+    int * m_numStaged;      // number of crops in every staging batch
+    int m_numRoutes;        // number of routes
+    int m_routeCapacity;    // size of the route arrays
+    int m_lastRoute;        // route of the previous record, inputs are usually grouped
+    bool m_skipping;        // discarding the rest of an over-long line
+    long long m_loaded;
+    long long m_rejected;
+    long long m_unrouted;
+
+    void loadCSV(FILE* in);
+    void loadBinary(FILE* in);
+    void parseLine(const char* begin, const char* end);
+    bool parseField(const char*& pos, const char* end, int& value) const;
+    void route(int ID, int temperature, int moisture, int time, int type, int regionKey);
+    int findRoute(int regionKey);
+    void flush(int route);
+    void flushAll();
+};
+#endif
@@ -1,7 +1,9 @@
 // CMSC 341 - Fall 2025 - Project 3
 #include "irrigator.h"
+#include "pipeline.h"
 #include <math.h>
 #include <algorithm>
+#include <chrono>
 #include <random>
 #include <vector>
 using namespace std;
@@ -137,6 +139,11 @@ public:
 // Priority functions compute an integer priority for a crop.
 int priorityFn1(const Crop &crop);// works with a MAXHEAP
 int priorityFn2(const Crop &crop);// works with a MINHEAP
+// serves crops from regions with different priorities and prints each region's share
+void simulateShares(SCHEDULE schedule, const char* name);
+// feeds the same readings to a synchronous loop and to the pipeline, prints throughput and latency
+void simulatePipeline();
+void slowValve(const Crop &crop);   // a simulated valve, every command takes VALVEMICROS
 
 class Tester{
     public:
@@ -198,10 +205,103 @@ int main(){
     regionsQueue.getRegion(highPrioRegion); 
     cout << endl; highPrioRegion.dump();
 
+    cout << endl << "Service shares over one irrigation window:" << endl;
+    simulateShares(STRICT, "STRICT");
+    simulateShares(FAIRSHARE, "FAIRSHARE");
+
+    cout << endl << "Synchronous loop vs pipeline, simulated valves:" << endl;
+    simulatePipeline();
+
     cout << endl;
     return 0;
 }
 
+void simulateShares(SCHEDULE schedule, const char* name){
+    const int numRegions = 4;
+    const int regionPriors[numRegions] = {1, 2, 4, 8};
+    const int cropsPerRegion = 1000;
+    const int window = 600;     // crops served in the window
+    Random moistureGen(MINMOISTURE,MAXMOISTURE);
+    Random timeGen(MINTIME,MAXTIME);
+
+    // crop IDs tell the regions apart
+    Irrigator irrigator(numRegions + 1, schedule);
+    for (int r=0;r<numRegions;r++){
+        Region aRegion(priorityFn2, MINHEAP, LEFTIST, regionPriors[r]);
+        for (int i=0;i<cropsPerRegion;i++){
+            Crop aCrop(MINCROPID + r*cropsPerRegion + i, MINTEMP,
+                        moistureGen.getRandNum(), timeGen.getRandNum(), MINTYPE);
+            aRegion.insertCrop(aCrop);
+        }
+        irrigator.addRegion(aRegion);
+    }
+
+    int served[numRegions] = {0};
+    Crop aCrop;
+    for (int i=0;i<window && irrigator.getCrop(aCrop);i++){
+        served[(aCrop.getCropID() - MINCROPID) / cropsPerRegion]++;
+    }
+
+    // a fair share is proportional to 1/regPrior
+    double weights = 0;
+    for (int r=0;r<numRegions;r++) weights += 1.0 / regionPriors[r];
+    cout << name << ":" << endl;
+    for (int r=0;r<numRegions;r++){
+        cout << "  region priority " << regionPriors[r] << ": " << served[r] << " crops ("
+             << 100.0 * served[r] / window << "%, fair share "
+             << 100.0 / regionPriors[r] / weights << "%)" << endl;
+    }
+}
+
+#define VALVEMICROS 50
+void slowValve(const Crop &crop){
+    (void)crop;
+    this_thread::sleep_for(chrono::microseconds(VALVEMICROS));
+}
+
+void simulatePipeline(){
+    const int numReadings = 20000;
+    const int numValves = 4;
+    Random idGen(MINCROPID,MAXCROPID);
+    Random temperatureGen(MINTEMP,MAXTEMP);
+    Random moistureGen(MINMOISTURE,MAXMOISTURE);
+    Random timeGen(MINTIME,MAXTIME);
+    Random typeGen(MINTYPE,MAXTYPE);
+    vector<Crop> readings;
+    for (int i=0;i<numReadings;i++){
+        readings.push_back(Crop(idGen.getRandNum(), temperatureGen.getRandNum(),
+                                moistureGen.getRandNum(), timeGen.getRandNum(), typeGen.getRandNum()));
+    }
+
+    // read, insert, serve and wait for the valve, one reading at a time
+    typedef chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    Region region(priorityFn2, MINHEAP, LEFTIST, 1);
+    for (int i=0;i<numReadings;i++){
+        if (region.insertCrop(readings[i])) slowValve(region.getNextCrop());
+    }
+    double syncMs = chrono::duration<double, milli>(Clock::now() - start).count();
+    cout << "  synchronous: " << numReadings << " readings in " << syncMs << " ms ("
+         << numReadings / syncMs * 1000 << " readings/s)" << endl;
+
+    start = Clock::now();
+    IrrigationPipeline pipeline(priorityFn2, MINHEAP, LEFTIST, slowValve, numValves);
+    for (int i=0;i<numReadings;i++){
+        pipeline.submit(readings[i]);
+    }
+    double ingestMs = chrono::duration<double, milli>(Clock::now() - start).count();
+    pipeline.finish();
+    double totalMs = chrono::duration<double, milli>(Clock::now() - start).count();
+    PipelineStats st = pipeline.stats();
+    cout << "  pipeline (" << numValves << " valves): ingest took " << ingestMs << " ms, all "
+         << st.dispatched << " crops dispatched in " << totalMs << " ms ("
+         << st.dispatched / totalMs * 1000 << " crops/s), " << st.rejected << " rejected, "
+         << st.batches << " batches" << endl;
+    cout << "  latency submit to valve: mean " << st.meanLatency / 1000 << " us, p50 "
+         << st.p50 / 1000 << " us, p99 " << st.p99 / 1000 << " us, max "
+         << st.maxLatency / 1000 << " us" << endl;
+}
+
 int priorityFn1(const Crop &crop) {
     //needs MAXHEAP
     //priority value is determined based on some criteria
@@ -2,9 +2,158 @@
 // student: Andrew Soth
 // professor: Kartchner
 #include "irrigator.h"
+#include "journal.h"
+#include "tracing.h"
+#include "croparena.h"
+#include <climits>
+#include <cmath>
+#include <unordered_map>
 
 // private functions are located after the template functions
 
+// meanMoisture - average soil moisture, 0 for an empty region
+double CropStats::meanMoisture() const {
+  return (count > 0) ? (double)moistureSum / count : 0.0;
+}
+
+double CropStats::meanTemperature() const {
+  return (count > 0) ? (double)temperatureSum / count : 0.0;
+}
+
+// stddevMoisture - population standard deviation from the sum of squares
+double CropStats::stddevMoisture() const {
+  if (count == 0) {
+    return 0.0;
+  }
+  double mean = meanMoisture();
+  double variance = (double)moistureSquares / count - mean * mean;
+  return (variance > 0.0) ? sqrt(variance) : 0.0;
+}
+
+double CropStats::stddevTemperature() const {
+  if (count == 0) {
+    return 0.0;
+  }
+  double mean = meanTemperature();
+  double variance = (double)temperatureSquares / count - mean * mean;
+  return (variance > 0.0) ? sqrt(variance) : 0.0;
+}
+
+// constructor - an empty order, the region's priority function decides
+CropOrder::CropOrder() {
+  m_numFields = 0;
+}
+
+// add - appends a field below the ones already in the order
+bool CropOrder::add(CROPFIELD field, ORDERDIR dir) {
+  if (field < FIELDTEMPERATURE || field >= NUMCROPFIELDS) {
+    return false;
+  }
+  for (int i = 0; i < m_numFields; i++) {
+    if (m_fields[i] == field) {
+      return false;   // a field decides only once
+    }
+  }
+  m_fields[m_numFields] = field;
+  m_dirs[m_numFields] = dir;
+  m_numFields++;
+  return true;
+}
+
+int CropOrder::numFields() const {
+  return m_numFields;
+}
+
+bool CropOrder::empty() const {
+  return m_numFields == 0;
+}
+
+// key - packs the fields, most significant first; a descending field is stored
+// as (range - value) so a smaller key always comes first
+long long CropOrder::key(const Crop& crop) const {
+  long long result = 0;
+  for (int i = 0; i < m_numFields; i++) {
+    int value = fieldValue(m_fields[i], crop);
+    if (m_dirs[i] == DESCENDING) {
+      value = fieldRange(m_fields[i]) - value;
+    }
+    result = (result << fieldBits(m_fields[i])) | value;
+  }
+  return result;
+}
+
+bool CropOrder::operator==(const CropOrder& rhs) const {
+  if (m_numFields != rhs.m_numFields) {
+    return false;
+  }
+  for (int i = 0; i < m_numFields; i++) {
+    if (m_fields[i] != rhs.m_fields[i] || m_dirs[i] != rhs.m_dirs[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CropOrder::operator!=(const CropOrder& rhs) const {
+  return !(*this == rhs);
+}
+
+// encode - four bits per field (field and direction) for the journal
+int CropOrder::encode() const {
+  int code = 0;
+  for (int i = m_numFields - 1; i >= 0; i--) {
+    code = (code << 4) | (m_fields[i] << 1) | m_dirs[i];
+  }
+  return code;
+}
+
+// decode - rebuilds an order written by encode, false if it is not valid
+bool CropOrder::decode(int code, int numFields) {
+  m_numFields = 0;
+  for (int i = 0; i < numFields; i++) {
+    if (!add((CROPFIELD)((code >> 1) & 7), (ORDERDIR)(code & 1))) {
+      m_numFields = 0;
+      return false;
+    }
+    code >>= 4;
+  }
+  return true;
+}
+
+// bits of a field in the key, enough for its range
+int CropOrder::fieldBits(CROPFIELD field) {
+  switch (field) {
+  case FIELDTEMPERATURE: return 7;  // 0-80
+  case FIELDMOISTURE: return 7;     // 0-99
+  case FIELDTIME: return 2;         // 0-3
+  case FIELDTYPE: return 3;         // 0-6
+  default: return 20;               // crop IDs, 0-899999
+  }
+}
+
+int CropOrder::fieldRange(CROPFIELD field) {
+  switch (field) {
+  case FIELDTEMPERATURE: return MAXTEMP - MINTEMP;
+  case FIELDMOISTURE: return MAXMOISTURE - MINMOISTURE;
+  case FIELDTIME: return MAXTIME - MINTIME;
+  case FIELDTYPE: return MAXTYPE - MINTYPE;
+  default: return MAXCROPID - DEFAULTCROPID;
+  }
+}
+
+// the field's value counted from its minimum, the Crop constructor keeps it in range
+int CropOrder::fieldValue(CROPFIELD field, const Crop& crop) {
+  switch (field) {
+  case FIELDTEMPERATURE: return crop.getTemperature() - MINTEMP;
+  case FIELDMOISTURE: return crop.getMoisture() - MINMOISTURE;
+  case FIELDTIME: return crop.getTime() - MINTIME;
+  case FIELDTYPE: return crop.getType() - MINTYPE;
+  default: return crop.getCropID() - DEFAULTCROPID;
+  }
+}
+
+//////////////////////////////////////////////////////////////
+
 // default constructor - all values are set to the default / initial values
 // called when something creates a region without parameters
 Region::Region(){ 
@@ -14,6 +163,28 @@ Region::Region(){
   m_heapType = NOTYPE;    // default to NOTYPE
   m_structure = NOSTRUCT; // default to NOSTRUCT
   m_regPrior = 0;         // defaults to 0
+  m_journal = nullptr;    // not logged
+  m_journalTag = 0;
+  m_persistent = false;   // copies are deep
+  m_pass = 0;
+  m_partition = NOPARTITION;  // one heap
+  for (int i = 0; i < MAXPARTITIONS; i++) {
+    m_part[i] = nullptr;
+    m_partSize[i] = 0;
+  }
+  m_arena = nullptr;      // nodes come from new
+  m_autoCompact = false;
+  m_rebuildBudget = 0;    // rebuilds happen at once
+  m_pending = nullptr;
+  m_numPending = 0;
+  m_pendingCapacity = 0;
+  m_pendingCrops = 0;
+  m_ttl = 0;              // crops never expire
+  m_expired = 0;
+  m_aging = 0;            // crops do not age
+  resetStats();           // no crops to count
+  STAT(m_counters = RegionCounters();)
+  STAT(m_mergeDepth = 0;)
 }
 
 // parameterized constructor - setup a region with the inputted values
@@ -38,24 +209,47 @@ Region::Region(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure, int regPri
     m_structure = structure;  // store structure type (SKEW or LEFTIST)
     m_regPrior = regPrior;    // region-level priority (used by Irrigator)
   }
+  m_journal = nullptr;
+  m_journalTag = 0;
+  m_persistent = false;
+  m_pass = 0;
+  m_partition = NOPARTITION;
+  for (int i = 0; i < MAXPARTITIONS; i++) {
+    m_part[i] = nullptr;
+    m_partSize[i] = 0;
+  }
+  m_arena = nullptr;
+  m_autoCompact = false;
+  m_rebuildBudget = 0;
+  m_pending = nullptr;
+  m_numPending = 0;
+  m_pendingCapacity = 0;
+  m_pendingCrops = 0;
+  m_ttl = 0;
+  m_expired = 0;
+  m_aging = 0;
+  resetStats();
+  STAT(m_counters = RegionCounters();)
+  STAT(m_mergeDepth = 0;)
 }
 
 // destructor constructor - deallocates the memory and re-initializes the member variables
 // calls when region objects are no longer in use
 Region::~Region() {
-  clear();
+  emptyHeap();
+  delete[] m_pending;
 }
 
 // clear - clears the queue, delete all the nodes , and re-initializes the member variables
-// calls in the destuctor constructor
 void Region::clear() {
-  clearHeap(m_heap);  // recursively delete the nodes
-  m_heap = nullptr;   // set the root of the heap to empty
-  m_size = 0;         // no crops
+  emptyHeap();
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPCLEAR, m_journalTag);
+  }
 }
 
-// copy constructor - creates a deep copy of an region object including pointers
-// calls when want a deep copy of a region object
+// copy constructor - creates a deep copy of an region object including pointers,
+// a persistent region shares its nodes with the copy instead
 Region::Region(const Region& rhs) {
   // copy simple members
   m_size = rhs.m_size;
@@ -63,10 +257,31 @@ Region::Region(const Region& rhs) {
   m_heapType = rhs.m_heapType;
   m_structure = rhs.m_structure;
   m_regPrior = rhs.m_regPrior;
+  m_journal = nullptr;  // the copy is not logged
+  m_journalTag = 0;
+  m_persistent = rhs.m_persistent;
+  m_pass = rhs.m_pass;
+  m_order = rhs.m_order;
+  m_arena = rhs.m_arena;  // the copy allocates where rhs does
+  m_autoCompact = rhs.m_autoCompact;
+  m_rebuildBudget = rhs.m_rebuildBudget;
+  m_pending = nullptr;    // a pending rebuild is copied with the heaps
+  m_numPending = 0;
+  m_pendingCapacity = 0;
+  m_pendingCrops = 0;
+  m_wheel = rhs.m_wheel;  // the clock and the deadlines of the copied crops
+  m_ttl = rhs.m_ttl;
+  m_expired = rhs.m_expired;
+  m_aging = rhs.m_aging;
+  STAT(m_counters = rhs.m_counters;)
+  STAT(m_mergeDepth = 0;)
 
   // deep copy the heap
-  m_heap = copyHeap(rhs.m_heap);  // recursively copies the nodes
-  
+  m_heap = nullptr;
+  for (int i = 0; i < MAXPARTITIONS; i++) {
+    m_part[i] = nullptr;
+  }
+  copyHeaps(rhs);
 }
 
 // assignment operator - creates a copy of the object
@@ -78,7 +293,7 @@ Region& Region::operator=(const Region& rhs) {
   }
 
   // free old heap
-  clear();
+  emptyHeap();
 
   // copies the simple variable members
   m_size = rhs.m_size;
@@ -86,9 +301,25 @@ Region& Region::operator=(const Region& rhs) {
   m_heapType = rhs.m_heapType;
   m_structure = rhs.m_structure;
   m_regPrior = rhs.m_regPrior;
-
-  // deep copy heap
-  m_heap = copyHeap(rhs.m_heap);
+  m_persistent = rhs.m_persistent;
+  m_pass = rhs.m_pass;
+  m_order = rhs.m_order;
+  m_arena = rhs.m_arena;
+  m_autoCompact = rhs.m_autoCompact;
+  m_rebuildBudget = rhs.m_rebuildBudget;
+  m_wheel = rhs.m_wheel;
+  m_ttl = rhs.m_ttl;
+  m_expired = rhs.m_expired;
+  m_aging = rhs.m_aging;
+  STAT(m_counters = rhs.m_counters;)
+
+  // deep copy heap, or share it
+  copyHeaps(rhs);
+
+  // the journal stays with this object, it records the new contents
+  if (m_journal != nullptr) {
+    m_journal->logRegion(OPASSIGN, m_journalTag, *this);
+  }
 
   // returns the object
   return *this;
@@ -118,53 +349,191 @@ void Region::mergeWithQueue(Region& rhs) {
     throw domain_error("Region have different heap types");
   }
 
-  // merge rhs's heaps into this heap
-  m_heap = merge(m_heap, rhs.m_heap);
+  // check for different partitioning
+  if (m_partition != rhs.m_partition) {
+    throw domain_error("Regions have different partitions");
+  }
 
-  // update size
+  // check for different crop orders
+  if (m_order != rhs.m_order) {
+    throw domain_error("Regions have different crop orders");
+  }
+
+  // check for different aging rates, the keys would not compare
+  if (m_aging != rhs.m_aging) {
+    throw domain_error("Regions have different aging rates");
+  }
+
+  // the crops coming in are logged, rhs may not be logged itself
+  if (m_journal != nullptr) {
+    m_journal->logRegion(OPMERGEQUEUE, m_journalTag, rhs);
+  }
+  if (rhs.m_journal != nullptr) {
+    rhs.m_journal->logOp(OPCLEAR, rhs.m_journalTag);
+  }
+  settle();
+  rhs.settle();
+  // the crops rhs already dropped are gone, its deadlines move to this clock
+  if (rhs.m_expired > 0) {
+    rhs.purge();
+  }
+  m_expired += (int)m_wheel.take(rhs.m_wheel);
+
+  // merge rhs's heaps into this heap, sub-heap by sub-heap; min-max heaps
+  // do not meld, the nodes of rhs are added to this heap
+  Crop** nodes = (m_structure == MINMAX) ? new Crop*[rhs.m_size > 0 ? rhs.m_size : 1] : nullptr;
+  for (int i = 0; i < numHeaps(); i++) {
+    if (m_structure == MINMAX) {
+      addNodes(i, nodes, detachNodes(rhs.heapAt(i), nodes));
+    }
+    else {
+      STAT(m_counters.merges++;)
+      heapAt(i) = merge(heapAt(i), rhs.heapAt(i));
+      m_partSize[i] += rhs.m_partSize[i];
+    }
+
+    rhs.heapAt(i) = nullptr;
+    rhs.m_partSize[i] = 0;
+  }
+  delete[] nodes;
+
+  // update size and the aggregates, both are sums
   m_size += rhs.m_size;
+  m_stats.count += rhs.m_stats.count;
+  for (int i = 0; i <= MAXTYPE; i++) {
+    m_stats.byType[i] += rhs.m_stats.byType[i];
+  }
+  for (int i = 0; i <= MAXTIME; i++) {
+    m_stats.byTime[i] += rhs.m_stats.byTime[i];
+  }
+  m_stats.moistureSum += rhs.m_stats.moistureSum;
+  m_stats.moistureSquares += rhs.m_stats.moistureSquares;
+  m_stats.temperatureSum += rhs.m_stats.temperatureSum;
+  m_stats.temperatureSquares += rhs.m_stats.temperatureSquares;
+  for (int i = 0; i <= MAXMOISTURE - MINMOISTURE; i++) {
+    m_moistureCount[i] += rhs.m_moistureCount[i];
+  }
+  for (int i = 0; i <= MAXTEMP - MINTEMP; i++) {
+    m_temperatureCount[i] += rhs.m_temperatureCount[i];
+  }
 
   // leave rhs empty
-  rhs.m_heap = nullptr;
   rhs.m_size = 0;
+  rhs.resetStats();
+
+  // crops of rhs may be past this region's clock
+  dropExpired();
 }
 
 // insertCrop - inserts a crop object into the queue and maintains the heap type and structure
 bool Region::insertCrop(const Crop& crop) {
+  TRACE_SCOPE(TRACEINSERTCROP);
+
   // if the crop is invalid, it is rejected
   if (m_heapType == NOTYPE || m_structure == NOSTRUCT || m_priorFunc == nullptr) {
     // cannot insert into an empty object
     return false;
   }
+
+  // a crop past its deadline would expire before anyone sees it
+  if (crop.m_deadline != 0 && crop.m_deadline <= m_wheel.now()) {
+    return false;
+  }
   
   // compute priority using the region's priority function
   int priority = m_priorFunc(crop);
+  STAT(m_counters.priorityCalls++;)
 
   // if priority is invalid (<=0), do not insert
   if (priority <= 0) {
     return false;
   }
 
-  // create a new node for crop
-  Crop* newNode = new Crop(crop);
+  // create a new node for crop and merge it in
+  linkNode(newNode(crop), priority);
+  return true;
+}
 
-  // initialize the node fields
-  newNode->m_left = nullptr;
-  newNode->m_right = nullptr;
-  newNode->m_npl = 0;
+// insertCrop - a temporary is inserted like any other crop
+bool Region::insertCrop(Crop&& crop) {
+  return insertCrop(static_cast<const Crop&>(crop));
+}
 
-  // merge the new node into the existing heap
-  m_heap = merge(m_heap, newNode);
+// emplaceCrop - the node is built from the fields where it will live; a crop
+// the priority function refuses gives its node back right away
+bool Region::emplaceCrop(int ID, int temperature, int moisture, int time, int type) {
+  TRACE_SCOPE(TRACEINSERTCROP);
 
-  // update size
-  m_size++;
+  if (m_heapType == NOTYPE || m_structure == NOSTRUCT || m_priorFunc == nullptr) {
+    return false;
+  }
 
+  Crop* node = newNode(ID, temperature, moisture, time, type);
+  int priority = m_priorFunc(*node);
+  STAT(m_counters.priorityCalls++;)
+  if (priority <= 0) {
+    freeNode(node);
+    return false;
+  }
+  linkNode(node, priority);
   return true;
 }
 
-// return the number of crops in queue
+// insertCrops - inserts a batch of crops, rejecting the same crops insertCrop would
+// the accepted crops are built into one heap by pairwise merging (linear time)
+// and that heap is merged into the queue, instead of one merge per crop
+int Region::insertCrops(const Crop crops[], int count) {
+  // cannot insert into an empty object
+  if (m_heapType == NOTYPE || m_structure == NOSTRUCT || m_priorFunc == nullptr) {
+    return 0;
+  }
+  if (crops == nullptr || count <= 0) {
+    return 0;
+  }
+
+  // create the nodes for the valid crops
+  Crop** nodes = new Crop*[count];
+  int accepted = 0;
+  bool timed = false;   // some crop brings its own deadline
+  for (int i = 0; i < count; i++) {
+    timed = timed || crops[i].m_deadline != 0;
+    if (crops[i].m_deadline != 0 && crops[i].m_deadline <= m_wheel.now()) {
+      continue;
+    }
+    // if priority is invalid (<=0), do not insert
+    STAT(m_counters.priorityCalls++;)
+    int priority = m_priorFunc(crops[i]);
+    if (priority <= 0) {
+      continue;
+    }
+    Crop* node = newNode(crops[i]);
+    node->m_npl = 0;
+    node->m_epoch = m_wheel.now();
+    node->m_key = keyOf(*node, priority);
+    addDeadline(node);
+    nodes[accepted++] = node;
+    tally(crops[i], 1);
+  }
+
+  // build the batch and merge it into the existing heap
+  mergeNodes(nodes, accepted);
+  m_size += accepted;
+
+  if (m_journal != nullptr && accepted > 0) {
+    m_journal->logCrops(timed ? OPINSERTTIMEDCROPS : OPINSERTCROPS, m_journalTag, crops, count);
+  }
+
+  delete[] nodes;
+  migrate(m_rebuildBudget);
+  if (m_autoCompact && accepted > 0) {
+    compact();
+  }
+  return accepted;
+}
+
+// return the number of crops in queue, the expired ones are not counted
 int Region::numCrops() const {
-  return m_size;
+  return m_size - m_expired;
 }
 
 // return the priority function pointer
@@ -174,205 +543,1589 @@ prifn_t Region::getPriorityFn() const {
 
 // removes the node and returns the highest priority crop from the queue
 Crop Region::getNextCrop() {
+  TRACE_SCOPE(TRACENEXTCROP);
+
   // checks if the queue is null
-  if (m_heap == nullptr) {
+  if (numCrops() == 0) {
     throw out_of_range("Region::getNextCrop() called on an empty heap");
   }
 
-  // save the root crop to return
-  Crop rootCrop = *m_heap;
+  // the best of the sub-heap roots, the only heap when not partitioned
+  settle();
+  Crop rootCrop;
+  popHeap(nextPartition(), rootCrop);
 
-  // save the children
-  Crop* leftSub = m_heap->m_left;
-  Crop* rightSub = m_heap->m_right;
-
-  // delete the root node
-  delete m_heap;
-
-  // merge left and right subheaps
-  m_heap = merge(leftSub, rightSub);
-
-  // update size
-  m_size--;
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPNEXTCROP, m_journalTag);
+  }
 
   return rootCrop;
 }
 
-// sets a new priority function, sets corresponding heap type, rebuild the heap, and does not re-allocate memory
-void Region::setPriorityFn(prifn_t priFn, HEAPTYPE heapType) {
-  // checks for priority and heap type if valid
-  if (priFn == nullptr || heapType == NOTYPE) {
-    // clears the variable members out
-    clear();
-    return;
+// popNextCrop - getNextCrop without the exception and the copy it returns
+bool Region::popNextCrop(Crop& out) {
+  TRACE_SCOPE(TRACENEXTCROP);
+
+  if (numCrops() == 0) {
+    return false;
   }
+  settle();
+  popHeap(nextPartition(), out);
 
-  // update configuration
-  m_priorFunc = priFn;
-  m_heapType = heapType;
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPNEXTCROP, m_journalTag);
+  }
+  return true;
+}
 
-  // saving the old heap root
-  Crop* oldHeap = m_heap;
+// getLastCrop - the other end of a min-max heap, over every sub-heap
+Crop Region::getLastCrop() {
+  if (m_structure != MINMAX) {
+    throw domain_error("Region::getLastCrop() needs the MINMAX structure");
+  }
+  if (numCrops() == 0) {
+    throw out_of_range("Region::getLastCrop() called on an empty heap");
+  }
+  settle();
+  Crop lastCrop;
+  popHeap(lastPartition(), lastCrop, true);
 
-  // resetting the region
-  m_heap = nullptr;
-  m_size = 0;
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPLASTCROP, m_journalTag);
+  }
+  return lastCrop;
+}
 
-  // traverse the old heap and reinsert the nodes into the new heap
-  rebuildHeap(oldHeap);
+const Crop& Region::peekLastCrop() const {
+  if (m_structure != MINMAX) {
+    throw domain_error("Region::peekLastCrop() needs the MINMAX structure");
+  }
+  if (numCrops() == 0) {
+    throw out_of_range("Region::peekLastCrop() called on an empty heap");
+  }
+  return *lastNode(lastPartition());
 }
 
-// sets heap to a new structure, rebuilds the heap, and reuses the nodes
-void Region::setStructure(STRUCTURE structure){
-  // checks if the passing parameter structure is valid
-  if (structure == NOSTRUCT) {
-    // clears the variable members out
-    clear();
-    return;
+const Crop& Region::peekNextCrop() {
+  if (numCrops() == 0) {
+    throw out_of_range("Region::peekNextCrop() called on an empty heap");
   }
-  
-  // update configuration
-  m_structure = structure;
+  settle();
+  return *heapAt(nextPartition());
+}
 
-  // rebuild the heap
-  Crop* oldHeap = m_heap;
-  m_heap = nullptr;
-  m_size = 0;
+// removes and returns the highest priority crop of one sub-heap (TIME window)
+Crop Region::getNextCrop(int key) {
+  TRACE_SCOPE(TRACENEXTCROP);
 
-  // transfer the nodes into the new structure
-  rebuildHeap(oldHeap);
-}
+  // checks if the sub-heap exists and has crops
+  settle();
+  if (m_partition == NOPARTITION || key < 0 || key >= numHeaps() || m_part[key] == nullptr) {
+    throw out_of_range("Region::getNextCrop(key) called on an empty sub-heap");
+  }
 
-// returns the structure of the heap
-STRUCTURE Region::getStructure() const {
-  return m_structure;
-}
+  Crop rootCrop = popHeap(key);
 
-// returns the heap type of the heap
-HEAPTYPE Region::getHeapType() const {
-  return m_heapType;
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPNEXTCROPIN, m_journalTag, key);
+  }
+
+  return rootCrop;
 }
 
-// prints the contents of the queue using preorder traversal 
-// first crop printed should have the highest priority
-void Region::printCropsQueue() const {
-  if (m_heap == nullptr) {
-    cout << "Empty heap" << endl;
-    return;
+// returns the number of crops in one sub-heap
+int Region::numCrops(int key) const {
+  if (m_partition == NOPARTITION || key < 0 || key >= numHeaps()) {
+    return 0;
   }
-  
-  // recursively prints the heap in preorder traversal
-  printHelper(m_heap);
+  return m_partSize[key];
 }
 
-void Region::dump() const {
-  if (m_size == 0) {
-    cout << "Empty heap.\n" ;
-  } else {
-    cout << "Region " << m_regPrior << ": => ";
-    dump(m_heap);
+// getNextCrops - pops up to n crops of one sub-heap, e.g. the next n CITRUS crops
+int Region::getNextCrops(int key, int n, Crop crops[]) {
+  if (crops == nullptr) {
+    return 0;
   }
-  cout << endl;
+  settle();   // expired pending crops are dropped, the sub-heap sizes are exact
+  int count = 0;
+  while (count < n && numCrops(key) > 0) {
+    crops[count++] = getNextCrop(key);
+  }
+  return count;
 }
 
-void Region::dump(Crop *pos) const {
-  if ( pos != nullptr ) {
-    cout << "(";
-    dump(pos->m_left);
-    if (m_structure == SKEW)
-        cout << m_priorFunc(*pos) << ":" << pos->m_cropID;
-    else
-        cout << m_priorFunc(*pos) << ":" << pos->m_cropID << ":" << pos->m_npl;
-    dump(pos->m_right);
-    cout << ")";
+// getCropBatch - pops the next n crops and groups them by plant type for a valve bank
+// the grouping is a stable counting sort, so each group stays in priority order
+int Region::getCropBatch(int n, Crop crops[], int groupStart[]) {
+  if (crops == nullptr || groupStart == nullptr) {
+    return 0;
+  }
+  int count = (n < numCrops()) ? n : numCrops();
+  if (count < 0) {
+    count = 0;
   }
-}
 
-ostream& operator<<(ostream& sout, const Crop& crop) {
-  sout << "Crop ID: " << crop.getCropID() 
-        << ", current temperature: " << crop.getTemperature()
-        << ", current soil moisture: " << crop.getMoisture() << "%"
-        << ", current time: " << crop.getTimeString()
-        << ", plant type: " << crop.getTypeString();
-  return sout;
-}
+  Crop* popped = new Crop[count > 0 ? count : 1];
+  for (int i = 0; i < count; i++) {
+    popped[i] = getNextCrop();
+  }
 
-/******************************************
-* Private function *
-******************************************/
-// helper function that recursively delete the nodes in the tree
-void Region::clearHeap(Crop* node) {
-  // checks if node is already null
-  if (node == nullptr) {
-    return;
+  // count the crops of every type, then turn the counts into group starts
+  for (int type = 0; type <= MAXTYPE + 1; type++) {
+    groupStart[type] = 0;
+  }
+  for (int i = 0; i < count; i++) {
+    groupStart[popped[i].m_type + 1]++;
+  }
+  for (int type = 0; type <= MAXTYPE; type++) {
+    groupStart[type + 1] += groupStart[type];
   }
 
-  // recursively goes down the left and right subtree to delete
-  clearHeap(node->m_left);
-  clearHeap(node->m_right);
+  int next[MAXTYPE + 1];
+  for (int type = 0; type <= MAXTYPE; type++) {
+    next[type] = groupStart[type];
+  }
+  for (int i = 0; i < count; i++) {
+    crops[next[popped[i].m_type]++] = popped[i];
+  }
 
-  delete node;
+  delete[] popped;
+  return count;
 }
 
-// helper function that can recurisvely clone the data
-Crop* Region::copyHeap(Crop* node) {
-  // checks if node is already null
-  if (node == nullptr) {
-    return nullptr;
+// setPartition - moves every crop into the sub-heaps of the new partitioning
+void Region::setPartition(PARTITION partition) {
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPREGIONPARTITION, m_journalTag, partition);
   }
+  if (partition == m_partition) {
+    return;
+  }
+  settle();
+
+  // detach the old heaps, then reinsert the nodes by their new key
+  Crop* roots[MAXPARTITIONS];
+  int count = numHeaps();
+  detachHeaps(roots);
+  m_partition = partition;
+  for (int i = 0; i < count; i++) {
+    rebuildHeap(roots[i]);
+  }
+  dropExpired();  // a buried expired crop may have become a root
+  if (m_autoCompact) {
+    compact();
+  }
+}
 
-  // create a new node by copying the data
-  Crop* newNode = new Crop (*node);
-
-  // reset children before recursion
-  newNode->m_left = nullptr;
-  newNode->m_right = nullptr;
+PARTITION Region::getPartition() const {
+  return m_partition;
+}
 
-  // recursively copy children
-  newNode->m_left = copyHeap(node->m_left);
-  newNode->m_right = copyHeap(node->m_right);
+// setOrder - orders the crops lexicographically, every node gets its new key in the rebuild
+void Region::setOrder(const CropOrder& order) {
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPREGIONORDER, m_journalTag, order.encode(), order.numFields());
+  }
 
-  return newNode;
-}
+  m_order = order;
+  settle();
 
-// takes two crops and merge them together into 1 heap
-Crop* Region::merge(Crop* h1, Crop* h2) {
-  // checks if either parameter is null
-  if (h1 == nullptr) {
-    return h2;
+  // rebuild the heap, the rebuild relinks every node so none may be shared
+  Crop* oldHeaps[MAXPARTITIONS];
+  detachHeaps(oldHeaps);
+  for (int i = 0; i < numHeaps(); i++) {
+    rebuildHeap(oldHeaps[i]);
   }
-  if (h2 == nullptr) {
-    return h1;
+  dropExpired();
+  if (m_autoCompact) {
+    compact();
   }
+}
 
-  // compare priorities depending on heap type
-  int p1 = m_priorFunc(*h1);
-  int p2 = m_priorFunc(*h2);
+CropOrder Region::getOrder() const {
+  return m_order;
+}
 
-  // if the left subtree is greater than the right subtree, swap if heap type is minheap
-  if (m_heapType == MINHEAP) {
-    if (p1 > p2) {
-      swapValues(h1, h2);
+// stats - the running aggregates, min and max come from the bounded value counts
+CropStats Region::stats() const {
+  CropStats result = m_stats;
+  result.minMoisture = result.maxMoisture = 0;
+  result.minTemperature = result.maxTemperature = 0;
+  for (int i = 0; i <= MAXMOISTURE - MINMOISTURE; i++) {
+    if (m_moistureCount[i] > 0) {
+      if (result.minMoisture == 0) {
+        result.minMoisture = i + MINMOISTURE;
+      }
+      result.maxMoisture = i + MINMOISTURE;
     }
   }
-  // if the right subtree is greater than the left subtree, swap if heap type is maxheap
-  else if (m_heapType == MAXHEAP) {
-    if (p1 < p2) {
-      swapValues(h1, h2);
+  for (int i = 0; i <= MAXTEMP - MINTEMP; i++) {
+    if (m_temperatureCount[i] > 0) {
+      if (result.minTemperature == 0) {
+        result.minTemperature = i + MINTEMP;
+      }
+      result.maxTemperature = i + MINTEMP;
     }
   }
+  return result;
+}
 
-  // recursively merge into the right child
-  h1->m_right = merge(h1->m_right, h2);
+// setArena - new nodes come from the arena, the current ones move there in one pass
+void Region::setArena(CropArena* arena) {
+  settle();
+  m_arena = arena;
+  Crop*** stack = new Crop**[m_size + 1];
+  for (int i = 0; i < numHeaps(); i++) {
+    relocate(heapAt(i), stack);
+  }
+  delete[] stack;
+}
 
-  // apply skew rules
-  if (m_structure == SKEW) {
-    // swap children in skew heap
-    swapValues(h1->m_left, h1->m_right);
+CropArena* Region::getArena() const {
+  return m_arena;
+}
+
+// compact - copies the heaps one after the other into one run of nodes,
+// every node in preorder, and frees the scattered originals
+void Region::compact() {
+  settle();
+  if (m_size == 0) {
+    return;
   }
-  // apply leftist rules
-  else if (m_structure == LEFTIST) {
-    // ensure leftist property: npl(left) >= npl(right)
+  CropArena* target = m_arena;
+  if (target == nullptr) {
+    target = CropArena::createBlock(m_size);
+  }
+  else {
+    target->reserveRun(m_size);
+  }
+
+  Crop*** stack = new Crop**[m_size + 1];
+  for (int i = 0; i < numHeaps(); i++) {
+    compactTree(heapAt(i), target, stack);
+  }
+  delete[] stack;
+
+  // every node was shared, the block was never used
+  if (m_arena == nullptr && target->numLive() == 0) {
+    delete target;
+  }
+  else if (m_arena != nullptr) {
+    target->reserveRun(0);  // the shared nodes left part of the run unused
+  }
+}
+
+void Region::setAutoCompact(bool autoCompact) {
+  m_autoCompact = autoCompact;
+}
+
+bool Region::isAutoCompact() const {
+  return m_autoCompact;
+}
+
+// setRebuildBudget - a budget of 0 finishes a pending rebuild now
+void Region::setRebuildBudget(int nodesPerCall) {
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPREGIONBUDGET, m_journalTag, nodesPerCall);
+  }
+  m_rebuildBudget = (nodesPerCall > 0) ? nodesPerCall : 0;
+  if (m_rebuildBudget == 0) {
+    settle();
+  }
+}
+
+int Region::getRebuildBudget() const {
+  return m_rebuildBudget;
+}
+
+int Region::numPending() const {
+  return m_pendingCrops;
+}
+
+// rebuildStep - one budget of rebuild work, e.g. while a valve is open
+int Region::rebuildStep() {
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPREBUILDSTEP, m_journalTag);
+  }
+  migrate(m_rebuildBudget);
+  return m_pendingCrops;
+}
+
+// expire - the wheel tells how many deadlines the clock passed; the crops stay
+// where they are until a purge or a pop reaches them
+int Region::expire(int now) {
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPEXPIRE, m_journalTag, now);
+  }
+  int expired = (int)m_wheel.advance(now);
+  m_expired += expired;
+  dropExpired();
+  return expired;
+}
+
+int Region::getTime() const {
+  return m_wheel.now();
+}
+
+// setTTL - applies to crops inserted from now on
+void Region::setTTL(int ttl) {
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPREGIONTTL, m_journalTag, ttl);
+  }
+  m_ttl = (ttl > 0) ? ttl : 0;
+}
+
+int Region::getTTL() const {
+  return m_ttl;
+}
+
+// setAging - the crops already queued are re-keyed with their own epochs
+void Region::setAging(int rate) {
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPREGIONAGING, m_journalTag, rate);
+  }
+  if (rate < 0) rate = 0;
+  if (rate > MAXAGING) rate = MAXAGING;
+  if (rate == m_aging) {
+    return;
+  }
+  m_aging = rate;
+  if (m_order.empty() && m_priorFunc != nullptr) {
+    rekeyAll(false);
+  }
+}
+
+int Region::getAging() const {
+  return m_aging;
+}
+
+// agedPriority - the priority minus (MINHEAP) or plus (MAXHEAP) the age bonus
+long long Region::agedPriority(const Crop& crop) const {
+  if (m_priorFunc == nullptr) {
+    return 0;
+  }
+  long long bonus = (long long)m_aging * (m_wheel.now() - crop.m_epoch);
+  long long priority = m_priorFunc(crop);
+  return (m_heapType == MAXHEAP) ? priority + bonus : priority - bonus;
+}
+
+// sets a new priority function, sets corresponding heap type, rebuild the heap, and does not re-allocate memory
+void Region::setPriorityFn(prifn_t priFn, HEAPTYPE heapType) {
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPREGIONPRIORITY, m_journalTag, m_journal->registerPriorityFn(priFn), heapType);
+  }
+
+  // checks for priority and heap type if valid
+  if (priFn == nullptr || heapType == NOTYPE) {
+    // clears the variable members out
+    emptyHeap();
+    return;
+  }
+
+  // the keys stay valid if they come from a CropOrder or nothing changed
+  if (!m_order.empty() || (priFn == m_priorFunc && heapType == m_heapType)) {
+    m_priorFunc = priFn;
+    m_heapType = heapType;
+    return;
+  }
+  // only the heap type flips: every priority stays, every key changes sign
+  // (not an aged key, its age does not flip)
+  bool flip = (priFn == m_priorFunc && m_numPending == 0 && m_aging == 0);
+
+  // update configuration
+  m_priorFunc = priFn;
+  m_heapType = heapType;
+  rekeyAll(flip);
+}
+
+// sets heap to a new structure, rebuilds the heap, and reuses the nodes
+void Region::setStructure(STRUCTURE structure){
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPREGIONSTRUCTURE, m_journalTag, structure);
+  }
+
+  // checks if the passing parameter structure is valid
+  if (structure == NOSTRUCT) {
+    // clears the variable members out
+    emptyHeap();
+    return;
+  }
+  
+  if (structure == m_structure) {
+    return;
+  }
+  // a pending rebuild is finished under the old structure, its heaps are
+  // what the new one is built from
+  if (m_structure == MINMAX || structure == MINMAX) {
+    settle();
+  }
+  STRUCTURE from = m_structure;
+  m_structure = structure;
+
+  // a min-max heap is no heap of the others and the other way round:
+  // the nodes are listed and built into the new structure in linear time
+  if (from == MINMAX || structure == MINMAX) {
+    Crop** nodes = new Crop*[m_size > 0 ? m_size : 1];
+    for (int i = 0; i < numHeaps(); i++) {
+      int count = detachNodes(heapAt(i), nodes);
+      heapAt(i) = nullptr;
+      m_partSize[i] = 0;
+      addNodes(i, nodes, count);
+    }
+    delete[] nodes;
+    dropExpired();
+  }
+  // every leftist heap is a skew heap, a skew heap only needs its npl values;
+  // pending crops are merged under the new structure when they move
+  else if (structure == LEFTIST && m_size > 0) {
+    Crop*** stack = new Crop**[m_size + 1];
+    Crop** nodes = new Crop*[m_size];
+    for (int i = 0; i < numHeaps(); i++) {
+      fixLeftist(heapAt(i), stack, nodes);
+    }
+    delete[] stack;
+    delete[] nodes;
+  }
+  else {
+    return;
+  }
+  if (m_autoCompact) {
+    compact();    // the nodes moved, or swapped children broke the preorder runs
+  }
+}
+
+// returns the structure of the heap
+STRUCTURE Region::getStructure() const {
+  return m_structure;
+}
+
+// returns the heap type of the heap
+HEAPTYPE Region::getHeapType() const {
+  return m_heapType;
+}
+
+// prints the contents of the queue using preorder traversal 
+// first crop printed should have the highest priority
+void Region::printCropsQueue() const {
+  if (numCrops() == 0) {
+    cout << "Empty heap" << endl;
+    return;
+  }
+  
+  // recursively prints the heap in preorder traversal, sub-heap by sub-heap,
+  // then the crops a rebuild has not reached yet
+  for (int i = 0; i < numHeaps(); i++) {
+    printHelper(heapAt(i));
+  }
+  for (int i = 0; i < m_numPending; i++) {
+    printHelper(m_pending[i]);
+  }
+}
+
+void Region::dump() const {
+  if (m_size == 0) {
+    cout << "Empty heap.\n" ;
+  } else {
+    cout << "Region " << m_regPrior << ": => ";
+    if (m_partition == NOPARTITION) {
+      dump(m_heap);
+    }
+    else {
+      for (int i = 0; i < numHeaps(); i++) {
+        cout << "[" << i << "]";
+        dump(m_part[i]);
+      }
+    }
+    if (m_numPending > 0) {
+      cout << " pending: ";
+      for (int i = 0; i < m_numPending; i++) {
+        dump(m_pending[i]);
+      }
+    }
+  }
+  cout << endl;
+#ifdef IRRIGATOR_STATS
+  RegionCounters c = counters();
+  cout << "  merges: " << c.merges << ", merge steps: " << c.mergeSteps
+       << ", max merge depth: " << c.maxMergeDepth << ", right spine: " << c.rightSpine
+       << ", priority calls: " << c.priorityCalls << ", allocs: " << c.nodeAllocs
+       << ", frees: " << c.nodeFrees << endl;
+#endif
+}
+
+void Region::dump(Crop *pos) const {
+  if ( pos != nullptr ) {
+    cout << "(";
+    dump(pos->m_left);
+    if (m_structure != LEFTIST)
+        cout << m_priorFunc(*pos) << ":" << pos->m_cropID;
+    else
+        cout << m_priorFunc(*pos) << ":" << pos->m_cropID << ":" << pos->m_npl;
+    dump(pos->m_right);
+    cout << ")";
+  }
+}
+
+// counters - the hot-path counters of this region, the right spine is measured now
+RegionCounters Region::counters() const {
+  RegionCounters result = RegionCounters();
+#ifdef IRRIGATOR_STATS
+  result = m_counters;
+  for (int i = 0; i < numHeaps(); i++) {
+    for (Crop* node = heapAt(i); node != nullptr; node = node->m_right) {
+      result.rightSpine++;
+    }
+  }
+#endif
+  return result;
+}
+
+// setPersistent - changes how later copies are made, sharing is safe in both modes
+void Region::setPersistent(bool persistent) {
+  m_persistent = persistent;
+}
+
+bool Region::isPersistent() const {
+  return m_persistent;
+}
+
+// attaches the region to a write-ahead log, the current contents are logged
+// first so the log does not depend on how the region was built
+void Region::setJournal(Journal* journal, int tag) {
+  m_journal = journal;
+  m_journalTag = tag;
+  if (m_journal != nullptr) {
+    m_journal->logRegion(OPASSIGN, m_journalTag, *this);
+  }
+}
+
+ostream& operator<<(ostream& sout, const Crop& crop) {
+  sout << "Crop ID: " << crop.getCropID() 
+        << ", current temperature: " << crop.getTemperature()
+        << ", current soil moisture: " << crop.getMoisture() << "%"
+        << ", current time: " << crop.getTimeString()
+        << ", plant type: " << crop.getTypeString();
+  return sout;
+}
+
+/******************************************
+* Private function *
+******************************************/
+// deletes every node without logging, used wherever emptying is part of another operation
+void Region::emptyHeap() {
+  for (int i = 0; i < numHeaps(); i++) {
+    clearHeap(heapAt(i));  // recursively delete the nodes
+    heapAt(i) = nullptr;   // set the root of the heap to empty
+    m_partSize[i] = 0;
+  }
+  for (int i = 0; i < m_numPending; i++) {
+    clearHeap(m_pending[i]);
+  }
+  m_numPending = 0;
+  m_pendingCrops = 0;
+  m_size = 0;         // no crops
+  m_wheel.clear();    // and no deadlines, the clock stays
+  m_expired = 0;
+  resetStats();
+}
+
+// pushes a subtree on the pending stack, the stack takes over its reference
+void Region::pushPending(Crop* node) {
+  if (m_numPending == m_pendingCapacity) {
+    int capacity = (m_pendingCapacity == 0) ? 16 : m_pendingCapacity * 2;
+    Crop** pending = new Crop*[capacity];
+    for (int i = 0; i < m_numPending; i++) {
+      pending[i] = m_pending[i];
+    }
+    delete[] m_pending;
+    m_pending = pending;
+    m_pendingCapacity = capacity;
+  }
+  m_pending[m_numPending++] = node;
+}
+
+// moves up to count pending crops into the heaps, one merge each; a crop's
+// children go on the stack, so it holds every subtree not reached yet
+void Region::migrate(int count) {
+  while (count > 0 && m_numPending > 0) {
+    Crop* node = ownNode(m_pending[--m_numPending]);
+    if (node->m_left != nullptr) pushPending(node->m_left);
+    if (node->m_right != nullptr) pushPending(node->m_right);
+    node->m_left = nullptr;
+    node->m_right = nullptr;
+    node->m_npl = 0;
+    m_pendingCrops--;
+    count--;
+    int key = partitionOf(*node);
+    if (releaseExpired(node)) {
+      m_partSize[key]--;    // an expired crop is dropped instead of moved
+      continue;
+    }
+    STAT(m_counters.priorityCalls++;)
+    node->m_key = keyOf(*node, m_priorFunc(*node));
+
+    addNode(key, node);
+  }
+}
+
+// finishes a pending rebuild: every pending crop gets its key and they are
+// built into one heap per sub-heap in linear time, then merged in.
+// With negateKeys only the heap type changed, the old key is negated instead.
+void Region::settle(bool negateKeys) {
+  if (m_numPending == 0) {
+    return;
+  }
+  Crop** nodes = new Crop*[m_pendingCrops];
+  int count = 0;
+  while (m_numPending > 0) {
+    Crop* node = ownNode(m_pending[--m_numPending]);
+    if (node->m_left != nullptr) pushPending(node->m_left);
+    if (node->m_right != nullptr) pushPending(node->m_right);
+    node->m_left = nullptr;
+    node->m_right = nullptr;
+    node->m_npl = 0;
+    m_partSize[partitionOf(*node)]--;   // mergeNodes counts it again
+    if (releaseExpired(node)) {
+      continue;
+    }
+    if (negateKeys) {
+      node->m_key = -node->m_key;
+    }
+    else {
+      STAT(m_counters.priorityCalls++;)
+      node->m_key = keyOf(*node, m_priorFunc(*node));
+    }
+    nodes[count++] = node;
+  }
+  m_pendingCrops = 0;
+  mergeNodes(nodes, count);
+  delete[] nodes;
+}
+
+// every crop gets a new key: the heaps join the pending subtrees, incrementally
+// later calls move them, otherwise they are re-keyed and built into new heaps
+// in linear time
+void Region::rekeyAll(bool negateKeys) {
+  for (int i = 0; i < numHeaps(); i++) {
+    if (heapAt(i) != nullptr) {
+      pushPending(heapAt(i));
+      heapAt(i) = nullptr;
+    }
+  }
+  m_pendingCrops = m_size;
+  if (m_rebuildBudget > 0 && m_structure != MINMAX) {
+    return;   // a min-max heap cannot take crops one merge at a time
+  }
+  settle(negateKeys);
+  if (m_autoCompact) {
+    compact();
+  }
+}
+
+// builds detached, keyed nodes into heaps and merges them in, grouped by
+// sub-heap when partitioned (counting sort); m_size is left to the caller
+void Region::mergeNodes(Crop* nodes[], int count) {
+  if (count <= 0) {
+    return;
+  }
+  if (m_partition == NOPARTITION) {
+    addNodes(0, nodes, count);
+    return;
+  }
+
+  int start[MAXPARTITIONS + 1] = {0};
+  for (int i = 0; i < count; i++) {
+    start[partitionOf(*nodes[i]) + 1]++;
+  }
+  for (int key = 0; key < numHeaps(); key++) {
+    start[key + 1] += start[key];
+  }
+  Crop** grouped = new Crop*[count];
+  int next[MAXPARTITIONS];
+  for (int key = 0; key < numHeaps(); key++) {
+    next[key] = start[key];
+  }
+  for (int i = 0; i < count; i++) {
+    grouped[next[partitionOf(*nodes[i])]++] = nodes[i];
+  }
+  for (int key = 0; key < numHeaps(); key++) {
+    int size = start[key + 1] - start[key];
+    if (size > 0) {
+      addNodes(key, grouped + start[key], size);
+    }
+  }
+  delete[] grouped;
+}
+
+// copies a tree into the target in preorder without recursion, a skew heap
+// may be as deep as it is large. The stack holds the links still pointing at
+// old nodes (left on top) and has room for one per node plus one; root is
+// relinked in place, like the children.
+void Region::compactTree(Crop*& root, CropArena* target, Crop*** stack) {
+  int top = 0;
+  stack[top++] = &root;
+  while (top > 0) {
+    Crop** link = stack[--top];
+    Crop* old = *link;
+    if (old == nullptr || old->m_refs > 1) {
+      continue;   // a shared subtree stays where it is
+    }
+    Crop* moved = target->allocate(*old);
+    STAT(m_counters.nodeAllocs++;)
+    moved->m_left = old->m_left;
+    moved->m_right = old->m_right;
+    freeNode(old);
+    *link = moved;
+    stack[top++] = &moved->m_right;
+    stack[top++] = &moved->m_left;
+  }
+}
+
+// turns a skew heap into a leftist heap without moving a crop: the nodes are
+// listed in preorder, so walking the list backwards sees the children of a
+// node before the node, which gets its npl and its larger-npl child on the
+// left. O(n) and no recursion, a skew heap may be as deep as it is large.
+void Region::fixLeftist(Crop*& root, Crop*** stack, Crop** nodes) {
+  int top = 0;
+  int count = 0;
+  stack[top++] = &root;
+  while (top > 0) {
+    Crop** link = stack[--top];
+    if (*link == nullptr) {
+      continue;
+    }
+    *link = ownNode(*link);   // the swaps below must not change another version
+    nodes[count++] = *link;
+    stack[top++] = &(*link)->m_right;
+    stack[top++] = &(*link)->m_left;
+  }
+  for (int i = count - 1; i >= 0; i--) {
+    Crop* node = nodes[i];
+    int leftNpl = node->m_left ? node->m_left->m_npl : -1;
+    int rightNpl = node->m_right ? node->m_right->m_npl : -1;
+    if (leftNpl < rightNpl) {
+      swapValues(node->m_left, node->m_right);
+    }
+    node->m_npl = 1 + minValue(leftNpl, rightNpl);
+  }
+}
+
+// a node holding a copy of crop with no children, from the arena when there is one
+Crop* Region::newNode(const Crop& crop) {
+  STAT(m_counters.nodeAllocs++;)
+  if (m_arena != nullptr) {
+    return m_arena->allocate(crop);
+  }
+  Crop* node = new Crop(crop);
+  node->m_left = nullptr;
+  node->m_right = nullptr;
+  node->m_refs = 1;
+  node->m_arena = nullptr;
+  return node;
+}
+
+// a node built in place from the crop fields, from the arena when there is one
+Crop* Region::newNode(int ID, int temperature, int moisture, int time, int type) {
+  STAT(m_counters.nodeAllocs++;)
+  if (m_arena != nullptr) {
+    return m_arena->emplace(ID, temperature, moisture, time, type);
+  }
+  return new Crop(ID, temperature, moisture, time, type);
+}
+
+// merges a new node of the given priority into its sub-heap, the tail of every insert
+void Region::linkNode(Crop* node, int priority) {
+  // initialize the node fields
+  node->m_npl = 0;
+  node->m_epoch = m_wheel.now();
+  node->m_key = keyOf(*node, priority);
+
+  // update size; counted and logged first, a min-max insert moves crops between nodes
+  int key = partitionOf(*node);
+  addDeadline(node);
+  tally(*node, 1);
+  if (m_journal != nullptr) {
+    m_journal->logCrop((node->m_deadline != 0) ? OPINSERTTIMED : OPINSERTCROP, m_journalTag, *node);
+  }
+
+  // merge the new node into the existing heap (its sub-heap when partitioned)
+  addNode(key, node);
+  m_size++;
+  m_partSize[key]++;
+  migrate(m_rebuildBudget);
+}
+
+// a new node without a deadline gets the TTL, its deadline goes into the wheel;
+// a clock too close to INT_MAX for the TTL leaves it without one
+void Region::addDeadline(Crop* node) {
+  if (node->m_deadline == 0 && m_ttl > 0) {
+    int now = m_wheel.now();
+    node->m_deadline = (now > INT_MAX - m_ttl) ? INT_MAX : now + m_ttl;
+  }
+  if (node->m_deadline != 0 && !m_wheel.add(node->m_deadline)) {
+    node->m_deadline = 0;
+  }
+}
+
+// enters the deadlines of a tree in the wheel and counts the ones the clock
+// passed, used when nodes come from outside (journal); the stack has room
+// for one node per crop plus one
+void Region::addDeadlines(Crop* root, Crop** stack) {
+  int top = 0;
+  if (root != nullptr) stack[top++] = root;
+  while (top > 0) {
+    Crop* node = stack[--top];
+    if (isExpired(*node)) {
+      m_expired++;
+    }
+    else if (node->m_deadline != 0) {
+      m_wheel.add(node->m_deadline);
+    }
+    if (node->m_right != nullptr) stack[top++] = node->m_right;
+    if (node->m_left != nullptr) stack[top++] = node->m_left;
+  }
+}
+
+bool Region::isExpired(const Crop& crop) const {
+  return crop.m_deadline != 0 && crop.m_deadline <= m_wheel.now();
+}
+
+// frees a detached node whose deadline passed and takes it out of the counts,
+// the caller fixes the sub-heap size; false (the node stays) if it is live
+bool Region::releaseExpired(Crop* node) {
+  if (!isExpired(*node)) {
+    return false;
+  }
+  tally(*node, -1);
+  m_size--;
+  m_expired--;
+  freeNode(node);
+  return true;
+}
+
+// pops the expired crops off the top of a sub-heap (both ends of a min-max
+// heap), so every root a pop, a peek or an irrigator looks at is live
+void Region::trimExpired(int key) {
+  Crop expired;
+  while (m_expired > 0 && heapAt(key) != nullptr) {
+    if (isExpired(*heapAt(key))) {
+      takeCrop(key, expired);
+    }
+    else if (m_structure == MINMAX && isExpired(*lastNode(key))) {
+      takeCrop(key, expired, true);
+    }
+    else {
+      return;
+    }
+  }
+}
+
+// after the clock moved, expired crops came in or the heaps were rebuilt:
+// more than half expired are purged, otherwise only the tops are cleared
+void Region::dropExpired() {
+  if (m_expired == 0) {
+    return;
+  }
+  if ((long long)m_expired * 2 > m_size) {
+    purge();
+    return;
+  }
+  for (int i = 0; i < numHeaps(); i++) {
+    trimExpired(i);
+  }
+}
+
+// frees every expired crop and builds the live ones back into their sub-heaps,
+// O(n) for more than n/2 expiries
+void Region::purge() {
+  settle();
+  Crop** nodes = new Crop*[m_size > 0 ? m_size : 1];
+  for (int i = 0; i < numHeaps(); i++) {
+    int count = detachNodes(heapAt(i), nodes);
+    heapAt(i) = nullptr;
+    m_partSize[i] = 0;
+    int live = 0;
+    for (int j = 0; j < count; j++) {
+      if (!releaseExpired(nodes[j])) {
+        nodes[live++] = nodes[j];
+      }
+    }
+    addNodes(i, nodes, live);
+  }
+  delete[] nodes;
+  if (m_autoCompact) {
+    compact();
+  }
+}
+
+// puts a detached, keyed node into a sub-heap: a merge, or a min-max insert;
+// the caller counts it
+void Region::addNode(int key, Crop* node) {
+  if (m_structure == MINMAX) {
+    minMaxInsert(key, node);
+    return;
+  }
+  STAT(m_counters.merges++;)
+  heapAt(key) = merge(heapAt(key), node);
+}
+
+// adds detached, keyed nodes to a sub-heap and counts them. Trees build them
+// into one heap and merge it in. A min-max heap takes a few nodes one by one
+// and is rebuilt with the new nodes in linear time when that is cheaper.
+void Region::addNodes(int key, Crop* nodes[], int count) {
+  if (count <= 0) {
+    return;
+  }
+  if (m_structure != MINMAX) {
+    STAT(m_counters.merges++;)
+    heapAt(key) = merge(heapAt(key), buildHeap(nodes, count));
+    m_partSize[key] += count;
+    return;
+  }
+
+  int size = m_partSize[key];
+  if ((long long)count * levelOf(size + count) < size) {
+    for (int i = 0; i < count; i++) {
+      minMaxInsert(key, nodes[i]);
+      m_partSize[key]++;
+    }
+    return;
+  }
+  Crop** all = new Crop*[size + count];
+  int listed = detachNodes(heapAt(key), all);
+  for (int i = 0; i < count; i++) {
+    all[listed + i] = nodes[i];
+  }
+  heapAt(key) = buildMinMax(all, listed + count);
+  m_partSize[key] = listed + count;
+  delete[] all;
+}
+
+// lists the nodes of a tree breadth first, the list is its own queue; every
+// node is made private and detached (no children, npl 0). Returns the count.
+int Region::detachNodes(Crop* root, Crop* nodes[]) {
+  if (root == nullptr) {
+    return 0;
+  }
+  int count = 0;
+  nodes[count++] = ownNode(root);
+  for (int i = 0; i < count; i++) {
+    Crop* node = nodes[i];
+    if (node->m_left != nullptr) nodes[count++] = ownNode(node->m_left);
+    if (node->m_right != nullptr) nodes[count++] = ownNode(node->m_right);
+    node->m_left = nullptr;
+    node->m_right = nullptr;
+    node->m_npl = 0;
+  }
+  return count;
+}
+
+// returns a node to wherever it came from, which may be another region's arena
+void Region::freeNode(Crop* node) {
+  STAT(m_counters.nodeFrees++;)
+  if (node->m_arena != nullptr) {
+    node->m_arena->release(node);
+  }
+  else {
+    delete node;
+  }
+}
+
+// moves the nodes of a tree into this region's arena, root is relinked in
+// place; a shared node stays where it is, together with everything below it.
+// Preorder without recursion like compactTree, the stack has room for one
+// link per node plus one.
+void Region::relocate(Crop*& root, Crop*** stack) {
+  int top = 0;
+  stack[top++] = &root;
+  while (top > 0) {
+    Crop** link = stack[--top];
+    Crop* node = *link;
+    if (node == nullptr || node->m_refs > 1) {
+      continue;
+    }
+    if (node->m_arena != m_arena) {
+      Crop* moved = newNode(*node);
+      moved->m_left = node->m_left;
+      moved->m_right = node->m_right;
+      freeNode(node);
+      *link = moved;
+      node = moved;
+    }
+    stack[top++] = &node->m_right;
+    stack[top++] = &node->m_left;
+  }
+}
+
+// helper function that recursively delete the nodes in the tree
+// a node shared with another region only loses this reference
+void Region::clearHeap(Crop* node) {
+  // checks if node is already null
+  if (node == nullptr) {
+    return;
+  }
+  if (--node->m_refs > 0) {
+    return;
+  }
+
+  // recursively goes down the left and right subtree to delete
+  clearHeap(node->m_left);
+  clearHeap(node->m_right);
+
+  freeNode(node);
+}
+
+// helper function that can recurisvely clone the data
+Crop* Region::copyHeap(Crop* node) {
+  // checks if node is already null
+  if (node == nullptr) {
+    return nullptr;
+  }
+
+  // create a new node by copying the data, its children are not copied yet
+  Crop* copy = newNode(*node);
+
+  // recursively copy children
+  copy->m_left = copyHeap(node->m_left);
+  copy->m_right = copyHeap(node->m_right);
+
+  return copy;
+}
+
+// copies rhs's heaps into this empty region, or shares them when persistent
+void Region::copyHeaps(const Region& rhs) {
+  m_partition = rhs.m_partition;
+  for (int i = 0; i < MAXPARTITIONS; i++) {
+    m_partSize[i] = rhs.m_partSize[i];
+  }
+  m_stats = rhs.m_stats;
+  for (int i = 0; i <= MAXMOISTURE - MINMOISTURE; i++) {
+    m_moistureCount[i] = rhs.m_moistureCount[i];
+  }
+  for (int i = 0; i <= MAXTEMP - MINTEMP; i++) {
+    m_temperatureCount[i] = rhs.m_temperatureCount[i];
+  }
+
+  for (int i = 0; i < numHeaps(); i++) {
+    if (m_persistent) {
+      heapAt(i) = rhs.heapAt(i);    // share the nodes
+      if (heapAt(i) != nullptr) {
+        heapAt(i)->m_refs++;
+      }
+    }
+    else {
+      heapAt(i) = copyHeap(rhs.heapAt(i));  // recursively copies the nodes
+    }
+  }
+
+  // the subtrees of a pending rebuild, in the same stack order
+  for (int i = 0; i < rhs.m_numPending; i++) {
+    if (m_persistent) {
+      rhs.m_pending[i]->m_refs++;
+      pushPending(rhs.m_pending[i]);
+    }
+    else {
+      pushPending(copyHeap(rhs.m_pending[i]));
+    }
+  }
+  m_pendingCrops = rhs.m_pendingCrops;
+}
+
+// takes over the crops of rhs and its configuration without copying a node,
+// rhs is left empty; the journal stays with each region
+void Region::moveFrom(Region& rhs) {
+  emptyHeap();
+  m_size = rhs.m_size;
+  m_priorFunc = rhs.m_priorFunc;
+  m_heapType = rhs.m_heapType;
+  m_structure = rhs.m_structure;
+  m_regPrior = rhs.m_regPrior;
+  m_persistent = rhs.m_persistent;
+  m_pass = rhs.m_pass;
+  m_order = rhs.m_order;
+  m_arena = rhs.m_arena;
+  m_autoCompact = rhs.m_autoCompact;
+  m_rebuildBudget = rhs.m_rebuildBudget;
+  m_ttl = rhs.m_ttl;
+  m_expired = rhs.m_expired;
+  m_aging = rhs.m_aging;
+  m_wheel.swap(rhs.m_wheel);
+  STAT(m_counters = rhs.m_counters;)
+
+  // the heaps and their counts; the stack arrays swap, each region frees its own
+  m_partition = rhs.m_partition;
+  m_heap = rhs.m_heap;
+  for (int i = 0; i < MAXPARTITIONS; i++) {
+    m_part[i] = rhs.m_part[i];
+    m_partSize[i] = rhs.m_partSize[i];
+    rhs.m_part[i] = nullptr;
+    rhs.m_partSize[i] = 0;
+  }
+  m_stats = rhs.m_stats;
+  for (int i = 0; i <= MAXMOISTURE - MINMOISTURE; i++) {
+    m_moistureCount[i] = rhs.m_moistureCount[i];
+  }
+  for (int i = 0; i <= MAXTEMP - MINTEMP; i++) {
+    m_temperatureCount[i] = rhs.m_temperatureCount[i];
+  }
+  Crop** pending = m_pending;
+  int capacity = m_pendingCapacity;
+  m_pending = rhs.m_pending;
+  m_pendingCapacity = rhs.m_pendingCapacity;
+  m_numPending = rhs.m_numPending;
+  m_pendingCrops = rhs.m_pendingCrops;
+  rhs.m_pending = pending;
+  rhs.m_pendingCapacity = capacity;
+
+  // leave rhs empty
+  rhs.m_heap = nullptr;
+  rhs.m_numPending = 0;
+  rhs.m_pendingCrops = 0;
+  rhs.m_size = 0;
+  rhs.m_expired = 0;
+  rhs.m_wheel.clear();
+  rhs.resetStats();
+}
+
+// true if mergeWithQueue would take rhs
+bool Region::sameConfig(const Region& rhs) const {
+  return m_priorFunc == rhs.m_priorFunc && m_structure == rhs.m_structure && m_heapType == rhs.m_heapType
+      && m_partition == rhs.m_partition && m_order == rhs.m_order && m_aging == rhs.m_aging;
+}
+
+// number of heaps the crops are split into, 1 when not partitioned
+int Region::numHeaps() const {
+  if (m_partition == BYTIME) {
+    return MAXTIME + 1;
+  }
+  if (m_partition == BYTYPE) {
+    return MAXTYPE + 1;
+  }
+  return 1;
+}
+
+// root of one sub-heap, m_heap when not partitioned
+Crop*& Region::heapAt(int key) {
+  return (m_partition == NOPARTITION) ? m_heap : m_part[key];
+}
+
+Crop* Region::heapAt(int key) const {
+  return (m_partition == NOPARTITION) ? m_heap : m_part[key];
+}
+
+// the sub-heap a crop belongs to
+int Region::partitionOf(const Crop& crop) const {
+  if (m_partition == BYTIME) {
+    return crop.m_time;
+  }
+  if (m_partition == BYTYPE) {
+    return crop.m_type;
+  }
+  return 0;
+}
+
+// the sub-heap whose root has the smallest key, comparing at most one
+// root per key; -1 if the region is empty
+int Region::nextPartition() const {
+  int best = -1;
+  for (int i = 0; i < numHeaps(); i++) {
+    Crop* root = heapAt(i);
+    if (root != nullptr && (best < 0 || root->m_key < heapAt(best)->m_key)) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+// the key a crop is ordered by: the CropOrder key, otherwise the priority,
+// negated for a max-heap so the smaller key always comes first
+long long Region::keyOf(const Crop& crop, int priority) const {
+  if (!m_order.empty()) {
+    return m_order.key(crop);
+  }
+  long long key = (m_heapType == MAXHEAP) ? -(long long)priority : priority;
+  return key + (long long)m_aging * crop.m_epoch;
+}
+
+// key of the crop getNextCrop would return, LLONG_MAX if the region is empty;
+// an aged key is taken at the clock so regions with other clocks compare
+long long Region::topKey() const {
+  int key = nextPartition();
+  if (key < 0) {
+    return LLONG_MAX;
+  }
+  long long age = m_order.empty() ? (long long)m_aging * m_wheel.now() : 0;
+  return heapAt(key)->m_key - age;
+}
+
+// adds (sign 1) or removes (sign -1) one crop from the aggregates, O(1)
+void Region::tally(const Crop& crop, int sign) {
+  long long moisture = crop.m_moisture;
+  long long temperature = crop.m_temperature;
+  m_stats.count += sign;
+  m_stats.byType[crop.m_type] += sign;
+  m_stats.byTime[crop.m_time] += sign;
+  m_stats.moistureSum += sign * moisture;
+  m_stats.moistureSquares += sign * moisture * moisture;
+  m_stats.temperatureSum += sign * temperature;
+  m_stats.temperatureSquares += sign * temperature * temperature;
+  m_moistureCount[crop.m_moisture - MINMOISTURE] += sign;
+  m_temperatureCount[crop.m_temperature - MINTEMP] += sign;
+}
+
+// adds every crop of a tree to the aggregates, used when nodes come from
+// outside (journal); the stack has room for one node per crop plus one
+void Region::tallyHeap(Crop* root, Crop** stack) {
+  int top = 0;
+  if (root != nullptr) stack[top++] = root;
+  while (top > 0) {
+    Crop* node = stack[--top];
+    tally(*node, 1);
+    if (node->m_right != nullptr) stack[top++] = node->m_right;
+    if (node->m_left != nullptr) stack[top++] = node->m_left;
+  }
+}
+
+void Region::resetStats() {
+  m_stats = CropStats();
+  for (int i = 0; i <= MAXMOISTURE - MINMOISTURE; i++) {
+    m_moistureCount[i] = 0;
+  }
+  for (int i = 0; i <= MAXTEMP - MINTEMP; i++) {
+    m_temperatureCount[i] = 0;
+  }
+}
+
+// recomputes the cached keys of a tree, used when nodes come from outside
+// (journal); the stack has room for one node per crop plus one
+void Region::rekeyHeap(Crop* root, Crop** stack) {
+  int top = 0;
+  if (root != nullptr) stack[top++] = root;
+  while (top > 0) {
+    Crop* node = stack[--top];
+    STAT(m_counters.priorityCalls++;)
+    node->m_key = keyOf(*node, m_priorFunc(*node));
+    if (node->m_right != nullptr) stack[top++] = node->m_right;
+    if (node->m_left != nullptr) stack[top++] = node->m_left;
+  }
+}
+
+// removes the root of one sub-heap and merges its children
+Crop Region::popHeap(int key) {
+  Crop rootCrop;
+  popHeap(key, rootCrop);
+  return rootCrop;
+}
+
+// the root crop of the sub-heap goes to out, before its node is freed;
+// last takes the crop with the largest key instead (MINMAX only). Expired
+// crops that come to the top are dropped right away.
+void Region::popHeap(int key, Crop& out, bool last) {
+  takeCrop(key, out, last);
+  if (m_expired > 0) {
+    trimExpired(key);
+  }
+}
+
+// removes the crop popHeap returns; a crop that leaves before its deadline
+// withdraws it from the wheel
+void Region::takeCrop(int key, Crop& out, bool last) {
+  if (m_structure == MINMAX) {
+    minMaxRemove(key, last, out);
+  }
+  else {
+    Crop*& root = heapAt(key);
+
+    // save the root crop to return
+    out = *root;
+
+    // save the children
+    Crop* leftSub = root->m_left;
+    Crop* rightSub = root->m_right;
+
+    // delete the root node
+    if (root->m_refs == 1) {
+      freeNode(root);
+    }
+    // another region still uses the root, this heap keeps only the children
+    else {
+      root->m_refs--;
+      if (leftSub != nullptr) leftSub->m_refs++;
+      if (rightSub != nullptr) rightSub->m_refs++;
+    }
+
+    // merge left and right subheaps
+    STAT(m_counters.merges++;)
+    root = merge(leftSub, rightSub);
+  }
+
+  // update size
+  m_size--;
+  m_partSize[key]--;
+  tally(out, -1);
+  if (isExpired(out)) {
+    m_expired--;
+  }
+  else if (out.m_deadline != 0) {
+    m_wheel.cancel(out.m_deadline);
+  }
+}
+
+// Min-max heaps are complete binary trees of linked nodes. Node i (1 is the
+// root) has the children 2i and 2i+1, so the bits of i below the leading one
+// are the way down to it (0 left, 1 right). Even levels hold the smallest key
+// of their subtree, odd levels the largest. Nodes stay where they are, the
+// crops move between them; a shared node is copied before it changes.
+
+// adds the node as the next leaf of the sub-heap, then moves its crop up
+// along the path to the root
+void Region::minMaxInsert(int key, Crop* node) {
+  Crop*& root = heapAt(key);
+  if (root == nullptr) {
+    root = node;
+    return;
+  }
+  int index = m_partSize[key] + 1;
+  int level = levelOf(index);
+  Crop* path[32];
+  root = ownNode(root);
+  path[0] = root;
+  for (int bit = level - 1; bit >= 1; bit--) {
+    Crop*& link = ((index >> bit) & 1) ? path[level - bit - 1]->m_right : path[level - bit - 1]->m_left;
+    link = ownNode(link);
+    path[level - bit] = link;
+  }
+  if (index & 1) {
+    path[level - 1]->m_right = node;
+  }
+  else {
+    path[level - 1]->m_left = node;
+  }
+  path[level] = node;
+
+  // on the wrong side of its parent it swaps first, then it only climbs
+  // the levels of its kind (two at a time)
+  bool minLevel = (level % 2 == 0);
+  int pos = level;
+  if (minLevel ? node->m_key > path[pos - 1]->m_key : node->m_key < path[pos - 1]->m_key) {
+    swapCrops(path[pos], path[pos - 1]);
+    pos--;
+    minLevel = !minLevel;
+  }
+  while (pos >= 2 && (minLevel ? path[pos]->m_key < path[pos - 2]->m_key
+                                : path[pos]->m_key > path[pos - 2]->m_key)) {
+    swapCrops(path[pos], path[pos - 2]);
+    pos -= 2;
+  }
+}
+
+// takes the crop of the root, or with last the larger child of the root, into
+// out; the crop of the last leaf takes its place and moves down
+void Region::minMaxRemove(int key, bool last, Crop& out) {
+  Crop*& root = heapAt(key);
+  int index = m_partSize[key];
+  root = ownNode(root);
+  Crop* target = root;
+  bool minLevel = true;
+  if (last && root->m_left != nullptr) {
+    bool right = root->m_right != nullptr && root->m_right->m_key > root->m_left->m_key;
+    Crop*& link = right ? root->m_right : root->m_left;
+    link = ownNode(link);
+    target = link;
+    minLevel = false;
+  }
+  out = *target;
+
+  // unlink the last leaf
+  Crop* leaf = root;
+  if (index == 1) {
+    root = nullptr;
+  }
+  else {
+    Crop* parent = root;
+    for (int bit = levelOf(index) - 1; bit >= 1; bit--) {
+      Crop*& link = ((index >> bit) & 1) ? parent->m_right : parent->m_left;
+      link = ownNode(link);
+      parent = link;
+    }
+    Crop*& link = (index & 1) ? parent->m_right : parent->m_left;
+    leaf = link;
+    link = nullptr;
+  }
+
+  if (leaf != target) {
+    copyCrop(target, *leaf);    // the leaf may still be in another version
+    trickleDown(target, minLevel);
+  }
+  if (leaf->m_refs == 1) {
+    freeNode(leaf);
+  }
+  else {
+    leaf->m_refs--;   // another version still has it
+  }
+}
+
+// moves a crop down from an owned node: on a min level it swaps with the
+// smallest of its children and grandchildren while that one is smaller
+// (largest and larger on a max level)
+void Region::trickleDown(Crop* node, bool minLevel) {
+  while (node->m_left != nullptr) {
+    // the best of the children and grandchildren, and the child above it
+    Crop** bestLink = nullptr;
+    Crop** childLink = nullptr;
+    Crop** links[2] = {&node->m_left, &node->m_right};
+    for (int c = 0; c < 2; c++) {
+      Crop* child = *links[c];
+      if (child == nullptr) {
+        continue;
+      }
+      Crop** candidates[3] = {links[c], &child->m_left, &child->m_right};
+      for (int k = 0; k < 3; k++) {
+        Crop* candidate = *candidates[k];
+        if (candidate != nullptr && (bestLink == nullptr ||
+            (minLevel ? candidate->m_key < (*bestLink)->m_key : candidate->m_key > (*bestLink)->m_key))) {
+          bestLink = candidates[k];
+          childLink = links[c];
+        }
+      }
+    }
+    Crop* best = *bestLink;
+    if (minLevel ? best->m_key >= node->m_key : best->m_key <= node->m_key) {
+      return;
+    }
+
+    // the child is copied first, a grandchild link then points into the copy
+    bool grandchild = (bestLink != childLink);
+    bool leftGrandchild = grandchild && bestLink == &(*childLink)->m_left;
+    *childLink = ownNode(*childLink);
+    Crop* child = *childLink;
+    if (!grandchild) {
+      swapCrops(node, child);
+      return;
+    }
+    Crop*& link = leftGrandchild ? child->m_left : child->m_right;
+    link = ownNode(link);
+    swapCrops(node, link);
+    if (minLevel ? link->m_key > child->m_key : link->m_key < child->m_key) {
+      swapCrops(link, child);
+    }
+    node = link;
+  }
+}
+
+// links detached, private nodes into a complete tree in list order and moves
+// the crops down from the last parent up to the root (Floyd), O(n)
+Crop* Region::buildMinMax(Crop* nodes[], int count) {
+  if (count <= 0) {
+    return nullptr;
+  }
+  for (int i = 1; i <= count; i++) {
+    nodes[i - 1]->m_left = (2 * i <= count) ? nodes[2 * i - 1] : nullptr;
+    nodes[i - 1]->m_right = (2 * i + 1 <= count) ? nodes[2 * i] : nullptr;
+    nodes[i - 1]->m_npl = 0;
+  }
+  for (int i = count / 2; i >= 1; i--) {
+    trickleDown(nodes[i - 1], levelOf(i) % 2 == 0);
+  }
+  return nodes[0];
+}
+
+// the node with the largest key of a min-max sub-heap: the root or a child
+Crop* Region::lastNode(int key) const {
+  Crop* root = heapAt(key);
+  if (root->m_left == nullptr) {
+    return root;
+  }
+  if (root->m_right != nullptr && root->m_right->m_key > root->m_left->m_key) {
+    return root->m_right;
+  }
+  return root->m_left;
+}
+
+// the sub-heap holding the largest key, -1 if the region is empty
+int Region::lastPartition() const {
+  int best = -1;
+  for (int i = 0; i < numHeaps(); i++) {
+    if (heapAt(i) != nullptr && (best < 0 || lastNode(i)->m_key > lastNode(best)->m_key)) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+// level of node index in a complete tree, the root (1) is level 0
+int Region::levelOf(int index) {
+  int level = 0;
+  while (index > 1) {
+    index >>= 1;
+    level++;
+  }
+  return level;
+}
+
+// puts the crop of from into the node to, its links, refs and arena stay
+void Region::copyCrop(Crop* to, const Crop& from) {
+  to->m_cropID = from.m_cropID;
+  to->m_temperature = from.m_temperature;
+  to->m_moisture = from.m_moisture;
+  to->m_time = from.m_time;
+  to->m_type = from.m_type;
+  to->m_deadline = from.m_deadline;
+  to->m_epoch = from.m_epoch;
+  to->m_key = from.m_key;
+}
+
+// swaps the crops of two owned nodes
+void Region::swapCrops(Crop* a, Crop* b) {
+  Crop crop = *a;
+  copyCrop(a, *b);
+  copyCrop(b, crop);
+}
+
+// hands every heap to roots[] as a private tree and leaves the region empty,
+// the caller rebuilds the nodes with rebuildHeap
+void Region::detachHeaps(Crop* roots[]) {
+  for (int i = 0; i < numHeaps(); i++) {
+    roots[i] = ownTree(heapAt(i));
+    heapAt(i) = nullptr;
+    m_partSize[i] = 0;
+  }
+  m_size = 0;
+}
+
+// takes two crops and merge them together into 1 heap
+Crop* Region::merge(Crop* h1, Crop* h2) {
+  // checks if either parameter is null
+  if (h1 == nullptr) {
+    return h2;
+  }
+  if (h2 == nullptr) {
+    return h1;
+  }
+
+  STAT(m_counters.mergeSteps++;)
+  STAT(if (++m_mergeDepth > m_counters.maxMergeDepth) m_counters.maxMergeDepth = m_mergeDepth;)
+
+  // compare the cached keys, the heap type is already folded into them:
+  // the root with the larger key goes to the right
+  if (h1->m_key > h2->m_key) {
+    swapValues(h1, h2);
+  }
+
+  // h1 is about to change, a shared node is copied first (path copying)
+  h1 = ownNode(h1);
+
+  // recursively merge into the right child
+  h1->m_right = merge(h1->m_right, h2);
+
+  // apply skew rules
+  if (m_structure == SKEW) {
+    // swap children in skew heap
+    swapValues(h1->m_left, h1->m_right);
+  }
+  // apply leftist rules
+  else if (m_structure == LEFTIST) {
+    // ensure leftist property: npl(left) >= npl(right)
     int leftNpl = h1->m_left ? h1->m_left->m_npl : -1;
     int rightNpl = h1->m_right ? h1->m_right->m_npl : -1;
     
@@ -388,8 +2141,60 @@ Crop* Region::merge(Crop* h1, Crop* h2) {
     );
 
   }
-
-  return h1;
+
+  STAT(m_mergeDepth--;)
+  return h1;
+}
+
+// builds a heap out of detached nodes in linear time
+// the array is used as a circular queue: the two front heaps are merged and
+// the result is put at the back until one heap is left
+Crop* Region::buildHeap(Crop* nodes[], int count) {
+  if (count <= 0) {
+    return nullptr;
+  }
+
+  int front = 0;
+  int remaining = count;
+  while (remaining > 1) {
+    Crop* a = nodes[front];
+    front = (front + 1) % count;
+    Crop* b = nodes[front];
+    front = (front + 1) % count;
+
+    // the merged heap goes to the back of the queue
+    nodes[(front + remaining - 2) % count] = merge(a, b);
+    remaining--;
+  }
+
+  return nodes[front];
+}
+
+// returns a node this heap may change: the node itself if nobody else uses it,
+// otherwise a private copy that shares the children
+Crop* Region::ownNode(Crop* node) {
+  if (node->m_refs == 1) {
+    return node;
+  }
+
+  Crop* copy = newNode(*node);
+  copy->m_left = node->m_left;
+  copy->m_right = node->m_right;
+  if (copy->m_left != nullptr) copy->m_left->m_refs++;
+  if (copy->m_right != nullptr) copy->m_right->m_refs++;
+  node->m_refs--;
+  return copy;
+}
+
+// makes every node of the tree private to this heap, unshared nodes are kept
+Crop* Region::ownTree(Crop* node) {
+  if (node == nullptr) {
+    return nullptr;
+  }
+  node = ownNode(node);
+  node->m_left = ownTree(node->m_left);
+  node->m_right = ownTree(node->m_right);
+  return node;
 }
 
 // swaps two Crop pointer reference
@@ -411,8 +2216,10 @@ void Region::printHelper(Crop* node) const {
     return;
   }
 
-  // print priority in buckets before crop details
-  cout << "[" << m_priorFunc(*node) << "]" << *node << endl;
+  // print priority in buckets before crop details, an expired crop is not in the queue
+  if (!isExpired(*node)) {
+    cout << "[" << m_priorFunc(*node) << "]" << *node << '\n';   // no flush per crop
+  }
 
   // preorder traversal print
   printHelper(node->m_left);
@@ -437,10 +2244,14 @@ void Region::rebuildHeap(Crop* node) {
   node->m_left = nullptr;
   node->m_right = nullptr;
   node->m_npl = 0;
+  STAT(m_counters.priorityCalls++;)
+  node->m_key = keyOf(*node, m_priorFunc(*node));
 
-  // reinsert node into new heap
-  m_heap = merge(m_heap, node);
+  // reinsert node into new heap, its sub-heap when partitioned
+  int key = partitionOf(*node);
+  addNode(key, node);
   m_size++;
+  m_partSize[key]++;
 
   // recursively rebuild heap on the children
   rebuildHeap(left);
@@ -455,8 +2266,8 @@ int Region::getRegPrior() const {
  
 //////////////////////////////////////////////////////////////
 
-// constructor - initializes an irrigator wuth a given capacity
-Irrigator::Irrigator(int size){
+// constructor - initializes an irrigator wuth a given capacity and schedule
+Irrigator::Irrigator(int size, SCHEDULE schedule){
   // throws invalid arguement if size <= 0
   if (size <= 0) {
     throw invalid_argument("Irrigator size cannot be negative");
@@ -464,132 +2275,77 @@ Irrigator::Irrigator(int size){
   
   m_capacity = size;  // sets the size of the array
   m_size = 0;         // no region objects yet
-
-  // allocat array of Region objects
-  m_heap = new Region[m_capacity + 1];
-  
+  m_schedule = schedule;
+  m_virtualTime = 0;
+  m_journal = nullptr;// not logged
+  STAT(m_counters = IrrigatorCounters();)
+
+  // allocat the heap of entries and the Region slots, slot 0 is used first
+  m_heap = new RegionEntry[m_capacity + 1];
+  m_regions = new Region[m_capacity];
+  m_freeSlots = new int[m_capacity];
+  m_numFree = 0;
+  for (int slot = m_capacity - 1; slot >= 0; slot--) {
+    m_freeSlots[m_numFree++] = slot;
+  }
 }
 
-// destructor - releases dynamically allocated Region array
+// destructor - releases dynamically allocated arrays
 Irrigator::~Irrigator(){
-  delete[] m_heap;  // deletes the array
+  delete[] m_heap;  // deletes the arrays
+  delete[] m_regions;
+  delete[] m_freeSlots;
 }
 
-// addRegion - inserts a region into the min-heap based on regPrior
+// addRegion - inserts a copy of the region into the min-heap based on regPrior
 bool Irrigator::addRegion(Region & aRegion){
-  // check capacity
+  TRACE_SCOPE(TRACEADDREGION);
+  bool result = insertRegion(aRegion, true);
+  if (result && m_journal != nullptr) {
+    m_journal->logRegion(OPADDREGION, IRRIGATORTAG, aRegion);
+  }
+  return result;
+}
+
+// addRegion - the region's nodes move into the free slot instead of being copied,
+// it is logged first since the move leaves it empty
+bool Irrigator::addRegion(Region && aRegion){
+  TRACE_SCOPE(TRACEADDREGION);
   if (m_size >= m_capacity - 1) {
-    // heap is full
     return false;
   }
-  
-  m_size++;
-  // insert the region at the end of the array
-  // copy assignment into an array slot
-  m_heap[m_size] = aRegion;
-  int index = m_size;
-  
-
-  // sift-up to restore heap property
-  while (index > ROOTINDEX) {
-    int parent = index / 2;
-
-    // compare priorities: higher priority should bubble up
-    if (m_heap[index].getRegPrior() < m_heap[parent].getRegPrior()) {
-      swapValues(m_heap[index], m_heap[parent]);
-      index = parent;
-    }
-    else {
-      break;
-    }
+  if (m_journal != nullptr) {
+    m_journal->logRegion(OPADDREGION, IRRIGATORTAG, aRegion);
   }
-
-  return true;
+  return insertRegion(aRegion, true, true);
 }
 
 // getRegion - removes and returns the region with the smallest regPrior
 bool Irrigator::getRegion(Region & aRegion){
-  // return false if heap is empty
-  if (m_size == 0) {
-    // nothing to dequeue
-    return false;
-  }
-
-  // save the root region (lowest regPrior)
-  aRegion = m_heap[ROOTINDEX];
-
-  // replace the root with the last element
-  m_heap[ROOTINDEX] = m_heap[m_size];
-  m_size--;
-
-  // sift-down from the root to restore min-heap property
-  int index = ROOTINDEX;
-  while (true) {
-    // gets the left and right child of the parent (index)
-    int left = 2 * index;       
-    int right = 2 * index + 1;
-
-    // assumes current node is smallest
-    int smallest = index;
-
-    // if left child exists and has smaller regPrior, update smallest
-    if (left <= m_size && m_heap[left].getRegPrior() < m_heap[smallest].getRegPrior()) {
-      smallest = left;
-    }
-    // if right child exists and has smaller regPrior, update smallest
-    if (right <= m_size && m_heap[right].getRegPrior() < m_heap[smallest].getRegPrior()) {
-      smallest = right;
-    }
-
-    // if either child is smaller, swap with the smallest child and continue sifting down
-    if (smallest != index) {
-      swapValues(m_heap[index], m_heap[smallest]);
-      index = smallest;
-    }
-    else {
-      // heap property restored; stop sifting
-      break;
-    }
+  TRACE_SCOPE(TRACEGETREGION);
+  bool result = removeRegion(aRegion);
+  if (result && m_journal != nullptr) {
+    m_journal->logOp(OPGETREGION, IRRIGATORTAG);
   }
-
-  return true;
+  return result;
 }
 
 // getNthRegion - removes and returns the nth region (by regPrior order) from the min-heap
-// returns true if successful, false if n is out of range.
 bool Irrigator::getNthRegion(Region & aRegion, int n){
-  // validate the input is within the range
-  if (n <= 0 || n > m_size) {
-    return false;
-  }
-
-  // allocate a temp array to hold removed regions
-  Region* temp = new Region[n];
-
-  // extract n regions
-  for (int i = 1; i <= n; i++) {
-    Region r;
-    getRegion(r);   // removes the smallest region
-    temp[i-1] = r;  // store it in a temp array
-
-    if (i == n) {
-      aRegion = r;  // this is the nth region
-    }
-  }
-  
-  // reinsert all except the nth
-  for (int i = 0; i < n - 1; i++) {
-    addRegion(temp[i]);
+  bool result = removeNthRegion(aRegion, n);
+  if (result && m_journal != nullptr) {
+    m_journal->logOp(OPNTHREGION, IRRIGATORTAG, n);
   }
-
-  // clean up temp array
-  delete[] temp;
-  return true;
+  return result;
 }
 
 void Irrigator::dump(){
     dump(ROOTINDEX);
     cout << endl;
+#ifdef IRRIGATOR_STATS
+    cout << "  region copies: " << m_counters.regionCopies << ", sift calls: "
+         << m_counters.siftCalls << ", sift steps: " << m_counters.siftSteps << endl;
+#endif
 }
 
 void Irrigator::dump(int index){
@@ -607,7 +2363,7 @@ void Irrigator::dump(int index){
 bool Irrigator::setPriorityFn(prifn_t priFn, HEAPTYPE heapType, int n){
   // validate n
   Region target;
-  if (!getNthRegion(target, n)) {
+  if (!removeNthRegion(target, n)) {
     return false;   // nth region does not exist
   }
 
@@ -615,8 +2371,11 @@ bool Irrigator::setPriorityFn(prifn_t priFn, HEAPTYPE heapType, int n){
   target.setPriorityFn(priFn, heapType);
 
   // reinsert the modified region back into the heap
-  addRegion(target);
+  insertRegion(target);
 
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPSETPRIORITY, IRRIGATORTAG, m_journal->registerPriorityFn(priFn), heapType, n);
+  }
   return true;
 }
 
@@ -625,7 +2384,7 @@ bool Irrigator::setPriorityFn(prifn_t priFn, HEAPTYPE heapType, int n){
 bool Irrigator::setStructure(STRUCTURE structure, int n){
   // validate n
   Region target;
-  if (!getNthRegion(target, n)) {
+  if (!removeNthRegion(target, n)) {
     return false;   // nth region does not exist
   }
 
@@ -633,48 +2392,442 @@ bool Irrigator::setStructure(STRUCTURE structure, int n){
   target.setStructure(structure);
   
   // reinsert the modified region back into the heap
-  addRegion(target);
+  insertRegion(target);
 
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPSETSTRUCTURE, IRRIGATORTAG, structure, n);
+  }
   return true;
 }
 
 // getCrop - removes and returns the next available Crop from the heap of regions.
 // returns true if a crop was successfully retrieved, false if the heap is empty.
+// Empty regions on the way are dropped even when no crop is left, so the call
+// is logged whenever it changed the heap.
 bool Irrigator::getCrop(Crop & aCrop){
+  TRACE_SCOPE(TRACEGETCROP);
+  int size = m_size;
+  bool result = nextCrop(aCrop);
+  if ((result || m_size != size) && m_journal != nullptr) {
+    m_journal->logOp(OPGETCROP, IRRIGATORTAG);
+  }
+  return result;
+}
+
+// counters - the hot-path counters of the region heap
+IrrigatorCounters Irrigator::counters() const {
+  IrrigatorCounters result = IrrigatorCounters();
+  STAT(result = m_counters;)
+  return result;
+}
+
+SCHEDULE Irrigator::getSchedule() const {
+  return m_schedule;
+}
+
+// mergeWith - regions of rhs join the region here with the same regPrior and
+// configuration, or move into a slot of their own; the entries are appended
+// and heapified once instead of sifted up one by one
+bool Irrigator::mergeWith(Irrigator& rhs){
+  if (this == &rhs) {
+    return false;
+  }
+
+  // the first region here of every regPrior, then where each region of rhs goes
+  unordered_map<int, int> byPrior;
+  for (int i = ROOTINDEX; i <= m_size; i++) {
+    byPrior.insert(make_pair(m_heap[i].m_regPrior, m_heap[i].m_slot));
+  }
+  int* target = new int[rhs.m_size + 1];
+  int moving = 0;
+  for (int i = ROOTINDEX; i <= rhs.m_size; i++) {
+    const Region& region = rhs.regionAt(i);
+    unordered_map<int, int>::const_iterator same = byPrior.find(region.getRegPrior());
+    target[i] = (same != byPrior.end() && m_regions[same->second].sameConfig(region)) ? same->second : -1;
+    if (target[i] < 0) {
+      moving++;
+    }
+  }
+  if (m_size + moving > m_capacity - 1) {
+    delete[] target;
+    return false;
+  }
+  if (m_journal != nullptr) {
+    m_journal->logIrrigator(OPMERGEIRRIGATOR, rhs);
+  }
+
+  for (int i = ROOTINDEX; i <= rhs.m_size; i++) {
+    Region& region = rhs.regionAt(i);
+    if (target[i] >= 0) {
+      m_regions[target[i]].mergeWithQueue(region);
+      continue;
+    }
+    // a FAIRSHARE region keeps its lag behind the virtual time, others arrive now
+    long long pass = m_virtualTime + stride(region);
+    if (rhs.m_schedule == FAIRSHARE) {
+      pass = m_virtualTime + ((region.m_pass > rhs.m_virtualTime) ? region.m_pass - rhs.m_virtualTime : 0);
+    }
+    int slot = takeSlot();
+    m_regions[slot].moveFrom(region);
+    m_regions[slot].settle();
+    if (m_schedule == FAIRSHARE) {
+      m_regions[slot].m_pass = pass;
+    }
+    m_size++;
+    m_heap[m_size].m_slot = slot;
+  }
+  delete[] target;
+
+  // merged regions have new top crops, every key is taken again
+  for (int i = ROOTINDEX; i <= m_size; i++) {
+    refreshEntry(i);
+  }
+  heapify();
+  rhs.resetSlots(0);
+  // the emptied rhs is logged, unless it shares the log and the merge already says so
+  if (rhs.m_journal != nullptr && rhs.m_journal != m_journal) {
+    rhs.m_journal->logIrrigator(OPASSIGN, rhs);
+  }
+  return true;
+}
+
+// expire - every region moves its clock; their top crops may change, so
+// GLOBAL keys are refreshed and the heap is rebuilt in one pass
+long long Irrigator::expire(int now){
+  // aged keys are taken at the clock, an aging region has a new urgency too
+  long long expired = 0;
+  bool aged = false;
+  for (int i = ROOTINDEX; i <= m_size; i++) {
+    expired += regionAt(i).expire(now);
+    aged = aged || regionAt(i).getAging() > 0;
+  }
+  if (m_schedule == GLOBAL && (expired > 0 || aged)) {
+    for (int i = ROOTINDEX; i <= m_size; i++) {
+      refreshEntry(i);
+    }
+    heapify();
+  }
+  if (m_journal != nullptr) {
+    m_journal->logOp(OPEXPIRE, IRRIGATORTAG, now);
+  }
+  return expired;
+}
+
+// attaches the irrigator to a write-ahead log, the current regions are logged first
+void Irrigator::setJournal(Journal* journal){
+  m_journal = journal;
+  if (m_journal != nullptr) {
+    m_journal->logIrrigator(OPASSIGN, *this);
+  }
+}
+
+/******************************************
+* Private function *
+******************************************/
+// insertRegion - inserts a region into the min-heap based on regPrior
+// an arriving region starts one stride after the current virtual time, a
+// region that is only moved (getNthRegion, setPriorityFn) keeps its pass;
+// with move the slot takes over the nodes of aRegion, which is left empty
+bool Irrigator::insertRegion(Region & aRegion, bool arriving, bool move){
+  // check capacity
+  if (m_size >= m_capacity - 1) {
+    // heap is full
+    return false;
+  }
+  
+  // copy assignment (or a move) into a free slot, where the region stays while queued
+  int slot = takeSlot();
+  Region& region = m_regions[slot];
+  if (move) {
+    region.moveFrom(aRegion);
+  }
+  else {
+    STAT(m_counters.regionCopies++;)
+    region = aRegion;
+  }
+  region.settle();  // the schedule compares top crops, they must be known
+  if (arriving && m_schedule == FAIRSHARE) {
+    region.m_pass = m_virtualTime + stride(region);
+  }
+
+  // insert its entry at the end of the heap and sift it up
+  pushEntry(entryOf(region, slot));
+
+  return true;
+}
+
+// removeRegion - removes and returns the region with the smallest regPrior
+bool Irrigator::removeRegion(Region & aRegion){
+  // return false if heap is empty
+  if (m_size == 0) {
+    // nothing to dequeue
+    return false;
+  }
+
+  // save the root region (lowest regPrior), its slot is free again
+  int slot = popRoot();
+  STAT(m_counters.regionCopies++;)
+  aRegion = m_regions[slot];
+  releaseSlot(slot);
+
+  return true;
+}
+
+// removeNthRegion - removes and returns the nth region (by regPrior order) from the min-heap
+// returns true if successful, false if n is out of range.
+bool Irrigator::removeNthRegion(Region & aRegion, int n){
+  // validate the input is within the range
+  if (n <= 0 || n > m_size) {
+    return false;
+  }
+
+  // extract the entries of n regions, the regions stay in their slots
+  RegionEntry* temp = new RegionEntry[n];
+  for (int i = 0; i < n; i++) {
+    temp[i] = m_heap[ROOTINDEX];
+    popRoot();
+  }
+
+  // this is the nth region
+  STAT(m_counters.regionCopies++;)
+  aRegion = m_regions[temp[n-1].m_slot];
+  releaseSlot(temp[n-1].m_slot);
+
+  // reinsert all except the nth
+  for (int i = 0; i < n - 1; i++) {
+    pushEntry(temp[i]);
+  }
+
+  // clean up temp array
+  delete[] temp;
+  return true;
+}
+
+// nextCrop - removes and returns the next available Crop from the heap of regions.
+// returns true if a crop was successfully retrieved, false if the heap is empty.
+bool Irrigator::nextCrop(Crop & aCrop){
   // checks if there is regions in the heap, returns false if there is none
   if (m_size == 0) {
     return false;
   }
 
-  // remove the region with the smallest regPrior (top of the heap)
-  Region topRegion;
-  getRegion(topRegion);
+  // the root changes in place, only its key moves in the heap: O(log regions)
+  if (m_schedule != STRICT) {
+    Region& top = regionAt(ROOTINDEX);
+    if (top.numCrops() == 0) {
+      // skip empty region
+      releaseSlot(popRoot());
+      return nextCrop(aCrop);
+    }
+
+    top.popNextCrop(aCrop);
+    if (m_schedule == FAIRSHARE) {
+      // the region's next turn is one stride later
+      m_virtualTime = top.m_pass;
+      top.m_pass += stride(top);
+    }
+    if (top.numCrops() == 0) {
+      releaseSlot(popRoot());
+      return true;
+    }
+    refreshEntry(ROOTINDEX);
+    siftDown(ROOTINDEX);
+    return true;
+  }
+
+  // remove the entry with the smallest regPrior (top of the heap)
+  int slot = popRoot();
+  Region& topRegion = m_regions[slot];
 
   // if this region has no crops, skip it and try again recursively
   if (topRegion.numCrops() == 0) {
     // skip empty region
-    return getCrop(aCrop);
+    releaseSlot(slot);
+    return nextCrop(aCrop);
   }
 
   // extract the next crop from the region
-  aCrop = topRegion.getNextCrop();
+  topRegion.popNextCrop(aCrop);
 
-  // if the region still has crops left, reinsert it into the heap
+  // if the region still has crops left, reinsert its entry into the heap
   if (topRegion.numCrops() > 0) {
-    addRegion(topRegion);
+    pushEntry(entryOf(topRegion, slot));
+  }
+  else {
+    releaseSlot(slot);
   }
 
   return true;
-  
 }
 
-/******************************************
-* Private function *
-******************************************/
-// swaps two Region reference
-void Irrigator::swapValues(Region &a, Region &b) {
-  Region temp = a;  // temp stores a
-  a = b;            // set a to b
-  b = temp;         // set b to a (temp)
+// topRegion - drops the empty regions at the root, then returns the root
+// that is the region the next nextCrop takes its crop from
+const Region* Irrigator::topRegion(){
+  int size = m_size;
+  while (m_size > 0 && regionAt(ROOTINDEX).numCrops() == 0) {
+    releaseSlot(popRoot());
+  }
+  if (m_size != size && m_journal != nullptr) {
+    m_journal->logOp(OPDROPEMPTY, IRRIGATORTAG);
+  }
+  return (m_size > 0) ? &regionAt(ROOTINDEX) : nullptr;
+}
+
+Region& Irrigator::regionAt(int index) {
+  return m_regions[m_heap[index].m_slot];
+}
+
+const Region& Irrigator::regionAt(int index) const {
+  return m_regions[m_heap[index].m_slot];
+}
+
+// entryOf - the heap entry of a region in the given slot under the schedule
+Irrigator::RegionEntry Irrigator::entryOf(const Region &aRegion, int slot) const {
+  RegionEntry entry;
+  entry.m_key = 0;
+  if (m_schedule == GLOBAL) {
+    entry.m_key = urgency(aRegion);
+  }
+  else if (m_schedule == FAIRSHARE) {
+    entry.m_key = aRegion.m_pass;
+  }
+  entry.m_regPrior = aRegion.getRegPrior();
+  entry.m_slot = slot;
+  return entry;
+}
+
+// refreshEntry - the region of the entry popped a crop, its key follows
+void Irrigator::refreshEntry(int index) {
+  m_heap[index] = entryOf(regionAt(index), m_heap[index].m_slot);
+}
+
+// pushEntry - appends an entry to the heap and sifts it up
+void Irrigator::pushEntry(const RegionEntry &entry) {
+  m_size++;
+  m_heap[m_size] = entry;
+  siftUp(m_size);
+}
+
+// popRoot - replaces the root entry with the last one and sifts it down,
+// the region of the old root stays in the returned slot
+int Irrigator::popRoot() {
+  int slot = m_heap[ROOTINDEX].m_slot;
+  m_heap[ROOTINDEX] = m_heap[m_size];
+  m_size--;
+  siftDown(ROOTINDEX);
+  return slot;
+}
+
+int Irrigator::takeSlot() {
+  return m_freeSlots[--m_numFree];
+}
+
+// releaseSlot - frees the crops of the slot's region and makes the slot free
+void Irrigator::releaseSlot(int slot) {
+  m_regions[slot].emptyHeap();
+  m_freeSlots[m_numFree++] = slot;
+}
+
+// resetSlots - a restored heap: entry i holds slot i-1, the other slots are freed
+void Irrigator::resetSlots(int size) {
+  m_size = size;
+  m_numFree = 0;
+  for (int slot = m_capacity - 1; slot >= size; slot--) {
+    m_regions[slot].emptyHeap();
+    m_freeSlots[m_numFree++] = slot;
+  }
+  for (int i = ROOTINDEX; i <= size; i++) {
+    m_heap[i].m_slot = i - 1;
+  }
+}
+
+// before - true if region a is served ahead of region b under the schedule
+bool Irrigator::before(const Region &a, const Region &b) const {
+  return before(entryOf(a, 0), entryOf(b, 0));
+}
+
+// the schedule's key first (urgency or pass), the regPrior breaks ties
+bool Irrigator::before(const RegionEntry &a, const RegionEntry &b) const {
+  if (a.m_key != b.m_key) {
+    return a.m_key < b.m_key;
+  }
+  return a.m_regPrior < b.m_regPrior;
+}
+
+// urgency - key of the region's top crop, smaller is served first
+// that is its priority (negated for a max-heap) unless the region has a
+// CropOrder, an empty region goes last
+long long Irrigator::urgency(const Region &aRegion) const {
+  return aRegion.topKey();
+}
+
+// stride - virtual time a region waits between two crops, the regPrior
+int Irrigator::stride(const Region &aRegion) const {
+  return (aRegion.getRegPrior() > 0) ? aRegion.getRegPrior() : 1;
+}
+
+// siftUp - moves the region at index up until its parent is served first
+void Irrigator::siftUp(int index) {
+  STAT(m_counters.siftCalls++;)
+  while (index > ROOTINDEX) {
+    int parent = index / 2;
+
+    // compare priorities: higher priority should bubble up
+    if (before(m_heap[index], m_heap[parent])) {
+      STAT(m_counters.siftSteps++;)
+      swapValues(m_heap[index], m_heap[parent]);
+      index = parent;
+    }
+    else {
+      break;
+    }
+  }
+}
+
+// siftDown - moves the region at index down until it is served before its children
+void Irrigator::siftDown(int index) {
+  STAT(m_counters.siftCalls++;)
+  while (true) {
+    // gets the left and right child of the parent (index)
+    int left = 2 * index;
+    int right = 2 * index + 1;
+
+    // assumes current node is smallest
+    int smallest = index;
+
+    // if left child exists and is served first, update smallest
+    if (left <= m_size && before(m_heap[left], m_heap[smallest])) {
+      smallest = left;
+    }
+    // if right child exists and is served first, update smallest
+    if (right <= m_size && before(m_heap[right], m_heap[smallest])) {
+      smallest = right;
+    }
+
+    // if either child is smaller, swap with the smallest child and continue sifting down
+    if (smallest != index) {
+      STAT(m_counters.siftSteps++;)
+      swapValues(m_heap[index], m_heap[smallest]);
+      index = smallest;
+    }
+    else {
+      // heap property restored; stop sifting
+      break;
+    }
+  }
+}
+
+// heapify - restores the heap order of all entries bottom up (Floyd), O(regions)
+void Irrigator::heapify() {
+  for (int i = m_size / 2; i >= ROOTINDEX; i--) {
+    siftDown(i);
+  }
+}
+
+// swaps two heap entries
+void Irrigator::swapValues(RegionEntry &a, RegionEntry &b) {
+  RegionEntry temp = a;  // temp stores a
+  a = b;                 // set a to b
+  b = temp;              // set b to a (temp)
 }
 
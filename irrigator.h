@@ -4,12 +4,17 @@
 #include <stdexcept>
 #include <iostream>
 #include <string>
+#include "timerwheel.h"
 using namespace std;
 class Grader;   // forward declaration (for grading purposes)
 class Tester;   // forward declaration (for testing purposes)
 class Irrigator;   // forward declaration 
 class Region;   // forward declaration
 class Crop;     // forward declaration
+class Journal;  // forward declaration
+class CropArena;    // forward declaration
+class ShardedIrrigator; // forward declaration
+class CropExporter; // forward declaration
 
 // Constant parameters, min and max values
 #define ROOTINDEX 1
@@ -32,22 +37,92 @@ const int MINTYPE = BEAN;       // lowest priority
 const int MAXTYPE = SUGARCANE;  // highest priority
 
 enum HEAPTYPE {MINHEAP, MAXHEAP, NOTYPE};
-enum STRUCTURE {SKEW, LEFTIST, NOSTRUCT};
+// MINMAX: a min-max heap (levels alternate between smallest and largest key),
+// both ends in O(log n); appended so stored structure values keep their meaning
+enum STRUCTURE {SKEW, LEFTIST, NOSTRUCT, MINMAX};
+// on-disk layout of crop records (ID, temperature, moisture, time, type, region)
+// JSONRECORD is written by CropExporter only, CropLoader reads the other two
+enum RECORDFORMAT {CSVRECORD, BINARYRECORD, JSONRECORD};
+// how the Irrigator picks the region that getCrop serves
+// STRICT: lowest regPrior first, a region drains before the next one starts
+// GLOBAL: the most urgent top crop over all regions, regPrior breaks ties
+// FAIRSHARE: stride scheduling, a region's share of the crops is proportional
+//            to 1/regPrior and no region with crops waits forever
+enum SCHEDULE {STRICT, GLOBAL, FAIRSHARE};
+// how a Region splits its crops into sub-heaps
+// NOPARTITION: one heap; BYTIME: one heap per TIME window;
+// BYTYPE: one heap per PLANT type (a valve group)
+enum PARTITION {NOPARTITION, BYTIME, BYTYPE};
+const int MAXPARTITIONS = MAXTYPE + 1;  // sub-heaps of the largest partitioning
+const int MAXAGING = 1 << 20;           // priority points a crop may gain per tick
+// crop fields a lexicographic CropOrder can sort on
+enum CROPFIELD {FIELDTEMPERATURE, FIELDMOISTURE, FIELDTIME, FIELDTYPE, FIELDCROPID, NUMCROPFIELDS};
+enum ORDERDIR {ASCENDING, DESCENDING};
 
 // Priority function pointer type
 typedef int (*prifn_t)(const Crop&);
 
+// Hot-path counters, compiled in with -DIRRIGATOR_STATS. Without the flag the
+// counter members and every STAT(...) statement disappear, counters() returns zeros.
+#ifdef IRRIGATOR_STATS
+#define STAT(...) __VA_ARGS__
+#else
+#define STAT(...)
+#endif
+
+struct RegionCounters{
+    long long merges;         // top-level merges (insert, pop, mergeWithQueue, rebuild)
+    long long mergeSteps;     // recursive merge calls, i.e. right spine nodes walked
+    int maxMergeDepth;        // deepest merge recursion seen
+    long long priorityCalls;  // priority function invocations by the heap operations
+    long long nodeAllocs;     // crop nodes allocated
+    long long nodeFrees;      // crop nodes freed
+    int rightSpine;           // current right spine length, measured by counters()
+};
+
+struct IrrigatorCounters{
+    long long regionCopies;   // deep Region copies into and out of the region slots
+    long long siftCalls;      // sift-up and sift-down passes
+    long long siftSteps;      // levels moved by those passes
+};
+
+// Aggregates over the crops of a region, kept up to date by every operation.
+// min and max are 0 for an empty region.
+struct CropStats{
+    int count;
+    int byType[MAXTYPE + 1];      // crops of every PLANT type
+    int byTime[MAXTIME + 1];      // crops in every TIME window
+    long long moistureSum;
+    long long moistureSquares;    // sum of squares, for the variance
+    long long temperatureSum;
+    long long temperatureSquares;
+    int minMoisture, maxMoisture;
+    int minTemperature, maxTemperature;
+    double meanMoisture() const;
+    double meanTemperature() const;
+    double stddevMoisture() const;
+    double stddevTemperature() const;
+};
+
 class Crop{
     public:
     friend class Grader; // for grading purposes
     friend class Tester; // for testing purposes
     friend class Region;
+    friend class Journal;
+    friend class CropArena;
+    friend class CropExporter;
     Crop(){
         m_cropID = DEFAULTCROPID;m_temperature = MINTEMP;
         m_moisture = MAXMOISTURE;m_time = MAXTIME;m_type = MINTYPE;
+        m_deadline = 0;
+        m_epoch = 0;
         m_right = nullptr;
         m_left = nullptr;
         m_npl = 0;
+        m_refs = 1;
+        m_key = 0;
+        m_arena = nullptr;
     }
     Crop(int ID, int temperature, int moisture, int time, int type){
         if (ID < MINCROPID || ID > MAXCROPID) m_cropID = DEFAULTCROPID;
@@ -60,9 +135,14 @@ class Crop{
         else m_time = time;
         if (type < MINTYPE || type > MAXTYPE) m_type = MINTYPE;
         else m_type = type;
+        m_deadline = 0;
+        m_epoch = 0;
         m_right = nullptr;
         m_left = nullptr;
         m_npl = 0;
+        m_refs = 1;
+        m_key = 0;
+        m_arena = nullptr;
     }
     int getCropID() const {return m_cropID;}
     int getTemperature() const {return m_temperature;}
@@ -81,6 +161,11 @@ class Crop{
         return result;
     }
     int getType() const {return m_type;}
+    int getDeadline() const {return m_deadline;}
+    int getEpoch() const {return m_epoch;}   // region clock when it was inserted
+    // the tick from which the crop is no longer served, see Region::expire;
+    // 0 (or a negative value) is no deadline
+    void setDeadline(int deadline) {m_deadline = (deadline > 0) ? deadline : 0;}
     string getTypeString() const {
         string result = "UNKNOWN";
         switch (m_type)
@@ -113,15 +198,56 @@ class Crop{
     // the time of day is divided into 4 windows
     // a value of 0 means a higher priority
     // a value of 3 means a lower priority
-    int m_time;         // 0-3, an enum type is defined for this
+    short m_time;       // 0-3, an enum type is defined for this
     // m_type shows the type of a crop based on the plant watering requirement
     // a value of 0 means a lower priority, 
     // a value of 6 means a higher priority 
-    int m_type;         // 0-6, an enum type is defined for this
+    short m_type;       // 0-6, an enum type is defined for this
+    // m_deadline is the tick at which the crop expires, 0 if it never does;
+    // it fills the padding before the pointers, a node stays 64 bytes
+    int m_deadline;
+    // m_epoch is the region clock at insertion, m_time and m_type are short
+    // to make room for it
+    int m_epoch;
 
     Crop * m_right;   // right child
     Crop * m_left;    // left child
     int m_npl;        // null path length for leftist heap
+    int m_refs;       // parents and roots pointing here, above 1 only in persistent regions
+    long long m_key;  // ordering key cached by the region, the smaller key is served first
+    CropArena * m_arena;  // arena the node came from, nullptr for new/delete
+};
+
+// A lexicographic order over crop fields, e.g. moisture ascending, then
+// temperature descending, then crop ID. Every field is packed into its own
+// bit range of one 64-bit key (most significant field first), so comparing
+// two crops is one integer comparison. All five fields fit in 39 bits.
+class CropOrder{
+    public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // for testing purposes
+    friend class Region;
+    friend class Journal;
+    CropOrder();  // no fields, a region with an empty order uses its priority function
+    // Appends the next, less significant field. Returns false if the field
+    // is invalid or already in the order.
+    bool add(CROPFIELD field, ORDERDIR dir = ASCENDING);
+    int numFields() const;
+    bool empty() const;
+    long long key(const Crop& crop) const; // smaller key comes first
+    bool operator==(const CropOrder& rhs) const;
+    bool operator!=(const CropOrder& rhs) const;
+
+    private:
+    CROPFIELD m_fields[NUMCROPFIELDS];
+    ORDERDIR m_dirs[NUMCROPFIELDS];
+    int m_numFields;
+
+    int encode() const;
+    bool decode(int code, int numFields);
+    static int fieldBits(CROPFIELD field);
+    static int fieldRange(CROPFIELD field);  // largest value after subtracting the minimum
+    static int fieldValue(CROPFIELD field, const Crop& crop);
 };
 
 class Region{
@@ -129,13 +255,35 @@ class Region{
     friend class Grader; // for grading purposes
     friend class Tester; // for testing purposes
     friend class Irrigator;
+    friend class Journal;
+    friend class ShardedIrrigator;
+    friend class RelaxedRegion;
+    friend class CropExporter;
     Region();
     Region(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure, int regPrior);
     ~Region();
     Region(const Region& rhs);
     Region& operator=(const Region& rhs);
     bool insertCrop(const Crop& crop);
+    // Crop owns no memory, so the move is a copy; the overload lets a
+    // temporary go straight into the node
+    bool insertCrop(Crop&& crop);
+    // Builds the node from the fields in place, out of range fields are
+    // replaced like Crop's constructor does. No temporary Crop is made.
+    bool emplaceCrop(int ID, int temperature, int moisture, int time, int type);
+    // Bulk insert, builds the new crops into a heap in linear time and merges
+    // it in once. Returns the number of crops accepted.
+    int insertCrops(const Crop crops[], int count);
     Crop getNextCrop(); // Return the highest priority crop
+    // Pops the highest priority crop into out, false (no exception) if empty
+    bool popNextCrop(Crop& out);
+    // Double-ended use, MINMAX regions only (domain_error otherwise): the
+    // lowest priority crop, e.g. the wettest next to the driest. O(log n).
+    // Both throw out_of_range on an empty region.
+    Crop getLastCrop();
+    const Crop& peekLastCrop() const;
+    // The crop getNextCrop would return, a pending rebuild is finished first
+    const Crop& peekNextCrop();
     void mergeWithQueue(Region& rhs);
     void clear();
     int numCrops() const; // Return number of nodes in queue
@@ -148,6 +296,84 @@ class Region{
     // Set a new data structure (skew/leftist). Must rebuild the heap!!!
     void setStructure(STRUCTURE structure);
     void dump() const; // For debugging purposes
+    // Record every change of this region in the journal under the given tag,
+    // starting with its current contents. nullptr detaches. Copies are not attached.
+    void setJournal(Journal* journal, int tag);
+    RegionCounters counters() const; // zeros unless built with IRRIGATOR_STATS
+    // Persistent mode: copies share nodes (O(1) copy) and a change copies only
+    // the nodes on its merge path, so a copy costs O(log n) per later change
+    // of a leftist heap. Shared nodes are not thread-safe across regions.
+    void setPersistent(bool persistent);
+    bool isPersistent() const;
+    // Partitioned mode keeps one sub-heap per key (the crop's time window for
+    // BYTIME, its plant type for BYTYPE). getNextCrop() still returns the best crop of the whole region,
+    // comparing the sub-heap roots; getNextCrop(key) drains one window in
+    // O(log n) per pop, so moving to the next window needs no rebuild.
+    // Changing the partitioning moves every crop, O(n log n).
+    void setPartition(PARTITION partition);
+    PARTITION getPartition() const;
+    Crop getNextCrop(int key);   // throws out_of_range if that sub-heap is empty
+    int numCrops(int key) const; // crops in one sub-heap, 0 for invalid keys
+    // Orders the crops by a lexicographic CropOrder instead of the priority
+    // function (which still decides which crops are valid) and rebuilds.
+    // An empty CropOrder returns to priority function order.
+    void setOrder(const CropOrder& order);
+    CropOrder getOrder() const;
+    // Counts, sums and extremes of the crops, without touching the heaps
+    CropStats stats() const;
+    // Pops up to n crops of one sub-heap into crops[], O(n log n). Returns the number popped.
+    int getNextCrops(int key, int n, Crop crops[]);
+    // Pops the n highest priority crops and stores them grouped by plant type,
+    // priority order within a group: type t is crops[groupStart[t]] up to
+    // crops[groupStart[t+1]-1]. groupStart needs MAXTYPE+2 entries. Any partitioning.
+    int getCropBatch(int n, Crop crops[], int groupStart[]);
+    // Takes new nodes from the arena instead of new, nullptr returns to new.
+    // The nodes already in the heaps move to the arena (nodes shared with
+    // another persistent region stay put). A copy uses the same arena, which
+    // must outlive every region using it; only one thread may use it at a time.
+    void setArena(CropArena* arena);
+    CropArena* getArena() const;
+    // Moves every node into one contiguous block in preorder (the arena's
+    // next run, or a block of its own without an arena), so a merge walking
+    // down the heap reads memory in order. Shared nodes stay put. O(n).
+    void compact();
+    // Compacts after every rebuild (priority function, structure, partition,
+    // order) and bulk insert. Off by default.
+    void setAutoCompact(bool autoCompact);
+    bool isAutoCompact() const;
+    // Incremental rebuild: with a budget of n, setPriorityFn only sets the old
+    // heaps aside, O(1), and every later insertCrop, insertCrops or rebuildStep
+    // moves up to n of those crops into the heaps of the new order. A pop needs
+    // the new priority of every crop, so getNextCrop (and every operation that
+    // reorders the heaps) first finishes the rebuild, with one linear-time
+    // build instead of a merge per crop. 0, the default, rebuilds at once.
+    void setRebuildBudget(int nodesPerCall);
+    int getRebuildBudget() const;
+    int numPending() const;   // crops still waiting for the new order
+    int rebuildStep();        // moves up to the budget, returns numPending()
+    // Expiry: a crop expires at its deadline (Crop::setDeadline), a crop
+    // inserted without one gets the region's clock plus its TTL. insertCrop
+    // refuses a crop whose deadline is not after the clock. expire(now) moves
+    // the clock forward and returns the number of crops that expired; from
+    // then on no pop, peek or numCrops() sees them. A timer wheel counts
+    // them in amortized O(1) each without looking at the heaps. They are
+    // freed when they reach the top of a sub-heap, or all at once when they
+    // are more than half of the region, so stats() and numCrops(key) count
+    // them until then.
+    int expire(int now);
+    int getTime() const;      // the clock, 0 for a new region
+    void setTTL(int ttl);     // 0, the default, gives no deadline
+    int getTTL() const;
+    // Aging: with a rate r a crop moves r priority points toward the front for
+    // every tick of the clock (expire) since its insertion, so an old crop of
+    // mediocre priority is served before newer, better ones. Every crop gains the same
+    // r per tick, so the key of a crop inserted at epoch e stays its priority
+    // plus r*e and heap order holds without touching a node: a tick is O(1).
+    // Changing the rate re-keys the crops like setPriorityFn. A CropOrder is
+    // not aged. 0, the default, turns aging off; the rate is at most MAXAGING.
+    void setAging(int rate);
+    int getAging() const;
+    long long agedPriority(const Crop& crop) const;   // priority with the crop's age
 
     private:
     Crop * m_heap;          // Pointer to root of the heap
@@ -156,6 +382,30 @@ class Region{
     HEAPTYPE m_heapType;    // either a MINHEAP or a MAXHEAP
     STRUCTURE m_structure;  // skew heap or leftist heap
     int m_regPrior;         // this holds the priority of the region
+    Journal * m_journal;    // write-ahead log, nullptr when not logged
+    int m_journalTag;       // identifies this region in the log
+    bool m_persistent;      // copies share nodes instead of copying them
+    long long m_pass;       // virtual time of its next turn in a FAIRSHARE irrigator
+    PARTITION m_partition;  // NOPARTITION keeps every crop in m_heap
+    Crop * m_part[MAXPARTITIONS];   // sub-heap roots when partitioned, m_heap is unused
+    CropOrder m_order;      // lexicographic order, empty when the priority function orders
+    CropStats m_stats;      // running aggregates, min and max are filled in by stats()
+    int m_moistureCount[MAXMOISTURE - MINMOISTURE + 1];  // crops by moisture, for min and max
+    int m_temperatureCount[MAXTEMP - MINTEMP + 1];       // crops by temperature
+    int m_partSize[MAXPARTITIONS];  // crops in each sub-heap
+    CropArena * m_arena;    // where new nodes come from, nullptr for new
+    bool m_autoCompact;     // compact after rebuilds and bulk inserts
+    int m_rebuildBudget;    // crops moved per call by an incremental rebuild
+    Crop ** m_pending;      // stack of subtrees still in the old order, each entry holds a reference
+    int m_numPending;       // entries on m_pending
+    int m_pendingCapacity;  // size of m_pending
+    int m_pendingCrops;     // crops in those subtrees, included in m_size and m_partSize
+    TimerWheel m_wheel;     // the clock and the deadlines still ahead of it
+    int m_ttl;              // lifetime of a crop inserted without a deadline, 0 for none
+    int m_expired;          // crops past their deadline, still in the heaps or pending
+    int m_aging;            // priority points per tick of age, 0 for none
+    STAT(RegionCounters m_counters;)  // travels with the contents on copy
+    STAT(int m_mergeDepth;)           // current merge recursion depth
 
     void dump(Crop *pos) const; // helper function for dump
 
@@ -163,9 +413,62 @@ class Region{
      * Private function declarations go here! *
      ******************************************/
 
+    void emptyHeap();
+    Crop* newNode(const Crop& crop);
+    Crop* newNode(int ID, int temperature, int moisture, int time, int type);
+    void linkNode(Crop* node, int priority);
+    void addDeadline(Crop* node);
+    void addDeadlines(Crop* root, Crop** stack);
+    bool isExpired(const Crop& crop) const;
+    bool releaseExpired(Crop* node);
+    void trimExpired(int key);
+    void dropExpired();
+    void purge();
+    void addNode(int key, Crop* node);
+    void addNodes(int key, Crop* nodes[], int count);
+    int detachNodes(Crop* root, Crop* nodes[]);
+    void freeNode(Crop* node);
+    void relocate(Crop*& root, Crop*** stack);
+    void compactTree(Crop*& root, CropArena* target, Crop*** stack);
+    void pushPending(Crop* node);
+    void migrate(int count);
+    void settle(bool negateKeys = false);
+    void rekeyAll(bool negateKeys);
+    void fixLeftist(Crop*& root, Crop*** stack, Crop** nodes);
+    void mergeNodes(Crop* nodes[], int count);
     void clearHeap(Crop* node);
     Crop* copyHeap(Crop* node);
+    void copyHeaps(const Region& rhs);
+    void moveFrom(Region& rhs);
+    bool sameConfig(const Region& rhs) const;
+    int numHeaps() const;
+    Crop*& heapAt(int key);
+    Crop* heapAt(int key) const;
+    int partitionOf(const Crop& crop) const;
+    int nextPartition() const;
+    Crop popHeap(int key);
+    void popHeap(int key, Crop& out, bool last = false);
+    void takeCrop(int key, Crop& out, bool last = false);
+    void minMaxInsert(int key, Crop* node);
+    void minMaxRemove(int key, bool last, Crop& out);
+    void trickleDown(Crop* node, bool minLevel);
+    Crop* buildMinMax(Crop* nodes[], int count);
+    Crop* lastNode(int key) const;
+    int lastPartition() const;
+    static int levelOf(int index);
+    static void copyCrop(Crop* to, const Crop& from);
+    static void swapCrops(Crop* a, Crop* b);
+    long long keyOf(const Crop& crop, int priority) const;
+    long long topKey() const;
+    void tally(const Crop& crop, int sign);
+    void tallyHeap(Crop* root, Crop** stack);
+    void resetStats();
+    void rekeyHeap(Crop* root, Crop** stack);
+    void detachHeaps(Crop* roots[]);
+    Crop* ownNode(Crop* node);
+    Crop* ownTree(Crop* node);
     Crop* merge(Crop* h1, Crop* h2);
+    Crop* buildHeap(Crop* nodes[], int count);
 
     void swapValues(Crop*& a, Crop*& b);
     int minValue(int a, int b);
@@ -180,9 +483,13 @@ class Irrigator{
     public:
     friend class Grader; // for grading purposes
     friend class Tester; // for testing purposes
-    Irrigator(int size);
+    friend class Journal;
+    friend class ShardedIrrigator;
+    friend class CropExporter;
+    Irrigator(int size, SCHEDULE schedule = STRICT);
     ~Irrigator();
     bool addRegion(Region & aRegion); // enqueue function
+    bool addRegion(Region && aRegion); // moves the crops in without copying a node, aRegion is left empty
     bool getRegion(Region & aRegion); // dequeue function
     bool getCrop(Crop & aCrop);
     bool getNthRegion(Region & aRegion, int n);
@@ -191,11 +498,41 @@ class Irrigator{
     bool setPriorityFn(prifn_t priFn, HEAPTYPE heapType, int n);
     // change structure for the Nth highest  priority region
     bool setStructure(STRUCTURE structure, int n);
+    // Record every change of the irrigator in the journal, starting with its
+    // current regions. nullptr detaches.
+    void setJournal(Journal* journal);
+    IrrigatorCounters counters() const; // zeros unless built with IRRIGATOR_STATS
+    SCHEDULE getSchedule() const;
+    // Moves every region of rhs here and leaves rhs empty. A region of rhs
+    // with the regPrior and configuration (priority function, heap type,
+    // structure, partition, order) of a region here is merged into it with
+    // mergeWithQueue, the others move into free slots without copying a
+    // crop. The heap is then rebuilt bottom up, O(regions) plus the merges.
+    // False (nothing changes) if the moved regions do not fit or rhs is this.
+    bool mergeWith(Irrigator& rhs);
+    // Moves the clock of every queued region to now (Region::expire), returns
+    // the number of crops that expired. O(regions) plus the expiries.
+    long long expire(int now);
 
     private:
-    Region * m_heap;          // Array to hold the heap
+    // A heap entry: what the schedule compares, and the slot of the region.
+    // Sifting moves these 16 bytes, the Regions never move while queued.
+    struct RegionEntry{
+        long long m_key;      // top crop key (GLOBAL), pass (FAIRSHARE), 0 (STRICT)
+        int m_regPrior;       // breaks the ties
+        int m_slot;           // index into m_regions
+    };
+
+    RegionEntry * m_heap;     // Array to hold the heap
+    Region * m_regions;       // the regions, each in a slot of its own
+    int * m_freeSlots;        // stack of the unused slots
+    int m_numFree;
     int m_capacity;           // size of array
     int m_size;               // Current size of the heap
+    SCHEDULE m_schedule;      // order of the region heap
+    long long m_virtualTime;  // pass of the last region served (FAIRSHARE)
+    Journal * m_journal;      // write-ahead log, nullptr when not logged
+    STAT(IrrigatorCounters m_counters;)
 
     /******************************************
      * Private function declarations go here! *
@@ -203,7 +540,33 @@ class Irrigator{
 
     void dump(int index);
 
-    void swapValues(Region &a, Region &b);
+    // the operations without logging, public ones log once around these
+    bool insertRegion(Region & aRegion, bool arriving = false, bool move = false);
+    bool removeRegion(Region & aRegion);
+    bool removeNthRegion(Region & aRegion, int n);
+    bool nextCrop(Crop & aCrop);
+    // the region nextCrop serves, nullptr when there are no crops; the empty
+    // regions it drops on the way are logged
+    const Region* topRegion();
+
+    Region& regionAt(int index);    // the region of heap entry index
+    const Region& regionAt(int index) const;
+    RegionEntry entryOf(const Region &aRegion, int slot) const;
+    void refreshEntry(int index);   // after the region of entry index changed
+    void pushEntry(const RegionEntry &entry);
+    int popRoot();                  // removes the root entry, returns its slot
+    int takeSlot();
+    void releaseSlot(int slot);
+    void resetSlots(int size);      // entries 1..size get slots 0..size-1
+
+    bool before(const Region &a, const Region &b) const;
+    bool before(const RegionEntry &a, const RegionEntry &b) const;
+    long long urgency(const Region &aRegion) const;
+    int stride(const Region &aRegion) const;
+    void siftUp(int index);
+    void siftDown(int index);
+    void heapify();
+    void swapValues(RegionEntry &a, RegionEntry &b);
     
 };
 #endif
@@ -0,0 +1,885 @@
+// CMSC 341 - Fall 2025 - Project 3
+#include "journal.h"
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+
+// every log and snapshot file starts with a magic word and a generation,
+// a checkpoint bumps the generation so a log that was not truncated before
+// a crash is recognized as already contained in the snapshot
+static const char LOGMAGIC[4] = {'I','R','W','L'};
+static const char SNAPMAGIC[4] = {'I','R','S','N'};
+static const int FILEHEADER = 8;    // magic + generation
+static const int RECORDHEADER = 8;  // payload length + checksum
+static const int MINTREENODE = 10;  // a crop, its npl and its children byte
+
+// FNV-1a, detects a torn record at the end of the log
+static uint32_t checksum(const char* data, int bytes){
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < bytes; i++) {
+    hash ^= (unsigned char)data[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// reads a whole file, returns nullptr if it cannot be opened
+static char* readFile(const char* path, long& size){
+  FILE* in = fopen(path, "rb");
+  if (in == nullptr) {
+    return nullptr;
+  }
+  fseek(in, 0, SEEK_END);
+  size = ftell(in);
+  fseek(in, 0, SEEK_SET);
+  char* data = new char[size > 0 ? size : 1];
+  if (size > 0 && fread(data, 1, size, in) != (size_t)size) {
+    size = 0;
+  }
+  fclose(in);
+  return data;
+}
+
+static bool getInt(const char*& pos, const char* end, int& value){
+  if (end - pos < 4) {
+    return false;
+  }
+  int32_t raw;
+  memcpy(&raw, pos, 4);
+  pos += 4;
+  value = raw;
+  return true;
+}
+
+static bool getLong(const char*& pos, const char* end, long long& value){
+  if (end - pos < 8) {
+    return false;
+  }
+  int64_t raw;
+  memcpy(&raw, pos, 8);
+  pos += 8;
+  value = raw;
+  return true;
+}
+
+static bool getByte(const char*& pos, const char* end, int& value){
+  if (end - pos < 1) {
+    return false;
+  }
+  value = (unsigned char)*pos;
+  pos++;
+  return true;
+}
+
+// generation stored in a file header, -1 if the header is not valid
+static int generationOf(const char* data, long size, const char magic[4]){
+  if (size < FILEHEADER || memcmp(data, magic, 4) != 0) {
+    return -1;
+  }
+  const char* pos = data + 4;
+  int generation = -1;
+  getInt(pos, data + size, generation);
+  return generation;
+}
+
+// constructor - nothing is opened yet
+Journal::Journal(){
+  m_log = nullptr;
+  m_capacity = DEFAULTGROUPBYTES;
+  m_pending = new char[m_capacity];
+  m_numPending = 0;
+  m_groupBytes = DEFAULTGROUPBYTES;
+  m_sync = false;
+  m_logPath = nullptr;
+  m_numFns = 0;
+  m_numRecords = 0;
+  m_recordStart = 0;
+  m_generation = 0;
+}
+
+// destructor - commits what is pending and closes the log
+Journal::~Journal(){
+  close();
+  delete[] m_pending;
+}
+
+// open - opens the log for appending, an empty log gets a header first
+bool Journal::open(const char* logPath, int groupBytes, bool syncCommits){
+  if (logPath == nullptr) {
+    return false;
+  }
+  close();
+
+  m_log = fopen(logPath, "ab");
+  if (m_log == nullptr) {
+    return false;
+  }
+  m_logPath = new char[strlen(logPath) + 1];
+  strcpy(m_logPath, logPath);
+  m_groupBytes = (groupBytes > 0) ? groupBytes : 1;
+  m_sync = syncCommits;
+  m_numRecords = 0;
+
+  // a new log continues from the last recovered or written snapshot
+  fseek(m_log, 0, SEEK_END);
+  if (ftell(m_log) == 0) {
+    fwrite(LOGMAGIC, 1, 4, m_log);
+    int32_t generation = m_generation;
+    fwrite(&generation, 4, 1, m_log);
+    fflush(m_log);
+  }
+  return true;
+}
+
+// commit - group commit, every pending record is written with one write
+bool Journal::commit(){
+  if (m_log == nullptr) {
+    m_numPending = 0;
+    return false;
+  }
+  if (m_numPending == 0) {
+    return true;
+  }
+
+  bool ok = fwrite(m_pending, 1, m_numPending, m_log) == (size_t)m_numPending;
+  ok = (fflush(m_log) == 0) && ok;
+  if (m_sync) {
+    ok = (fsync(fileno(m_log)) == 0) && ok;
+  }
+  m_numPending = 0;
+  return ok;
+}
+
+// close - commits and closes the log, registered functions are kept
+void Journal::close(){
+  if (m_log != nullptr) {
+    commit();
+    fclose(m_log);
+    m_log = nullptr;
+  }
+  delete[] m_logPath;
+  m_logPath = nullptr;
+  m_numPending = 0;
+}
+
+bool Journal::isOpen() const {
+  return m_log != nullptr;
+}
+
+// registerPriorityFn - gives the function the next id, a known function keeps its id
+int Journal::registerPriorityFn(prifn_t priFn){
+  int id = findFn(priFn);
+  if (id >= 0) {
+    return id;
+  }
+  if (priFn == nullptr || m_numFns == MAXJOURNALFNS) {
+    return -1;
+  }
+  m_fns[m_numFns] = priFn;
+  return m_numFns++;
+}
+
+// checkpoint - the snapshot already contains everything that is pending,
+// so pending records are dropped and the log starts over
+bool Journal::checkpoint(const char* snapshotPath, const Irrigator* irr, Region* regions[], int numRegions){
+  if (snapshotPath == nullptr) {
+    return false;
+  }
+
+  // build the snapshot in the record buffer
+  m_numPending = 0;
+  put(SNAPMAGIC, 4);
+  putInt(m_generation + 1);
+  putByte(irr != nullptr);
+  if (irr != nullptr) {
+    putIrrigator(*irr);
+  }
+  int count = 0;
+  for (int i = 0; i < numRegions; i++) {
+    if (regions[i] != nullptr) {
+      count++;
+    }
+  }
+  putInt(count);
+  for (int i = 0; i < numRegions; i++) {
+    if (regions[i] != nullptr) {
+      putInt(i);
+      putRegion(*regions[i]);
+    }
+  }
+
+  // write it next to the old one and swap it in
+  string tempPath = string(snapshotPath) + ".tmp";
+  FILE* out = fopen(tempPath.c_str(), "wb");
+  if (out == nullptr) {
+    m_numPending = 0;
+    return false;
+  }
+  bool ok = fwrite(m_pending, 1, m_numPending, out) == (size_t)m_numPending;
+  ok = (fflush(out) == 0) && ok;
+  ok = (fsync(fileno(out)) == 0) && ok;
+  fclose(out);
+  m_numPending = 0;
+  if (!ok || rename(tempPath.c_str(), snapshotPath) != 0) {
+    return false;
+  }
+  m_generation++;
+
+  // restart the log for the new generation
+  if (m_log != nullptr) {
+    string logPath = m_logPath;
+    fclose(m_log);
+    m_log = nullptr;
+    FILE* truncated = fopen(logPath.c_str(), "wb");
+    if (truncated == nullptr) {
+      return false;
+    }
+    fclose(truncated);
+    return open(logPath.c_str(), m_groupBytes, m_sync);
+  }
+  return true;
+}
+
+// recover - loads the snapshot and replays every complete record of the log
+long long Journal::recover(const char* snapshotPath, const char* logPath,
+                           Irrigator* irr, Region* regions[], int numRegions){
+  int generation = 0;
+
+  // the snapshot, if there is one
+  long size = 0;
+  char* data = (snapshotPath != nullptr) ? readFile(snapshotPath, size) : nullptr;
+  if (data != nullptr) {
+    generation = generationOf(data, size, SNAPMAGIC);
+    const char* pos = data + FILEHEADER;
+    const char* end = data + size;
+    int hasIrrigator = 0;
+    int count = 0;
+    bool ok = generation >= 0 && getByte(pos, end, hasIrrigator);
+    if (ok && hasIrrigator) {
+      ok = readIrrigator(pos, end, irr);
+    }
+    ok = ok && getInt(pos, end, count);
+    for (int i = 0; ok && i < count; i++) {
+      int tag = 0;
+      Region scratch;
+      ok = getInt(pos, end, tag);
+      bool known = ok && tag >= 0 && tag < numRegions && regions[tag] != nullptr;
+      ok = ok && readRegion(pos, end, known ? *regions[tag] : scratch);
+    }
+    delete[] data;
+    if (!ok) {
+      return -1;
+    }
+  }
+  m_generation = generation;
+
+  // the log, unless it belongs to an older snapshot
+  data = (logPath != nullptr) ? readFile(logPath, size) : nullptr;
+  if (data == nullptr) {
+    return 0;
+  }
+  long long replayed = 0;
+  if (generationOf(data, size, LOGMAGIC) == generation) {
+    const char* pos = data + FILEHEADER;
+    const char* end = data + size;
+    while (end - pos >= RECORDHEADER) {
+      int length = 0;
+      uint32_t sum = 0;
+      getInt(pos, end, length);
+      memcpy(&sum, pos, 4);
+      pos += 4;
+
+      // a torn record ends the log
+      if (length <= 0 || end - pos < length || checksum(pos, length) != sum) {
+        break;
+      }
+      const char* next = pos + length;
+      int op = 0;
+      int tag = 0;
+      getByte(pos, next, op);
+      getInt(pos, next, tag);
+      if (!replay((JOURNALOP)op, tag, pos, next, irr, regions, numRegions)) {
+        break;
+      }
+      pos = next;
+      replayed++;
+    }
+  }
+  delete[] data;
+  return replayed;
+}
+
+// logCrop - a single crop insertion, OPINSERTTIMED adds its deadline
+void Journal::logCrop(JOURNALOP op, int tag, const Crop& crop){
+  beginRecord(op, tag);
+  putCrop(crop);
+  if (op == OPINSERTTIMED) {
+    putInt(crop.m_deadline);
+  }
+  endRecord();
+}
+
+// logCrops - a bulk insertion, replayed as one bulk insertion so the heap shape matches
+void Journal::logCrops(JOURNALOP op, int tag, const Crop crops[], int count){
+  beginRecord(op, tag);
+  putInt(count);
+  for (int i = 0; i < count; i++) {
+    putCrop(crops[i]);
+    if (op == OPINSERTTIMEDCROPS) {
+      putInt(crops[i].m_deadline);
+    }
+  }
+  endRecord();
+}
+
+// logOp - an operation with up to three integer arguments
+void Journal::logOp(JOURNALOP op, int tag, int a, int b, int c){
+  beginRecord(op, tag);
+  switch (op) {
+  case OPREGIONPRIORITY:
+    putInt(a);
+    putByte(b);
+    break;
+  case OPREGIONSTRUCTURE:
+  case OPNEXTCROPIN:
+  case OPREGIONPARTITION:
+    putByte(a);
+    break;
+  case OPNTHREGION:
+  case OPREGIONBUDGET:
+  case OPEXPIRE:
+  case OPREGIONTTL:
+  case OPREGIONAGING:
+    putInt(a);
+    break;
+  case OPREGIONORDER:
+    putInt(a);
+    putByte(b);
+    break;
+  case OPSETPRIORITY:
+    putInt(a);
+    putByte(b);
+    putInt(c);
+    break;
+  case OPSETSTRUCTURE:
+    putByte(a);
+    putInt(b);
+    break;
+  default:
+    break;
+  }
+  endRecord();
+}
+
+// logRegion - an operation that brings a whole region along
+void Journal::logRegion(JOURNALOP op, int tag, const Region& region){
+  beginRecord(op, tag);
+  putRegion(region);
+  endRecord();
+}
+
+// logIrrigator - an operation that brings the whole region array along
+void Journal::logIrrigator(JOURNALOP op, const Irrigator& irr){
+  beginRecord(op, IRRIGATORTAG);
+  putIrrigator(irr);
+  endRecord();
+}
+
+/******************************************
+* Private function *
+******************************************/
+int Journal::findFn(prifn_t priFn) const {
+  for (int i = 0; i < m_numFns; i++) {
+    if (m_fns[i] == priFn) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+prifn_t Journal::fnAt(int id) const {
+  return (id >= 0 && id < m_numFns) ? m_fns[id] : nullptr;
+}
+
+// leaves room for the record header, filled in by endRecord
+void Journal::beginRecord(JOURNALOP op, int tag){
+  reserve(RECORDHEADER);
+  m_recordStart = m_numPending;
+  m_numPending += RECORDHEADER;
+  putByte(op);
+  putInt(tag);
+}
+
+// fills in the header of the record started by beginRecord
+void Journal::endRecord(){
+  int start = m_recordStart;
+  int32_t length = m_numPending - start - RECORDHEADER;
+  uint32_t sum = checksum(m_pending + start + RECORDHEADER, length);
+  memcpy(m_pending + start, &length, 4);
+  memcpy(m_pending + start + 4, &sum, 4);
+  m_numRecords++;
+
+  if (m_numPending >= m_groupBytes) {
+    commit();
+  }
+}
+
+void Journal::reserve(int bytes){
+  if (m_numPending + bytes <= m_capacity) {
+    return;
+  }
+  int capacity = m_capacity * 2;
+  while (capacity < m_numPending + bytes) {
+    capacity *= 2;
+  }
+  char* pending = new char[capacity];
+  memcpy(pending, m_pending, m_numPending);
+  delete[] m_pending;
+  m_pending = pending;
+  m_capacity = capacity;
+}
+
+void Journal::put(const void* data, int bytes){
+  reserve(bytes);
+  memcpy(m_pending + m_numPending, data, bytes);
+  m_numPending += bytes;
+}
+
+void Journal::putInt(int value){
+  int32_t raw = value;
+  put(&raw, 4);
+}
+
+void Journal::putLong(long long value){
+  int64_t raw = value;
+  put(&raw, 8);
+}
+
+void Journal::putByte(int value){
+  char raw = (char)value;
+  put(&raw, 1);
+}
+
+// a crop takes 8 bytes: ID and one byte for each bounded field
+void Journal::putCrop(const Crop& crop){
+  putInt(crop.m_cropID);
+  putByte(crop.m_temperature);
+  putByte(crop.m_moisture);
+  putByte(crop.m_time);
+  putByte(crop.m_type);
+}
+
+// configuration followed by the tree, so the exact shape is restored
+void Journal::putRegion(const Region& region){
+  putInt(registerPriorityFn(region.m_priorFunc));
+  putByte(region.m_heapType);
+  putByte(region.m_structure);
+  putInt(region.m_regPrior);
+  putByte(region.m_persistent);
+  putByte(region.m_partition);
+  putInt(region.m_order.encode());
+  putByte(region.m_order.numFields());
+  putInt(region.m_aging);
+  putInt(region.m_size);
+  // every tree holds some of the crops, one walk stack fits them all
+  const Crop** stack = new const Crop*[region.m_size + 1];
+  for (int i = 0; i < region.numHeaps(); i++) {
+    putByte(region.heapAt(i) != nullptr);
+    putTree(region.heapAt(i), stack);
+  }
+  // a rebuild in progress, its subtrees from the bottom of the stack up
+  putInt(region.m_rebuildBudget);
+  putInt(region.m_numPending);
+  for (int i = 0; i < region.m_numPending; i++) {
+    putTree(region.m_pending[i], stack);
+  }
+  delete[] stack;
+  // the clock, the deadlines are in the trees
+  putInt(region.m_wheel.now());
+  putInt(region.m_ttl);
+}
+
+// preorder, every node carries its npl, which children follow and whether
+// a deadline and an epoch do. Without recursion, a skew heap may be as deep
+// as it is large; the stack has room for one node per crop plus one.
+void Journal::putTree(const Crop* root, const Crop** stack){
+  int top = 0;
+  if (root != nullptr) stack[top++] = root;
+  while (top > 0) {
+    const Crop* node = stack[--top];
+    putCrop(*node);
+    putByte(node->m_npl);
+    putByte((node->m_left != nullptr) | ((node->m_right != nullptr) << 1)
+            | ((node->m_deadline != 0) << 2) | ((node->m_epoch != 0) << 3));
+    if (node->m_deadline != 0) {
+      putInt(node->m_deadline);
+    }
+    if (node->m_epoch != 0) {
+      putInt(node->m_epoch);
+    }
+    if (node->m_right != nullptr) stack[top++] = node->m_right;
+    if (node->m_left != nullptr) stack[top++] = node->m_left;
+  }
+}
+
+// the region array is written in index order so ties resolve the same way
+void Journal::putIrrigator(const Irrigator& irr){
+  putInt(irr.m_capacity);
+  putByte(irr.m_schedule);
+  putLong(irr.m_virtualTime);
+  putInt(irr.m_size);
+  for (int i = ROOTINDEX; i <= irr.m_size; i++) {
+    putRegion(irr.regionAt(i));
+    putLong(irr.regionAt(i).m_pass);
+  }
+}
+
+// applies one logged operation
+bool Journal::replay(JOURNALOP op, int tag, const char*& pos, const char* end,
+                     Irrigator* irr, Region* regions[], int numRegions){
+  int a = 0, b = 0, c = 0;
+
+  // Irrigator operations
+  if (tag == IRRIGATORTAG) {
+    if (irr == nullptr) {
+      return true;  // not being recovered, the payload is skipped by the caller
+    }
+    Region scratch;
+    Crop crop;
+    switch (op) {
+    case OPADDREGION:
+      if (!readRegion(pos, end, scratch)) return false;
+      irr->addRegion(scratch);
+      return true;
+    case OPGETREGION:
+      irr->getRegion(scratch);
+      return true;
+    case OPNTHREGION:
+      if (!getInt(pos, end, a)) return false;
+      irr->getNthRegion(scratch, a);
+      return true;
+    case OPGETCROP:
+      irr->getCrop(crop);
+      return true;
+    case OPDROPEMPTY:
+      irr->topRegion();
+      return true;
+    case OPSETPRIORITY:
+      if (!getInt(pos, end, a) || !getByte(pos, end, b) || !getInt(pos, end, c)) return false;
+      irr->setPriorityFn(fnAt(a), (HEAPTYPE)b, c);
+      return true;
+    case OPSETSTRUCTURE:
+      if (!getByte(pos, end, a) || !getInt(pos, end, b)) return false;
+      irr->setStructure((STRUCTURE)a, b);
+      return true;
+    case OPEXPIRE:
+      if (!getInt(pos, end, a)) return false;
+      irr->expire(a);
+      return true;
+    case OPMERGEIRRIGATOR: {
+      // the logged irrigator is rebuilt at its own capacity, then merged in
+      const char* peek = pos;
+      if (!getInt(peek, end, a) || a <= 0) return false;
+      Irrigator merged(a);
+      if (!readIrrigator(pos, end, &merged)) return false;
+      irr->mergeWith(merged);
+      return true;
+    }
+    case OPASSIGN:
+      return readIrrigator(pos, end, irr);
+    default:
+      return false;
+    }
+  }
+
+  // Region operations, records of untracked regions are skipped
+  if (tag < 0 || tag >= numRegions || regions[tag] == nullptr) {
+    return true;
+  }
+  Region& region = *regions[tag];
+  Region scratch;
+  switch (op) {
+  case OPINSERTCROP:
+  case OPINSERTTIMED: {
+    Crop crop;
+    if (!readCrop(pos, end, op == OPINSERTTIMED, crop)) return false;
+    region.insertCrop(crop);
+    return true;
+  }
+  case OPINSERTCROPS:
+  case OPINSERTTIMEDCROPS: {
+    int count = 0;
+    bool timed = (op == OPINSERTTIMEDCROPS);
+    if (!getInt(pos, end, count) || count < 0 || (end - pos) / (timed ? 12 : 8) < count) return false;
+    Crop* crops = new Crop[count > 0 ? count : 1];
+    for (int i = 0; i < count; i++) {
+      readCrop(pos, end, timed, crops[i]);
+    }
+    region.insertCrops(crops, count);
+    delete[] crops;
+    return true;
+  }
+  case OPNEXTCROP:
+    if (region.numCrops() > 0) region.getNextCrop();
+    return true;
+  case OPMERGEQUEUE:
+    if (!readRegion(pos, end, scratch)) return false;
+    try {
+      region.mergeWithQueue(scratch);
+    } catch (const domain_error&) {
+      // the original merge failed the same way
+    }
+    return true;
+  case OPREGIONPRIORITY:
+    if (!getInt(pos, end, a) || !getByte(pos, end, b)) return false;
+    region.setPriorityFn(fnAt(a), (HEAPTYPE)b);
+    return true;
+  case OPREGIONSTRUCTURE:
+    if (!getByte(pos, end, a)) return false;
+    region.setStructure((STRUCTURE)a);
+    return true;
+  case OPNEXTCROPIN:
+    if (!getByte(pos, end, a)) return false;
+    if (region.numCrops(a) > 0) region.getNextCrop(a);
+    return true;
+  case OPREGIONPARTITION:
+    if (!getByte(pos, end, a)) return false;
+    region.setPartition((PARTITION)a);
+    return true;
+  case OPREGIONORDER: {
+    CropOrder order;
+    if (!getInt(pos, end, a) || !getByte(pos, end, b) || !order.decode(a, b)) return false;
+    region.setOrder(order);
+    return true;
+  }
+  case OPREGIONBUDGET:
+    if (!getInt(pos, end, a)) return false;
+    region.setRebuildBudget(a);
+    return true;
+  case OPREBUILDSTEP:
+    region.rebuildStep();
+    return true;
+  case OPLASTCROP:
+    if (region.numCrops() > 0) region.getLastCrop();
+    return true;
+  case OPEXPIRE:
+    if (!getInt(pos, end, a)) return false;
+    region.expire(a);
+    return true;
+  case OPREGIONTTL:
+    if (!getInt(pos, end, a)) return false;
+    region.setTTL(a);
+    return true;
+  case OPREGIONAGING:
+    if (!getInt(pos, end, a)) return false;
+    region.setAging(a);
+    return true;
+  case OPCLEAR:
+    region.clear();
+    return true;
+  case OPASSIGN:
+    return readRegion(pos, end, region);
+  default:
+    return false;
+  }
+}
+
+// replaces the contents and configuration of the region
+bool Journal::readRegion(const char*& pos, const char* end, Region& region){
+  int id = 0, heapType = 0, structure = 0, regPrior = 0, persistent = 0, partition = 0, size = 0;
+  int orderCode = 0, orderFields = 0, aging = 0;
+  if (!getInt(pos, end, id) || !getByte(pos, end, heapType) || !getByte(pos, end, structure)
+      || !getInt(pos, end, regPrior) || !getByte(pos, end, persistent)
+      || !getByte(pos, end, partition) || !getInt(pos, end, orderCode)
+      || !getByte(pos, end, orderFields) || !getInt(pos, end, aging) || !getInt(pos, end, size)) {
+    return false;
+  }
+
+  region.emptyHeap();
+  region.m_priorFunc = fnAt(id);
+  region.m_heapType = (HEAPTYPE)heapType;
+  region.m_structure = (STRUCTURE)structure;
+  region.m_regPrior = regPrior;
+  region.m_persistent = persistent != 0;
+  region.m_partition = (PARTITION)partition;
+  region.m_aging = aging;
+  if (!region.m_order.decode(orderCode, orderFields)) {
+    return false;
+  }
+
+  // every crop takes at least MINTREENODE bytes, a larger size is corrupt;
+  // the walks share stacks of one entry per crop plus one
+  if (size < 0 || size > (end - pos) / MINTREENODE) {
+    return false;
+  }
+  Crop** stack = new Crop*[size + 1];
+  Crop*** links = new Crop**[size + 1];
+  bool ok = readTrees(pos, end, region, size, stack, links);
+  delete[] stack;
+  delete[] links;
+  return ok;
+}
+
+// the trees of readRegion: one per sub-heap, each after a flag telling whether
+// it is empty, then the pending subtrees and the clock
+bool Journal::readTrees(const char*& pos, const char* end, Region& region, int size,
+                        Crop** stack, Crop*** links){
+  int total = 0;
+  for (int i = 0; i < region.numHeaps(); i++) {
+    int count = 0, present = 0;
+    if (!getByte(pos, end, present)) {
+      return false;
+    }
+    Crop* root = present ? readTree(pos, end, count, size - total, links) : nullptr;
+    if (present && root == nullptr) {
+      return false;
+    }
+    if (region.m_priorFunc != nullptr) {
+      region.rekeyHeap(root, stack);   // keys are not stored, they follow from the configuration
+    }
+    region.tallyHeap(root, stack);
+    region.relocate(root, links);      // into the region's arena, if it has one
+    region.heapAt(i) = root;
+    region.m_partSize[i] = count;
+    total += count;
+  }
+
+  // pending subtrees are not keyed, they are keyed when the rebuild reaches them
+  int budget = 0, numPending = 0;
+  if (!getInt(pos, end, budget) || !getInt(pos, end, numPending) || numPending < 0) {
+    return false;
+  }
+  region.m_rebuildBudget = budget;
+  for (int i = 0; i < numPending; i++) {
+    int count = 0;
+    Crop* root = readTree(pos, end, count, size - total, links);
+    if (root == nullptr) {
+      return false;
+    }
+    region.tallyHeap(root, stack);
+    countPartitions(region, root, stack);
+    region.relocate(root, links);
+    region.pushPending(root);
+    region.m_pendingCrops += count;
+    total += count;
+  }
+  region.m_size = total;
+
+  // the deadlines go back into a wheel at the logged clock
+  int now = 0, ttl = 0;
+  if (!getInt(pos, end, now) || !getInt(pos, end, ttl)) {
+    return false;
+  }
+  region.m_wheel.reset(now);
+  region.m_ttl = ttl;
+  for (int i = 0; i < region.numHeaps(); i++) {
+    region.addDeadlines(region.heapAt(i), stack);
+  }
+  for (int i = 0; i < region.m_numPending; i++) {
+    region.addDeadlines(region.m_pending[i], stack);
+  }
+  return total == size;
+}
+
+// adds the crops of a pending subtree to the sizes of their sub-heaps
+void Journal::countPartitions(Region& region, Crop* root, Crop** stack){
+  int top = 0;
+  if (root != nullptr) stack[top++] = root;
+  while (top > 0) {
+    Crop* node = stack[--top];
+    region.m_partSize[region.partitionOf(*node)]++;
+    if (node->m_right != nullptr) stack[top++] = node->m_right;
+    if (node->m_left != nullptr) stack[top++] = node->m_left;
+  }
+}
+
+// rebuilds a preorder tree written by putTree without recursion: slots holds
+// the links still to be read, the left one on top, and has room for limit + 1.
+// A truncated record or more than limit crops frees what was read and fails.
+Crop* Journal::readTree(const char*& pos, const char* end, int& count, int limit, Crop*** slots){
+  Crop* root = nullptr;
+  int top = 0;
+  Crop** link = &root;   // the root's link stays local, the others go on the stack
+  while (link != nullptr) {
+    int ID = 0, temperature = 0, moisture = 0, time = 0, type = 0, npl = 0, children = 0;
+    if (count >= limit || !getInt(pos, end, ID) || !getByte(pos, end, temperature)
+        || !getByte(pos, end, moisture) || !getByte(pos, end, time) || !getByte(pos, end, type)
+        || !getByte(pos, end, npl) || !getByte(pos, end, children)) {
+      deleteTree(root);
+      return nullptr;
+    }
+    Crop* node = new Crop(ID, temperature, moisture, time, type);
+    node->m_npl = npl;
+    *link = node;
+    count++;
+    if (((children & 4) && !getInt(pos, end, node->m_deadline))
+        || ((children & 8) && !getInt(pos, end, node->m_epoch))) {
+      deleteTree(root);
+      return nullptr;
+    }
+    if (children & 2) slots[top++] = &node->m_right;
+    if (children & 1) slots[top++] = &node->m_left;
+    link = (top > 0) ? slots[--top] : nullptr;
+  }
+  return root;
+}
+
+// frees a tree read from the log, rotating left children up instead of recursing
+void Journal::deleteTree(Crop* root){
+  while (root != nullptr) {
+    if (root->m_left != nullptr) {
+      Crop* left = root->m_left;
+      root->m_left = left->m_right;
+      left->m_right = root;
+      root = left;
+    }
+    else {
+      Crop* right = root->m_right;
+      delete root;
+      root = right;
+    }
+  }
+}
+
+// a crop written by putCrop, followed by its deadline when timed
+bool Journal::readCrop(const char*& pos, const char* end, bool timed, Crop& crop){
+  int ID = 0, temperature = 0, moisture = 0, time = 0, type = 0, deadline = 0;
+  if (!getInt(pos, end, ID) || !getByte(pos, end, temperature) || !getByte(pos, end, moisture)
+      || !getByte(pos, end, time) || !getByte(pos, end, type)
+      || (timed && !getInt(pos, end, deadline))) {
+    return false;
+  }
+  crop = Crop(ID, temperature, moisture, time, type);
+  crop.setDeadline(deadline);
+  return true;
+}
+
+// restores the region array slot by slot, without a target the regions are skipped
+bool Journal::readIrrigator(const char*& pos, const char* end, Irrigator* irr){
+  int capacity = 0, schedule = 0, size = 0;
+  long long virtualTime = 0;
+  if (!getInt(pos, end, capacity) || !getByte(pos, end, schedule)
+      || !getLong(pos, end, virtualTime) || !getInt(pos, end, size)) {
+    return false;
+  }
+  if (size < 0 || (irr != nullptr && size > irr->m_capacity - 1)) {
+    return false;
+  }
+
+  if (irr != nullptr) {
+    irr->m_schedule = (SCHEDULE)schedule;
+    irr->m_virtualTime = virtualTime;
+    irr->resetSlots(size);
+  }
+  for (int i = ROOTINDEX; i <= size; i++) {
+    Region scratch;
+    Region& target = (irr != nullptr) ? irr->regionAt(i) : scratch;
+    if (!readRegion(pos, end, target) || !getLong(pos, end, target.m_pass)) {
+      return false;
+    }
+    if (irr != nullptr) {
+      irr->refreshEntry(i);
+    }
+  }
+  return true;
+}
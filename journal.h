@@ -0,0 +1,102 @@
+// CMSC 341 - Fall 2025 - Project 3
+// Append-only write-ahead log for Region and Irrigator operations.
+// Records are batched in memory and written out together (group commit);
+// recovery loads the last checkpoint and replays the log on top of it.
+#ifndef JOURNAL_H
+#define JOURNAL_H
+#include <cstdio>
+#include "irrigator.h"
+
+#define DEFAULTGROUPBYTES 65536   // pending bytes that trigger a group commit
+#define MAXJOURNALFNS 32          // number of priority functions that can be registered
+#define IRRIGATORTAG -1           // tag of records that belong to the Irrigator
+
+// operations recorded in the log
+enum JOURNALOP {
+    // Region operations
+    OPINSERTCROP, OPINSERTCROPS, OPNEXTCROP, OPMERGEQUEUE, OPREGIONPRIORITY, OPREGIONSTRUCTURE,
+    OPCLEAR, OPASSIGN,
+    // Irrigator operations
+    OPADDREGION, OPGETREGION, OPNTHREGION, OPGETCROP, OPSETPRIORITY, OPSETSTRUCTURE,
+    // Region operations added later, appended so old logs keep their meaning
+    OPNEXTCROPIN, OPREGIONPARTITION, OPREGIONORDER, OPREGIONBUDGET, OPREBUILDSTEP, OPLASTCROP,
+    // inserts of crops with deadlines carry them, OPEXPIRE is also an Irrigator operation
+    OPINSERTTIMED, OPINSERTTIMEDCROPS, OPEXPIRE, OPREGIONTTL,
+    // Irrigator::mergeWith, brings the merged irrigator along
+    OPMERGEIRRIGATOR, OPREGIONAGING,
+    // the Irrigator dropped the empty regions at its root without serving a crop
+    OPDROPEMPTY
+};
+
+class Journal{
+    public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // for testing purposes
+    Journal();
+    ~Journal();   // commits and closes the log
+    Journal(const Journal& rhs) = delete;
+    Journal& operator=(const Journal& rhs) = delete;
+    // Opens the log for appending. syncCommits also fsyncs every group commit.
+    bool open(const char* logPath, int groupBytes = DEFAULTGROUPBYTES, bool syncCommits = false);
+    bool commit();  // writes the pending batch
+    void close();
+    bool isOpen() const;
+    // Priority functions are logged by id, so recovery has to register the
+    // same functions in the same order. Functions that were not registered get
+    // the next id when they are first logged. Returns the id, -1 if the table is full.
+    int registerPriorityFn(prifn_t priFn);
+    // Writes a snapshot of the Irrigator (may be nullptr) and of the tagged
+    // regions (regions[tag]), then truncates the log.
+    bool checkpoint(const char* snapshotPath, const Irrigator* irr, Region* regions[], int numRegions);
+    // Restores the last checkpoint (a missing snapshot means empty state) and
+    // replays the log. The targets must not be attached to a journal.
+    // Returns the number of records replayed, -1 on error.
+    long long recover(const char* snapshotPath, const char* logPath,
+                      Irrigator* irr, Region* regions[], int numRegions);
+
+    // recording, called by Region and Irrigator
+    void logCrop(JOURNALOP op, int tag, const Crop& crop);
+    void logCrops(JOURNALOP op, int tag, const Crop crops[], int count);
+    void logOp(JOURNALOP op, int tag, int a = 0, int b = 0, int c = 0);
+    void logRegion(JOURNALOP op, int tag, const Region& region);
+    void logIrrigator(JOURNALOP op, const Irrigator& irr);
+
+    private:
+    FILE * m_log;                     // open log file
+    char * m_pending;                 // records waiting for the next commit
+    int m_numPending;                 // bytes in m_pending
+    int m_capacity;                   // size of m_pending
+    int m_groupBytes;                 // commit threshold
+    bool m_sync;                      // fsync on every commit
+    char * m_logPath;                 // kept for truncation at checkpoints
+    prifn_t m_fns[MAXJOURNALFNS];     // registered priority functions
+    int m_numFns;
+    long long m_numRecords;           // records appended since open
+    int m_recordStart;                // offset of the record being built
+    int m_generation;                 // checkpoint generation the log belongs to
+
+    int findFn(prifn_t priFn) const;
+    prifn_t fnAt(int id) const;
+    void beginRecord(JOURNALOP op, int tag);
+    void endRecord();
+    void reserve(int bytes);
+    void put(const void* data, int bytes);
+    void putInt(int value);
+    void putByte(int value);
+    void putLong(long long value);
+    void putCrop(const Crop& crop);
+    void putRegion(const Region& region);
+    void putTree(const Crop* root, const Crop** stack);
+    void putIrrigator(const Irrigator& irr);
+    bool replay(JOURNALOP op, int tag, const char*& pos, const char* end,
+                Irrigator* irr, Region* regions[], int numRegions);
+    bool readRegion(const char*& pos, const char* end, Region& region);
+    bool readTrees(const char*& pos, const char* end, Region& region, int size,
+                   Crop** stack, Crop*** links);
+    Crop* readTree(const char*& pos, const char* end, int& count, int limit, Crop*** slots);
+    static void deleteTree(Crop* root);
+    bool readCrop(const char*& pos, const char* end, bool timed, Crop& crop);
+    void countPartitions(Region& region, Crop* root, Crop** stack);
+    bool readIrrigator(const char*& pos, const char* end, Irrigator* irr);
+};
+#endif
@@ -3,11 +3,28 @@
 // professor: Kartchner
 
 #include "irrigator.h"
+#include "croploader.h"
+#include "journal.h"
+#include "tracing.h"
+#include "croparena.h"
+#include "sharded.h"
+#include "pipeline.h"
+#include "cropexporter.h"
+#include "relaxed.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
 #include <stdexcept>
 #include <vector>
 #include <unordered_set>
 #include <algorithm>
 #include <random>
+#include <cstdint>
+#include <cmath>
+#include <climits>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
 using namespace std;
 
 // ------------------------------
@@ -174,6 +191,26 @@ int priorityFn2(const Crop &crop) {
     }
 }
 
+// priorityFn2 for even crop IDs, odd IDs are invalid (pipeline tests)
+int evenIdPriority(const Crop &crop) {
+    return (crop.getCropID() % 2 == 0) ? priorityFn2(crop) : 0;
+}
+
+// one priority per crop ID, 0 for the default ID (relaxed tests)
+int idPriority(const Crop &crop) {
+    return crop.getCropID() - DEFAULTCROPID;
+}
+
+// a recording valve, it waits while the gate is closed (pipeline tests)
+static mutex s_valveLock;
+static vector<Crop> s_valveLog;
+static atomic<bool> s_valveGate(true);
+void recordingValve(const Crop &crop) {
+    while (!s_valveGate.load()) this_thread::sleep_for(chrono::microseconds(100));
+    lock_guard<mutex> guard(s_valveLock);
+    s_valveLog.push_back(crop);
+}
+
 // ------------------------------
 // Tester with helpers and tests
 // ------------------------------
@@ -273,6 +310,14 @@ public:
         collectIDs(node->m_right, out);
     }
 
+    // Recursively counts the nodes of a tree that came from the given arena
+    // (nullptr: the nodes allocated with new)
+    static int countArenaNodes(const Crop* node, const CropArena* arena){
+        if (!node) return 0;
+        return (node->m_arena == arena) + countArenaNodes(node->m_left, arena)
+            + countArenaNodes(node->m_right, arena);
+    }
+
     // Recursively counts the total number of nodes in a tree of Crop objects
     static int countNodes(Crop* node){
         if (!node) return 0;
@@ -647,15 +692,1859 @@ public:
         bool result = irr.setStructure(LEFTIST, 1);
         return result;
     }
+
+    // Drains copies of two regions and compares the crop IDs in pop order
+    static bool samePopOrder(const Region& a, const Region& b){
+        Region x(a), y(b);
+        if (x.numCrops() != y.numCrops()) return false;
+        while (x.numCrops() > 0){
+            if (x.getNextCrop().getCropID() != y.getNextCrop().getCropID()) return false;
+        }
+        return x.m_regPrior == y.m_regPrior && x.m_heapType == y.m_heapType
+            && x.m_structure == y.m_structure && x.m_priorFunc == y.m_priorFunc;
+    }
+
+    // Drains two irrigators and compares the crop IDs in dispatch order
+    static bool sameDispatchOrder(Irrigator& a, Irrigator& b){
+        if (a.m_size != b.m_size) return false;
+        Crop x, y;
+        while (true){
+            bool gotA = a.getCrop(x);
+            bool gotB = b.getCrop(y);
+            if (gotA != gotB) return false;
+            if (!gotA) return true;
+            if (x.getCropID() != y.getCropID()) return false;
+        }
+    }
+
+    // ---------- CROP LOADER TESTS ----------
+
+    // Test 30: CSV records are clamped, routed by region and bulk-built
+    bool testLoaderCSV(){
+        Region r1(priorityFn2, MINHEAP, LEFTIST, 1);
+        Region r2(priorityFn2, MINHEAP, SKEW, 2);
+        FILE* in = tmpfile();
+        if (!in) return false;
+        fputs("ID,temperature,moisture,time,type,region\n", in);
+        fputs("123456,70,30,0,1,1\n", in);
+        fputs("234567, 65, 40, 1, 2, 2\r\n", in);
+        fputs("345678,500,500,9,9,1\n", in);   // clamped like the Crop constructor
+        fputs("456789,70,30,0,1,7\n", in);     // unknown region
+        fputs("12x,70,30,0,1,1\n", in);        // malformed
+        fputs("\n# comment\n", in);
+        for (int i = 0; i < 500; i++){
+            fprintf(in, "%d,%d,%d,%d,%d,%d\n", MINCROPID + i, 40 + i % 60,
+                    1 + i % 100, i % 4, i % 7, 1 + i % 2);
+        }
+        fputs("567890,70,30,0,1,2", in);        // no trailing newline
+        rewind(in);
+
+        // a tiny chunk forces lines to be split across reads
+        CropLoader loader(256, 64);
+        loader.addRoute(1, r1);
+        loader.addRoute(2, r2);
+        long long loaded = loader.loadStream(in, CSVRECORD);
+        fclose(in);
+
+        // the clamped record has moisture 100 and time NIGHT
+        bool clamped = false;
+        Region copy(r1);
+        while (copy.numCrops() > 0){
+            Crop c = copy.getNextCrop();
+            if (c.getCropID() == 345678)
+                clamped = c.getMoisture() == MAXMOISTURE && c.getTime() == MAXTIME
+                          && c.getTemperature() == MINTEMP && c.getType() == MINTYPE;
+        }
+        return loaded == 504 && loader.numRejected() == 1 && loader.numUnrouted() == 1
+            && r1.numCrops() == 252 && r2.numCrops() == 252
+            && countNodes(r1.m_heap) == 252 && checkHeapProperty(r1)
+            && checkLeftistProperty(r1) && checkLeftistNPLValues(r1)
+            && checkHeapProperty(r2) && checkRemovalOrder(r2) && clamped;
+    }
+
+    // Test 31: Binary records load into the same heaps as the equivalent inserts
+    bool testLoaderBinary(){
+        Region loaded(priorityFn1, MAXHEAP, SKEW, 5);
+        Region expected(priorityFn1, MAXHEAP, SKEW, 5);
+        FILE* in = tmpfile();
+        if (!in) return false;
+        Random temperatureGen(MINTEMP, MAXTEMP);
+        for (int i = 0; i < 1000; i++){
+            int32_t rec[6] = {MINCROPID + i, temperatureGen.getRandNum(), 50, i % 4, i % 7, 5};
+            fwrite(rec, sizeof(rec), 1, in);
+            expected.insertCrop(Crop(rec[0], rec[1], rec[2], rec[3], rec[4]));
+        }
+        fputc(1, in); // truncated record
+        rewind(in);
+
+        CropLoader loader(1000, 300);
+        loader.addRoute(5, loaded);
+        long long count = loader.loadStream(in, BINARYRECORD);
+        fclose(in);
+        return count == 1000 && loader.numRejected() == 1
+            && sameIDsAfterRebuild(expected, loaded) && checkHeapProperty(loaded)
+            && checkRemovalOrder(loaded);
+    }
+
+    // ---------- JOURNAL TESTS ----------
+
+    // Test 32: Replaying the log rebuilds regions and the irrigator exactly
+    bool testJournalReplay(){
+        const char* logPath = "journal_test.log";
+        remove(logPath);
+        Region live0(priorityFn2, MINHEAP, LEFTIST, 10);
+        Region live1(priorityFn1, MAXHEAP, SKEW, 20);
+        Irrigator liveIrr(10);
+        {
+            Journal journal;
+            journal.registerPriorityFn(priorityFn1);
+            journal.registerPriorityFn(priorityFn2);
+            if (!journal.open(logPath, 256)) return false;
+            live0.setJournal(&journal, 0);
+            live1.setJournal(&journal, 1);
+            liveIrr.setJournal(&journal);
+
+            Region src = buildRegion(priorityFn2, MINHEAP, LEFTIST, 10, 60, 140);
+            live0.mergeWithQueue(src);
+            Random idGen(MINCROPID, MAXCROPID);
+            for (int i = 0; i < 40; i++)
+                live1.insertCrop(Crop(idGen.getRandNum(), 30 + i, 50, i % 4, i % 7));
+            for (int i = 0; i < 5; i++) live0.getNextCrop();
+            live1.setStructure(LEFTIST);
+            live0.setPriorityFn(priorityFn1, MAXHEAP);
+            for (int i = 1; i <= 4; i++){
+                Region r = buildRegion(priorityFn2, MINHEAP, SKEW, i * 5, 10, 141 + i);
+                liveIrr.addRegion(r);
+            }
+            liveIrr.setStructure(LEFTIST, 2);
+            liveIrr.setPriorityFn(priorityFn1, MAXHEAP, 1);
+            Crop c;
+            for (int i = 0; i < 7; i++) liveIrr.getCrop(c);
+            Region out;
+            liveIrr.getNthRegion(out, 2);
+            live0.setJournal(nullptr, 0);
+            live1.setJournal(nullptr, 0);
+            liveIrr.setJournal(nullptr);
+        }
+
+        Region restored0, restored1;
+        Region* regions[2] = {&restored0, &restored1};
+        Irrigator restoredIrr(10);
+        Journal recovery;
+        recovery.registerPriorityFn(priorityFn1);
+        recovery.registerPriorityFn(priorityFn2);
+        long long replayed = recovery.recover(nullptr, logPath, &restoredIrr, regions, 2);
+        remove(logPath);
+        return replayed > 50 && samePopOrder(live0, restored0) && samePopOrder(live1, restored1)
+            && checkLeftistNPLValues(restored1) && sameDispatchOrder(liveIrr, restoredIrr);
+    }
+
+    // Test 33: Checkpoint plus log recovers, a torn last record is ignored
+    bool testJournalCheckpoint(){
+        const char* logPath = "journal_test.log";
+        const char* snapPath = "journal_test.snap";
+        remove(logPath);
+        remove(snapPath);
+        Region live(priorityFn2, MINHEAP, SKEW, 3);
+        Irrigator liveIrr(8);
+        Region* liveRegions[1] = {&live};
+        {
+            Journal journal;
+            journal.registerPriorityFn(priorityFn2);
+            if (!journal.open(logPath)) return false;
+            live.setJournal(&journal, 0);
+            liveIrr.setJournal(&journal);
+            Region batch = buildRegion(priorityFn2, MINHEAP, SKEW, 3, 100, 150);
+            live.mergeWithQueue(batch);
+            Region r = buildRegion(priorityFn2, MINHEAP, SKEW, 4, 30, 151);
+            liveIrr.addRegion(r);
+            if (!journal.checkpoint(snapPath, &liveIrr, liveRegions, 1)) return false;
+            for (int i = 0; i < 10; i++) live.getNextCrop();
+            Crop crops[3] = {Crop(111111, 60, 5, 0, 1), Crop(222222, 60, 7, 1, 2), Crop(333333, 60, 9, 2, 3)};
+            live.insertCrops(crops, 3);
+            Crop c;
+            liveIrr.getCrop(c);
+            live.setJournal(nullptr, 0);
+            liveIrr.setJournal(nullptr);
+        }
+        // a half written record at the end of the log
+        FILE* log = fopen(logPath, "ab");
+        if (!log) return false;
+        int garbage[2] = {100, 7};
+        fwrite(garbage, sizeof(garbage), 1, log);
+        fclose(log);
+
+        Region restored;
+        Region* regions[1] = {&restored};
+        Irrigator restoredIrr(8);
+        Journal recovery;
+        recovery.registerPriorityFn(priorityFn2);
+        long long replayed = recovery.recover(snapPath, logPath, &restoredIrr, regions, 1);
+        remove(logPath);
+        remove(snapPath);
+        return replayed == 12 && samePopOrder(live, restored) && sameDispatchOrder(liveIrr, restoredIrr);
+    }
+
+    // ---------- COUNTER TESTS ----------
+
+    // Test 34: Hot-path counters track the heap work (all zero without IRRIGATOR_STATS)
+    bool testCounters(){
+        Region r(priorityFn2, MINHEAP, SKEW, 10);
+        Random moistureGen(MINMOISTURE, MAXMOISTURE);
+        for (int i = 0; i < 200; i++)
+            r.insertCrop(Crop(MINCROPID + i, 70, moistureGen.getRandNum(), i % 4, i % 7));
+        for (int i = 0; i < 50; i++) r.getNextCrop();
+        RegionCounters c = r.counters();
+
+        Irrigator irr(10);
+        for (int i = 5; i >= 1; i--){
+            Region region = buildRegion(priorityFn2, MINHEAP, LEFTIST, i, 5, 160 + i);
+            irr.addRegion(region);
+        }
+        Crop crop;
+        irr.getCrop(crop);
+        IrrigatorCounters ic = irr.counters();
+#ifdef IRRIGATOR_STATS
+        // merges compare cached keys, the priority function runs once per crop
+        int spine = 0;
+        for (Crop* node = r.m_heap; node; node = node->m_right) spine++;
+        return c.nodeAllocs == 200 && c.nodeFrees == 50 && c.merges == 250
+            && c.mergeSteps >= 250 && c.priorityCalls == 200
+            && c.maxMergeDepth > 0 && c.rightSpine == spine
+            && ic.siftCalls == 7 && ic.siftSteps > 0 && ic.regionCopies == 5;
+#else
+        return c.merges == 0 && c.nodeAllocs == 0 && c.rightSpine == 0 && ic.siftCalls == 0;
+#endif
+    }
+
+    // ---------- TRACING TESTS ----------
+
+    // Test 35: Log-bucket histogram percentiles stay within bucket precision
+    bool testLatencyHistogram(){
+        LatencyHistogram h;
+        for (long long v = 1; v <= 100000; v++) h.record(v * 10);
+        long long p50 = h.percentile(50), p99 = h.percentile(99), p999 = h.percentile(99.9);
+        bool bucketsOK = true;
+        for (long long v = 0; v < 5000000; v += 997){
+            int b = LatencyHistogram::bucketOf(v);
+            if (v < LatencyHistogram::bucketLow(b) || v > LatencyHistogram::bucketHigh(b)) bucketsOK = false;
+        }
+        return h.count() == 100000 && h.maxValue() == 1000000
+            && p50 >= 500000 && p50 <= 500000 * 1.07
+            && p99 >= 990000 && p99 <= 1000000
+            && p999 >= 999000 && p999 <= 1000000
+            && h.percentile(100) == 1000000 && bucketsOK;
+    }
+
+    // Test 36: Histograms recorded by several threads are merged on read
+    bool testTracerMerge(){
+        long long before = Tracer::histogram(TRACENEXTCROP).count();
+        const int perThread = 20000;
+        thread a([](){ for (int i = 0; i < perThread; i++) Tracer::record(TRACENEXTCROP, 100 + i % 50); });
+        thread b([](){ for (int i = 0; i < perThread; i++) Tracer::record(TRACENEXTCROP, 5000); });
+        a.join();
+        b.join();
+        Tracer::record(TRACENEXTCROP, 7);
+        LatencyHistogram merged = Tracer::histogram(TRACENEXTCROP);
+        bool mergedOK = merged.count() == before + 2 * perThread + 1 && merged.maxValue() >= 5000;
+
+        // the hooks only record when compiled in and enabled
+        long long crops = Tracer::histogram(TRACEGETCROP).count();
+        Irrigator irr(5);
+        Region r = buildRegion(priorityFn2, MINHEAP, SKEW, 10, 20, 170);
+        irr.addRegion(r);
+        Tracer::enable(true);
+        Crop c;
+        for (int i = 0; i < 5; i++) irr.getCrop(c);
+        Tracer::enable(false);
+        irr.getCrop(c);
+        long long traced = Tracer::histogram(TRACEGETCROP).count() - crops;
+#ifdef IRRIGATOR_TRACE
+        bool hooksOK = traced == 5;
+#else
+        bool hooksOK = traced == 0;
+#endif
+        const char* path = "trace_test.csv";
+        bool dumped = Tracer::dump(path);
+        remove(path);
+        return mergedOK && hooksOK && dumped;
+    }
+
+    // ---------- PERSISTENT REGION TESTS ----------
+
+    // Collects the addresses of the nodes reachable from node
+    static void collectNodes(Crop* node, unordered_set<Crop*>& out){
+        if (!node) return;
+        out.insert(node);
+        collectNodes(node->m_left, out);
+        collectNodes(node->m_right, out);
+    }
+
+    // Test 37: Persistent copies share nodes and a change copies only its path
+    bool testPersistentVersions(){
+        Region base = buildRegion(priorityFn2, MINHEAP, LEFTIST, 10, 500, 180);
+        base.setPersistent(true);
+        Region reference(base);
+        reference.setPersistent(false);
+        Region deep(reference);   // deep copy, shares nothing with base
+
+        Region version(base);
+        bool shared = version.m_heap == base.m_heap && version.isPersistent();
+        version.insertCrop(Crop(MINCROPID, 70, MINMOISTURE, MINTIME, 0));
+        version.getNextCrop();
+        version.getNextCrop();
+
+        // only the merge paths are new, the rest is shared with base
+        unordered_set<Crop*> baseNodes, versionNodes;
+        collectNodes(base.m_heap, baseNodes);
+        collectNodes(version.m_heap, versionNodes);
+        int copied = 0;
+        for (Crop* node : versionNodes) if (!baseNodes.count(node)) copied++;
+
+        // edits of one version never show in another
+        Region other(version);
+        for (int i = 0; i < 100; i++) other.getNextCrop();
+        return shared && copied > 0 && copied < 60 && version.numCrops() == 499
+            && samePopOrder(base, deep) && checkRemovalOrder(version)
+            && checkLeftistNPLValues(version) && checkLeftistProperty(version)
+            && other.numCrops() == 399 && version.numCrops() == 499 && checkHeapProperty(other);
+    }
+
+    // Test 38: Rebuilds, merges and destruction of shared versions leave the others intact
+    bool testPersistentRebuild(){
+        Region* base = new Region(buildRegion(priorityFn2, MINHEAP, SKEW, 10, 300, 181));
+        base->setPersistent(true);
+        Region deep(*base);
+        deep.setPersistent(false);
+        Region expected(deep);
+
+        Region flipped(*base);
+        flipped.setPriorityFn(priorityFn1, MAXHEAP);
+        Region leftist(*base);
+        leftist.setStructure(LEFTIST);
+
+        // merging a version with its own copy has every node on both sides
+        Region twice(*base);
+        Region again(*base);
+        twice.mergeWithQueue(again);
+
+        delete base;
+        return samePopOrder(deep, expected) && checkRemovalOrder(flipped)
+            && checkLeftistProperty(leftist) && checkRemovalOrder(leftist)
+            && twice.numCrops() == 600 && checkRemovalOrder(twice)
+            && again.numCrops() == 0 && flipped.numCrops() == 300;
+    }
+
+    // ---------- SCHEDULING TESTS ----------
+
+    // Test 39: GLOBAL serves the most urgent crop of any region, STRICT drains by regPrior
+    bool testGlobalSchedule(){
+        Irrigator strict(20);
+        Irrigator global(20, GLOBAL);
+        for (int i = 1; i <= 8; i++){
+            Region r = buildRegion(priorityFn2, MINHEAP, i % 2 ? SKEW : LEFTIST, i, 25, 190 + i);
+            strict.addRegion(r);
+            global.addRegion(r);
+        }
+        // a critically dry crop in the lowest priority region
+        Region dry(priorityFn2, MINHEAP, LEFTIST, 50);
+        dry.insertCrop(Crop(MINCROPID, 70, MINMOISTURE, MORNING, 0));
+        dry.insertCrop(Crop(MINCROPID + 1, 70, MAXMOISTURE, NIGHT, 0));
+        strict.addRegion(dry);
+        global.addRegion(dry);
+
+        Crop crop;
+        strict.getCrop(crop);
+        bool strictOK = crop.getCropID() != MINCROPID;
+
+        // every crop comes out in global priority order, then the irrigator is empty
+        int served = 0, last = 0;
+        bool ordered = true;
+        while (global.getCrop(crop)){
+            int p = priorityFn2(crop);
+            if (served == 0 && p != 1) ordered = false;
+            if (p < last) ordered = false;
+            last = p;
+            served++;
+        }
+        return strictOK && ordered && served == 8 * 25 + 2 && global.m_size == 0
+            && global.getSchedule() == GLOBAL;
+    }
+
+    // Test 40: FAIRSHARE serves regions in proportion to 1/regPrior, late regions do not starve others
+    bool testFairShare(){
+        Irrigator irr(10, FAIRSHARE);
+        const int priors[3] = {1, 2, 4};
+        for (int r = 0; r < 3; r++){
+            Region region(priorityFn2, MINHEAP, SKEW, priors[r]);
+            for (int i = 0; i < 500; i++) region.insertCrop(Crop(MINCROPID + r * 1000 + i, 70, 50, NOON, 0));
+            irr.addRegion(region);
+        }
+        int served[4] = {0, 0, 0, 0};
+        Crop crop;
+        for (int i = 0; i < 700; i++){
+            irr.getCrop(crop);
+            served[(crop.getCropID() - MINCROPID) / 1000]++;
+        }
+        bool shares = served[0] == 400 && served[1] == 200 && served[2] == 100;
+
+        // a region arriving now joins at the current virtual time
+        Region late(priorityFn2, MINHEAP, SKEW, 1);
+        for (int i = 0; i < 500; i++) late.insertCrop(Crop(MINCROPID + 3000 + i, 70, 50, NOON, 0));
+        irr.addRegion(late);
+        for (int i = 0; i < 110; i++){
+            irr.getCrop(crop);
+            served[(crop.getCropID() - MINCROPID) / 1000]++;
+        }
+        // the late region gets as many crops as region 1, 40 of the next 110
+        return shares && served[3] >= 38 && served[3] <= 42 && served[0] - 400 >= 38
+            && served[2] > 100;
+    }
+
+    // ---------- PARTITION TESTS ----------
+
+    // Checks every sub-heap of a partitioned region: heap order, leftist
+    // property, only crops of its own key, and the size bookkeeping
+    static bool checkPartitions(const Region& reg){
+        int total = 0;
+        for (int key = 0; key < reg.numHeaps(); key++){
+            Crop* root = reg.m_part[key];
+            if (!checkNode(reg, root, reg.m_priorFunc, reg.m_heapType)) return false;
+            if (reg.m_structure == LEFTIST && root && !(checkNPL(root) && checkLeftist(root))) return false;
+            unordered_set<Crop*> nodes;
+            collectNodes(root, nodes);
+            for (Crop* node : nodes){
+                if (reg.partitionOf(*node) != key) return false;
+            }
+            if ((int)nodes.size() != reg.numCrops(key)) return false;
+            total += (int)nodes.size();
+        }
+        return reg.m_heap == nullptr && total == reg.numCrops();
+    }
+
+    // Test 41: BYTIME keeps one sub-heap per window; windows drain on their own
+    bool testTimePartition(){
+        Region r = buildRegion(priorityFn2, MINHEAP, LEFTIST, 10, 400, 200);
+        Region plain(r);
+        r.setPartition(BYTIME);
+        bool split = r.getPartition() == BYTIME && checkPartitions(r) && r.numCrops() == 400;
+
+        // the whole region still comes out in priority order
+        Region whole(r);
+        vector<int> a, b;
+        while (whole.numCrops() > 0) a.push_back(priorityFn2(whole.getNextCrop()));
+        while (plain.numCrops() > 0) b.push_back(priorityFn2(plain.getNextCrop()));
+
+        // drain only the NOON window
+        int noon = r.numCrops(NOON), last = 0;
+        bool windowOK = noon > 0;
+        for (int i = 0; i < noon; i++){
+            Crop c = r.getNextCrop(NOON);
+            if (c.getTime() != NOON || priorityFn2(c) < last) windowOK = false;
+            last = priorityFn2(c);
+        }
+        bool threw = false;
+        try { r.getNextCrop(NOON); } catch (const out_of_range&) { threw = true; }
+        windowOK = windowOK && threw && r.numCrops(NOON) == 0 && r.numCrops() == 400 - noon;
+
+        // copy, merge, rebuilds and mode changes work on every sub-heap
+        Region copy(r);
+        Region other = buildRegion(priorityFn2, MINHEAP, LEFTIST, 10, 100, 201);
+        other.setPartition(BYTIME);
+        copy.mergeWithQueue(other);
+        bool merged = checkPartitions(copy) && copy.numCrops() == 500 - noon && other.numCrops() == 0;
+        copy.setStructure(SKEW);
+        copy.setPriorityFn(priorityFn1, MAXHEAP);
+        bool rebuilt = checkPartitions(copy) && copy.numCrops() == 500 - noon;
+        copy.setPartition(NOPARTITION);
+        bool undone = copy.m_heap != nullptr && checkHeapProperty(copy) && checkRemovalOrder(copy);
+
+        bool mismatch = false;
+        try { r.mergeWithQueue(plain); } catch (const domain_error&) { mismatch = true; }
+        return split && a == b && windowOK && merged && rebuilt && undone && mismatch;
+    }
+
+    // Test 42: BYTYPE pops the next N crops of one type; batches come out grouped by type
+    bool testTypeBatches(){
+        Region r = buildRegion(priorityFn1, MAXHEAP, SKEW, 10, 300, 210);
+        r.setPartition(BYTYPE);
+        bool split = checkPartitions(r);
+
+        // the next crops of one valve group, in priority order
+        Crop citrus[500];
+        int expected = r.numCrops(CITRUS) < 10 ? r.numCrops(CITRUS) : 10;
+        int got = r.getNextCrops(CITRUS, 10, citrus);
+        bool typeOK = got == expected && got > 0;
+        for (int i = 0; i < got; i++){
+            if (citrus[i].getType() != CITRUS) typeOK = false;
+            if (i > 0 && priorityFn1(citrus[i]) > priorityFn1(citrus[i-1])) typeOK = false;
+        }
+        int rest = r.getNextCrops(CITRUS, 500, citrus);
+        typeOK = typeOK && r.numCrops(CITRUS) == 0 && r.getNextCrops(CITRUS, 5, citrus) == 0
+            && r.numCrops() == 300 - got - rest;
+
+        // the batch holds the same crops a plain region would pop, grouped by type
+        Region plain(r);
+        plain.setPartition(NOPARTITION);
+        Crop batch[60];
+        int groupStart[MAXTYPE + 2];
+        int n = r.getCropBatch(60, batch, groupStart);
+        unordered_set<int> popped;
+        for (int i = 0; i < n; i++) popped.insert(priorityFn1(plain.getNextCrop()));
+        bool grouped = n == 60 && groupStart[0] == 0 && groupStart[MAXTYPE + 1] == 60;
+        for (int type = 0; type <= MAXTYPE; type++){
+            for (int i = groupStart[type]; i < groupStart[type + 1]; i++){
+                if (batch[i].getType() != type || !popped.count(priorityFn1(batch[i]))) grouped = false;
+                if (i > groupStart[type] && priorityFn1(batch[i]) > priorityFn1(batch[i-1])) grouped = false;
+            }
+        }
+        return split && typeOK && grouped && checkPartitions(r);
+    }
+
+    // ---------- CROP ORDER TESTS ----------
+
+    // Test 43: A lexicographic order drains exactly like a sort by the same fields
+    bool testCropOrder(){
+        CropOrder order;
+        bool built = order.add(FIELDMOISTURE, ASCENDING) && order.add(FIELDTEMPERATURE, DESCENDING)
+            && order.add(FIELDCROPID, ASCENDING) && !order.add(FIELDMOISTURE, DESCENDING)
+            && !order.add(NUMCROPFIELDS) && order.numFields() == 3;
+
+        // few distinct values, so most crops tie on the first fields
+        vector<Crop> crops;
+        Random idGen(MINCROPID, MAXCROPID);
+        idGen.setSeed(220);
+        unordered_set<int> ids;
+        while (crops.size() < 400){
+            int id = idGen.getRandNum();
+            if (!ids.insert(id).second) continue;
+            int i = (int)crops.size();
+            crops.push_back(Crop(id, MINTEMP + (i * 7) % 5, MINMOISTURE + (i * 3) % 4, i % 4, i % 7));
+        }
+        vector<Crop> sorted(crops);
+        sort(sorted.begin(), sorted.end(), [](const Crop& a, const Crop& b){
+            if (a.getMoisture() != b.getMoisture()) return a.getMoisture() < b.getMoisture();
+            if (a.getTemperature() != b.getTemperature()) return a.getTemperature() > b.getTemperature();
+            return a.getCropID() < b.getCropID();
+        });
+
+        bool stable = built;
+        const STRUCTURE structures[2] = {SKEW, LEFTIST};
+        for (int s = 0; s < 2; s++){
+            // half inserted before the order is set, half after, a quarter merged in
+            Region r(priorityFn2, MINHEAP, structures[s], 1);
+            Region other(priorityFn2, MINHEAP, structures[s], 2);
+            for (int i = 0; i < 200; i++) r.insertCrop(crops[i]);
+            r.setOrder(order);
+            other.setOrder(order);
+            r.insertCrops(&crops[200], 100);
+            for (int i = 300; i < 400; i++) other.insertCrop(crops[i]);
+            r.mergeWithQueue(other);
+            Region copy(r);
+            for (size_t i = 0; i < sorted.size(); i++){
+                if (copy.getNextCrop().getCropID() != sorted[i].getCropID()) stable = false;
+            }
+            if (structures[s] == LEFTIST && !(checkLeftistNPLValues(r) && checkLeftistProperty(r))) stable = false;
+
+            // an empty order goes back to the priority function
+            r.setOrder(CropOrder());
+            if (!checkHeapProperty(r) || !checkRemovalOrder(r) || r.numCrops() != 400) stable = false;
+        }
+
+        bool mismatch = false;
+        Region a(priorityFn2, MINHEAP, SKEW, 1), b(priorityFn2, MINHEAP, SKEW, 1);
+        a.setOrder(order);
+        try { a.mergeWithQueue(b); } catch (const domain_error&) { mismatch = true; }
+        return stable && mismatch;
+    }
+
+    // ---------- AGGREGATE TESTS ----------
+
+    // Recomputes the aggregates from the nodes and compares them with stats()
+    static bool statsMatch(const Region& reg){
+        CropStats st = reg.stats();
+        int count = 0, byType[MAXTYPE + 1] = {0}, byTime[MAXTIME + 1] = {0};
+        long long mSum = 0, mSq = 0, tSum = 0, tSq = 0;
+        int minM = 0, maxM = 0, minT = 0, maxT = 0;
+        for (int key = 0; key < reg.numHeaps(); key++){
+            unordered_set<Crop*> nodes;
+            collectNodes(reg.heapAt(key), nodes);
+            for (Crop* n : nodes){
+                count++;
+                byType[n->getType()]++;
+                byTime[n->getTime()]++;
+                mSum += n->getMoisture();
+                mSq += n->getMoisture() * n->getMoisture();
+                tSum += n->getTemperature();
+                tSq += n->getTemperature() * n->getTemperature();
+                if (minM == 0 || n->getMoisture() < minM) minM = n->getMoisture();
+                if (n->getMoisture() > maxM) maxM = n->getMoisture();
+                if (minT == 0 || n->getTemperature() < minT) minT = n->getTemperature();
+                if (n->getTemperature() > maxT) maxT = n->getTemperature();
+            }
+        }
+        for (int i = 0; i <= MAXTYPE; i++) if (st.byType[i] != byType[i]) return false;
+        for (int i = 0; i <= MAXTIME; i++) if (st.byTime[i] != byTime[i]) return false;
+        double mean = count ? (double)mSum / count : 0.0;
+        double sd = count ? sqrt((double)mSq / count - mean * mean) : 0.0;
+        return st.count == count && count == reg.numCrops() && st.moistureSum == mSum
+            && st.moistureSquares == mSq && st.temperatureSum == tSum && st.temperatureSquares == tSq
+            && st.minMoisture == minM && st.maxMoisture == maxM
+            && st.minTemperature == minT && st.maxTemperature == maxT
+            && fabs(st.meanMoisture() - mean) < 1e-9 && fabs(st.stddevMoisture() - sd) < 1e-6;
+    }
+
+    // Test 44: Aggregates follow inserts, pops, merges, copies and clears
+    bool testRegionStats(){
+        Region r = buildRegion(priorityFn2, MINHEAP, LEFTIST, 10, 300, 230);
+        bool ok = statsMatch(r);
+        for (int i = 0; i < 120; i++) r.getNextCrop();
+        ok = ok && statsMatch(r);
+
+        Region other = buildRegion(priorityFn2, MINHEAP, LEFTIST, 10, 150, 231);
+        r.mergeWithQueue(other);
+        ok = ok && statsMatch(r) && statsMatch(other) && other.stats().count == 0;
+
+        vector<Crop> batch;
+        for (int i = 0; i < 50; i++) batch.push_back(Crop(MINCROPID + i, MAXTEMP, MINMOISTURE + i, i % 4, i % 7));
+        r.insertCrops(batch.data(), 50);
+        r.setPartition(BYTIME);
+        for (int i = 0; i < 20 && r.numCrops(NIGHT) > 0; i++) r.getNextCrop(NIGHT);
+        r.setStructure(SKEW);
+        Region copy(r);
+        ok = ok && statsMatch(r) && statsMatch(copy) && r.stats().maxTemperature == MAXTEMP;
+
+        copy.clear();
+        Region empty;
+        CropStats none = copy.stats();
+        return ok && statsMatch(copy) && none.count == 0 && none.minMoisture == 0
+            && none.meanMoisture() == 0.0 && empty.stats().count == 0;
+    }
+
+    // ---------- SHARD TESTS ----------
+
+    // Test 45: Arena-backed regions, and shards that together serve the
+    // same crops in the same order as one irrigator
+    bool testShardedIrrigator(){
+        CropArena arena(64);
+        Region r = buildRegion(priorityFn2, MINHEAP, LEFTIST, 1, 300, 240);
+        r.setArena(&arena);
+        bool ok = arena.numLive() == 300 && checkHeapProperty(r) && checkLeftistNPLValues(r);
+        {
+            Region copy(r);
+            ok = ok && copy.getArena() == &arena && arena.numLive() == 600 && checkRemovalOrder(copy);
+        }
+        for (int i = 0; i < 100; i++) r.getNextCrop();
+        r.setArena(nullptr);
+        ok = ok && arena.numLive() == 0 && r.numCrops() == 200 && checkHeapProperty(r);
+        arena.reserve(1000);
+        ok = ok && arena.capacity() - arena.numLive() >= 1000;
+
+        ShardedIrrigator sharded(4, 20, GLOBAL);
+        Irrigator single(100, GLOBAL);
+        for (int i = 0; i < 40; i++){
+            Region reg = buildRegion(priorityFn2, MINHEAP, (i % 2) ? SKEW : LEFTIST, 1 + i % 5, 25, 241 + i);
+            reg.setPersistent(i % 3 == 0);
+            single.addRegion(reg);
+            ok = ok && sharded.addRegion(reg);
+        }
+        sharded.flush();
+        ok = ok && sharded.numShards() == 4 && sharded.numRegions() == 40;
+        // the workers move the staged regions into their heaps, none is copied again
+        for (int i = 0; i < sharded.numShards(); i++)
+            ok = ok && sharded.m_shards[i]->m_irrigator.counters().regionCopies == 0;
+
+        Crop a, b;
+        int served = 0;
+        while (single.getCrop(a)){
+            if (!sharded.getCrop(b) || priorityFn2(a) != priorityFn2(b)) ok = false;
+            served++;
+        }
+        ok = ok && served == 1000 && !sharded.getCrop(b) && sharded.numRegions() == 0;
+
+        // a persistent region in the middle of a rebuild hands over no shared node
+        Region shared = buildRegion(priorityFn1, MINHEAP, SKEW, 1, 200, 295);
+        shared.setPersistent(true);
+        shared.setRebuildBudget(1);
+        shared.setPriorityFn(priorityFn2, MINHEAP);
+        ShardedIrrigator pendingShards(1, 2, STRICT, false);
+        ok = ok && shared.numPending() > 0 && pendingShards.addRegion(shared);
+        pendingShards.flush();
+        int drained = 0;
+        while (pendingShards.getCrop(b)) drained++;
+        ok = ok && drained == 200 && shared.numPending() > 0 && checkRemovalOrder(shared);
+
+        // FAIRSHARE over unequal shards: shard 0 served 100 crops while shard 1
+        // sat idle, regions arriving in either one then share the crops evenly
+        ShardedIrrigator fair(2, 4, FAIRSHARE, false);
+        Region busy(priorityFn2, MINHEAP, SKEW, 1), idle(priorityFn2, MINHEAP, SKEW, 1);
+        for (int i = 0; i < 200; i++) busy.insertCrop(Crop(110000 + i, 70, 50, NOON, 0));
+        idle.insertCrop(Crop(200000, 70, 50, NOON, 0));
+        ok = ok && fair.addRegion(busy) && fair.addRegion(idle);
+        fair.flush();
+        for (int i = 0; i < 101; i++) ok = ok && fair.getCrop(b);
+        Region early(priorityFn2, MINHEAP, SKEW, 1), late(priorityFn2, MINHEAP, SKEW, 1);
+        for (int i = 0; i < 50; i++){
+            early.insertCrop(Crop(300000 + i, 70, 50, NOON, 0));
+            late.insertCrop(Crop(400000 + i, 70, 50, NOON, 0));
+        }
+        ok = ok && fair.addRegion(early) && fair.addRegion(late);
+        fair.flush();
+        int share[5] = {0};
+        for (int i = 0; i < 30; i++){
+            ok = ok && fair.getCrop(b);
+            share[b.getCropID() / 100000]++;
+        }
+        ok = ok && share[1] >= 9 && share[1] <= 11 && share[3] >= 9 && share[3] <= 11
+            && share[4] >= 9 && share[4] <= 11;
+
+        // a full shard refuses, the next one in turn still takes a region
+        ShardedIrrigator small(2, 1, STRICT, false);
+        Region one = buildRegion(priorityFn2, MINHEAP, SKEW, 1, 5, 290);
+        bool added = small.addRegion(one) && small.addRegion(one);
+        bool refused = !small.addRegion(one);
+        small.flush();
+        return ok && added && refused && small.numRegions() == 2 && !small.isPinned();
+    }
+
+    // ---------- PIPELINE TESTS ----------
+
+    // Test 46: Bounded queues push back, every valid reading reaches a valve
+    // exactly once, and crops waiting behind a busy valve leave in priority order
+    bool testPipeline(){
+        BoundedQueue<int> q(2);
+        int item = 0;
+        bool ok = q.tryPush(1) && q.tryPush(2) && !q.tryPush(3) && q.size() == 2;
+        q.close();
+        ok = ok && !q.push(4) && q.pop(item) && item == 1 && q.pop(item) && item == 2
+            && !q.pop(item) && q.drained();
+
+        // two sensors submit at once into small queues
+        s_valveLog.clear();
+        s_valveGate = true;
+        IrrigationPipeline pipe(evenIdPriority, MINHEAP, LEFTIST, recordingValve, 2, 16, 64);
+        vector<Crop> readings;
+        for (int i = 0; i < 2000; i++) readings.push_back(Crop(MINCROPID + i, 70, 1 + i % 100, i % 4, i % 7));
+        thread sensor([&]{ for (int i = 0; i < 1000; i++) pipe.submit(readings[i]); });
+        for (int i = 1000; i < 2000; i++) pipe.submit(readings[i]);
+        sensor.join();
+        pipe.finish();
+        PipelineStats st = pipe.stats();
+        vector<int> ids;
+        for (const Crop& c : s_valveLog) ids.push_back(c.getCropID());
+        sort(ids.begin(), ids.end());
+        bool exact = ids.size() == 1000;
+        for (size_t i = 0; exact && i < ids.size(); i++) exact = ids[i] == MINCROPID + 1 + 2 * (int)i;
+        ok = ok && exact && st.submitted == 2000 && st.rejected == 1000 && st.dispatched == 1000
+            && st.p99 > 0 && !pipe.submit(readings[0]);
+
+        // the valve is stuck while the readings arrive, the heap sorts them meanwhile
+        s_valveLog.clear();
+        s_valveGate = false;
+        IrrigationPipeline slow(priorityFn2, MINHEAP, SKEW, recordingValve, 1, 8, 512);
+        for (int i = 0; i < 300; i++) slow.submit(readings[(i * 7) % 2000]);
+        while (slow.m_ingest.size() > 0 || slow.m_batches.size() > 0) this_thread::sleep_for(chrono::milliseconds(1));
+        this_thread::sleep_for(chrono::milliseconds(20));
+        s_valveGate = true;
+        slow.finish();
+        // the valve, the dispatch queue and the heap stage took one crop each before all arrived
+        bool sorted = s_valveLog.size() == 300;
+        for (size_t i = 4; sorted && i < s_valveLog.size(); i++) {
+            sorted = priorityFn2(s_valveLog[i - 1]) <= priorityFn2(s_valveLog[i]);
+        }
+
+        bool thrown = false;
+        try { IrrigationPipeline bad(nullptr, MINHEAP, SKEW, recordingValve); } catch (const invalid_argument&) { thrown = true; }
+        return ok && sorted && thrown;
+    }
+
+    // ---------- LAYOUT TESTS ----------
+
+    // True if the heaps of the region lie back to back in one run, in preorder
+    static bool preorderContiguous(const Region& reg){
+        const char* expected = nullptr;
+        for (int key = 0; key < reg.numHeaps(); key++){
+            vector<Crop*> stack;
+            if (reg.heapAt(key) != nullptr) stack.push_back(reg.heapAt(key));
+            while (!stack.empty()){
+                Crop* node = stack.back();
+                stack.pop_back();
+                const char* at = reinterpret_cast<const char*>(node);
+                if (expected != nullptr && at != expected) return false;
+                expected = at + sizeof(Crop);
+                if (node->m_right != nullptr) stack.push_back(node->m_right);
+                if (node->m_left != nullptr) stack.push_back(node->m_left);
+            }
+        }
+        return true;
+    }
+
+    // Test 47: Compaction lays the nodes out in preorder and keeps every crop
+    bool testCompaction(){
+        // interleaved inserts leave the nodes of each region scattered
+        Region r(priorityFn2, MINHEAP, SKEW, 1), other(priorityFn2, MINHEAP, SKEW, 1);
+        Region scattered = buildRegion(priorityFn2, MINHEAP, SKEW, 1, 400, 250);
+        Crop c;
+        while (scattered.numCrops() > 0){
+            c = scattered.getNextCrop();
+            r.insertCrop(c);
+            other.insertCrop(c);
+        }
+        Region before(r);
+        r.compact();
+        bool ok = preorderContiguous(r) && checkHeapProperty(r) && r.numCrops() == 400;
+        while (ok && before.numCrops() > 0){
+            ok = priorityFn2(before.getNextCrop()) == priorityFn2(r.getNextCrop());
+        }
+
+        // rebuilds and bulk inserts compact by themselves, partitions follow each other
+        other.setAutoCompact(true);
+        other.setStructure(LEFTIST);
+        ok = ok && preorderContiguous(other) && checkLeftistNPLValues(other) && checkLeftistProperty(other);
+        other.setPartition(BYTIME);
+        ok = ok && preorderContiguous(other) && other.numCrops() == 400;
+        vector<Crop> batch;
+        for (int i = 0; i < 50; i++) batch.push_back(Crop(MINCROPID + i, 70, 1 + i, i % 4, i % 7));
+        other.insertCrops(batch.data(), 50);
+        ok = ok && preorderContiguous(other) && statsMatch(other) && other.isAutoCompact();
+
+        // the block outlives its region once the nodes are merged elsewhere
+        Region target(priorityFn2, MINHEAP, LEFTIST, 1);
+        {
+            Region source = buildRegion(priorityFn2, MINHEAP, LEFTIST, 1, 100, 251);
+            source.compact();
+            target.mergeWithQueue(source);
+        }
+        ok = ok && target.numCrops() == 100 && checkRemovalOrder(target);
+
+        // shared nodes stay put, the copy still sees them
+        Region base = buildRegion(priorityFn2, MINHEAP, LEFTIST, 1, 200, 252);
+        base.setPersistent(true);
+        Region version(base);
+        version.insertCrop(Crop(MINCROPID, 70, 1, MORNING, BEAN));
+        version.compact();
+        ok = ok && checkRemovalOrder(base) && checkRemovalOrder(version) && version.numCrops() == 201;
+
+        // with an arena the run comes from it
+        CropArena arena(64);
+        Region pooled = buildRegion(priorityFn2, MINHEAP, SKEW, 1, 300, 253);
+        pooled.setArena(&arena);
+        for (int i = 0; i < 50; i++) pooled.getNextCrop();
+        pooled.compact();
+        ok = ok && preorderContiguous(pooled) && arena.numLive() == 250 && checkRemovalOrder(pooled);
+        pooled.clear();
+        return ok && arena.numLive() == 0;
+    }
+
+    // ---------- INCREMENTAL REBUILD TESTS ----------
+
+    // Test 48: A budgeted priority change moves a bounded number of crops per
+    // call, pops stay correct, copies and the journal carry the pending rebuild
+    bool testIncrementalRebuild(){
+        Region r = buildRegion(priorityFn2, MINHEAP, LEFTIST, 1, 1000, 260);
+        r.setRebuildBudget(50);
+        r.setPriorityFn(priorityFn1, MAXHEAP);
+        bool ok = r.numPending() == 1000 && r.numCrops() == 1000 && r.getRebuildBudget() == 50;
+        for (int i = 0; i < 5; i++) r.insertCrop(Crop(MINCROPID + i, 40 + i, 50, NOON, BEAN));
+        ok = ok && r.numPending() == 750 && r.numCrops() == 1005 && r.rebuildStep() == 700;
+
+        Region copy(r);
+        ok = ok && copy.numPending() == 700;
+        Crop best = r.getNextCrop();
+        ok = ok && r.numPending() == 0 && checkHeapProperty(r) && checkLeftistNPLValues(r)
+            && checkLeftistProperty(r) && statsMatch(r) && checkRemovalOrder(r);
+        Region reference = buildRegion(priorityFn2, MINHEAP, LEFTIST, 1, 1000, 260);
+        reference.setPriorityFn(priorityFn1, MAXHEAP);
+        ok = ok && priorityFn1(best) == priorityFn1(reference.getNextCrop()) && checkRemovalOrder(copy);
+
+        // shared nodes of a persistent version are copied when the rebuild reaches them
+        Region base = buildRegion(priorityFn2, MINHEAP, SKEW, 1, 300, 261);
+        base.setPersistent(true);
+        base.setRebuildBudget(40);
+        Region version(base);
+        version.setPriorityFn(priorityFn1, MAXHEAP);
+        version.rebuildStep();
+        ok = ok && base.numPending() == 0 && checkRemovalOrder(base) && checkRemovalOrder(version);
+
+        // sub-heap sizes stay right while their crops are pending
+        Region parts = buildRegion(priorityFn2, MINHEAP, SKEW, 1, 400, 262);
+        parts.setPartition(BYTYPE);
+        int citrus = parts.numCrops(CITRUS);
+        parts.setRebuildBudget(25);
+        parts.setPriorityFn(priorityFn1, MAXHEAP);
+        ok = ok && parts.numCrops(CITRUS) == citrus && parts.numPending() == 400;
+        parts.rebuildStep();
+        Crop first = parts.getNextCrop(CITRUS);
+        ok = ok && first.getType() == CITRUS && parts.numCrops(CITRUS) == citrus - 1;
+        parts.setRebuildBudget(0);
+
+        // a checkpoint in the middle of a rebuild, then more steps in the log
+        const char* logPath = "journal_rebuild.log";
+        const char* snapPath = "journal_rebuild.snap";
+        remove(logPath);
+        remove(snapPath);
+        Region live = buildRegion(priorityFn2, MINHEAP, SKEW, 2, 500, 263);
+        Region* liveRegions[1] = {&live};
+        {
+            Journal journal;
+            journal.registerPriorityFn(priorityFn2);
+            journal.registerPriorityFn(priorityFn1);
+            if (!journal.open(logPath)) return false;
+            live.setJournal(&journal, 0);
+            live.setRebuildBudget(30);
+            live.setPriorityFn(priorityFn1, MAXHEAP);
+            live.insertCrop(Crop(MINCROPID, 100, 50, NIGHT, CITRUS));
+            if (!journal.checkpoint(snapPath, nullptr, liveRegions, 1)) return false;
+            live.rebuildStep();
+            live.insertCrop(Crop(MINCROPID + 1, 90, 50, NIGHT, COTTON));
+            live.setJournal(nullptr, 0);
+        }
+        Region restored;
+        Region* regions[1] = {&restored};
+        Journal recovery;
+        recovery.registerPriorityFn(priorityFn2);
+        recovery.registerPriorityFn(priorityFn1);
+        long long replayed = recovery.recover(snapPath, logPath, nullptr, regions, 1);
+        remove(logPath);
+        remove(snapPath);
+        return ok && replayed == 2 && restored.numPending() == live.numPending()
+            && live.numPending() == 500 - 3 * 30 && samePopOrder(live, restored);
+    }
+
+    // ---------- CONVERSION TESTS ----------
+
+    // Test 49: Structure changes and MIN/MAX flips keep every node in place
+    // (no crop is re-inserted) and leave valid heaps; shared versions are untouched
+    bool testFastConversion(){
+        Region r = buildRegion(priorityFn2, MINHEAP, SKEW, 1, 2000, 270);
+        unordered_set<Crop*> before, after;
+        collectNodes(r.m_heap, before);
+
+        r.setStructure(LEFTIST);
+        collectNodes(r.m_heap, after);
+        bool ok = before == after && r.getStructure() == LEFTIST && checkHeapProperty(r)
+            && checkLeftistNPLValues(r) && checkLeftistProperty(r) && checkRemovalOrder(r);
+
+        Crop* root = r.m_heap;
+        r.setStructure(SKEW);
+        ok = ok && r.m_heap == root && r.getStructure() == SKEW && checkRemovalOrder(r);
+
+        // the flip negates the keys and builds new heaps from the same nodes
+        r.setPriorityFn(priorityFn2, MAXHEAP);
+        after.clear();
+        collectNodes(r.m_heap, after);
+        ok = ok && before == after && r.getHeapType() == MAXHEAP && r.numCrops() == 2000
+            && checkHeapProperty(r) && checkRemovalOrder(r) && statsMatch(r);
+        r.setStructure(LEFTIST);
+        r.setPriorityFn(priorityFn2, MINHEAP);
+        ok = ok && checkHeapProperty(r) && checkLeftistNPLValues(r) && checkLeftistProperty(r)
+            && checkRemovalOrder(r);
+
+        // a persistent version converts its own copies of the shared nodes
+        Region base = buildRegion(priorityFn2, MINHEAP, SKEW, 1, 500, 271);
+        base.setPersistent(true);
+        Region deep = buildRegion(priorityFn2, MINHEAP, SKEW, 1, 500, 271);
+        Region version(base);
+        version.setStructure(LEFTIST);
+        ok = ok && samePopOrder(base, deep) && checkLeftistNPLValues(version)
+            && checkLeftistProperty(version) && checkRemovalOrder(version);
+
+        // with a CropOrder the priority function does not decide the order
+        Region ordered = buildRegion(priorityFn2, MINHEAP, LEFTIST, 1, 300, 272);
+        CropOrder order;
+        order.add(FIELDMOISTURE, ASCENDING);
+        order.add(FIELDCROPID, ASCENDING);
+        ordered.setOrder(order);
+        root = ordered.m_heap;
+        ordered.setPriorityFn(priorityFn1, MAXHEAP);
+        ok = ok && ordered.m_heap == root && ordered.getPriorityFn() == priorityFn1;
+
+        // partitioned sub-heaps convert one by one
+        Region parts = buildRegion(priorityFn2, MINHEAP, SKEW, 1, 400, 273);
+        parts.setPartition(BYTIME);
+        parts.setStructure(LEFTIST);
+        for (int key = 0; key < parts.numHeaps(); key++){
+            ok = ok && checkNPL(parts.heapAt(key)) && checkLeftist(parts.heapAt(key));
+        }
+        return ok && checkRemovalOrder(parts);
+    }
+
+    // ---------- ALLOCATION TESTS ----------
+
+    // Test 50: emplaceCrop builds nodes like Crop's constructor, popNextCrop
+    // reports an empty region instead of throwing, and once the arena's free
+    // list is warm a steady stream of inserts and pops allocates nothing
+    bool testAllocationFree(){
+        Region r(priorityFn2, MINHEAP, LEFTIST, 1);
+        Crop out;
+        bool ok = !r.popNextCrop(out) && r.emplaceCrop(MINCROPID, 200, 0, 9, -1)
+            && r.popNextCrop(out) && out.getCropID() == MINCROPID && out.getTemperature() == MINTEMP
+            && out.getMoisture() == MAXMOISTURE && out.getTime() == MAXTIME && out.getType() == MINTYPE;
+
+        // a refused crop gives its node back to the arena
+        CropArena arena;
+        Region picky(evenIdPriority, MINHEAP, SKEW, 1);
+        picky.setArena(&arena);
+        ok = ok && !picky.emplaceCrop(MINCROPID, 50, 50, MORNING, BEAN) && arena.numLive() == 0
+            && picky.emplaceCrop(MINCROPID + 1, 50, 50, MORNING, BEAN) && arena.numLive() == 1;
+        picky.clear();
+
+        Region pooled(priorityFn2, MINHEAP, LEFTIST, 1);
+        pooled.setArena(&arena);
+        Random idGen(MINCROPID, MAXCROPID), tempGen(MINTEMP, MAXTEMP), moistGen(MINMOISTURE, MAXMOISTURE);
+        Random timeGen(MINTIME, MAXTIME), typeGen(MINTYPE, MAXTYPE);
+        idGen.setSeed(280); tempGen.setSeed(281); moistGen.setSeed(282); timeGen.setSeed(283); typeGen.setSeed(284);
+        const int steady = 5000;
+        vector<int> ids(steady), temps(steady), moists(steady), times(steady), types(steady);
+        for (int i = 0; i < steady; i++){
+            ids[i] = idGen.getRandNum(); temps[i] = tempGen.getRandNum(); moists[i] = moistGen.getRandNum();
+            times[i] = timeGen.getRandNum(); types[i] = typeGen.getRandNum();
+        }
+
+        // warm up: fill, then pop half so the free list has nodes to give back
+        for (int i = 0; i < 1000; i++){
+            pooled.emplaceCrop(ids[i], temps[i], moists[i], times[i], types[i]);
+        }
+        for (int i = 0; i < 500; i++){
+            pooled.popNextCrop(out);
+        }
+        long long live = arena.numLive();
+        long long chunks = arena.numChunks();
+
+        // the arena's own counters: no chunk is added, every node comes from its free list
+        for (int i = 0; i < steady; i++){
+            pooled.emplaceCrop(ids[i], temps[i], moists[i], times[i], types[i]);
+            pooled.insertCrop(Crop(ids[i], temps[i], moists[i], times[i], types[i]));
+            pooled.popNextCrop(out);
+            pooled.popNextCrop(out);
+        }
+        ok = ok && arena.numChunks() == chunks && arena.numLive() == live
+            && countArenaNodes(pooled.m_heap, &arena) == pooled.m_size && checkHeapProperty(pooled)
+            && checkLeftistProperty(pooled) && checkRemovalOrder(pooled);
+
+        // without the arena every insert allocates its node
+        Region plain(priorityFn2, MINHEAP, LEFTIST, 1);
+        for (int i = 0; i < steady; i++){
+            plain.emplaceCrop(ids[i], temps[i], moists[i], times[i], types[i]);
+        }
+        ok = ok && countArenaNodes(plain.m_heap, nullptr) == steady && arena.numLive() == live;
+        plain.clear();
+
+        // the Irrigator pops through popNextCrop too, same crops as getNextCrop
+        Irrigator irr(4);
+        Region a = buildRegion(priorityFn2, MINHEAP, SKEW, 2, 50, 285);
+        Region b = buildRegion(priorityFn2, MINHEAP, SKEW, 1, 50, 286);
+        irr.addRegion(a);
+        irr.addRegion(b);
+        Crop crop;
+        for (int i = 0; i < 50 && ok; i++){
+            ok = irr.getCrop(crop) && crop.getCropID() == b.getNextCrop().getCropID();
+        }
+        pooled.clear();
+        return ok && irr.getCrop(crop) && crop.getCropID() == a.getNextCrop().getCropID();
+    }
+
+    // ---------- EXPORT TESTS ----------
+
+    // Test 51: Exported records read back into the same crops, the sorted
+    // order is the pop order, JSON lines carry the names, every sink works
+    bool testExport(){
+        // JSON text of one crop
+        Region one(priorityFn2, MINHEAP, LEFTIST, 1);
+        one.insertCrop(Crop(MINCROPID, 70, 20, NOON, BEAN));
+        ostringstream json;
+        CropExporter jsonOut(JSONRECORD);
+        bool ok = jsonOut.writeRegion(one, 1) == -1;
+        jsonOut.attach(json);
+        ok = ok && jsonOut.writeRegion(one, 1) == 1 && jsonOut.flush()
+            && json.str() == "{\"id\":100001,\"temperature\":70,\"moisture\":20,\"time\":\"NOON\",\"type\":\"BEAN\",\"region\":1}\n";
+
+        // CSV in preorder through a small buffer, loaded back
+        Region source = buildRegion(priorityFn2, MINHEAP, SKEW, 3, 2000, 290);
+        FILE* csv = tmpfile();
+        if (!csv) return false;
+        CropExporter csvOut(CSVRECORD, PREORDER, 100);
+        csvOut.attach(csv);
+        ok = ok && csvOut.writeRegion(source, 3) == 2000 && csvOut.flush()
+            && csvOut.numBytes() == (long long)ftell(csv);
+        rewind(csv);
+        Region loaded(priorityFn2, MINHEAP, SKEW, 3);
+        CropLoader loader;
+        loader.addRoute(3, loaded);
+        ok = ok && loader.loadStream(csv, CSVRECORD) == 2000 && loader.numRejected() == 0
+            && sameIDsAfterRebuild(source, loaded);
+        fclose(csv);
+
+        // binary in sorted order to a descriptor, in the middle of a rebuild
+        source.setRebuildBudget(100);
+        source.setPriorityFn(priorityFn1, MAXHEAP);
+        source.rebuildStep();
+        char path[] = "/tmp/exportXXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0) return false;
+        CropExporter binOut(BINARYRECORD, SORTEDORDER);
+        binOut.attach(fd);
+        ok = ok && binOut.writeRegion(source, 3) == 2000 && binOut.flush()
+            && source.numPending() == 2000 - 100;
+        close(fd);
+        FILE* bin = fopen(path, "rb");
+        Region copy(source);
+        int32_t rec[6];
+        int records = 0;
+        while (bin && fread(rec, sizeof(rec), 1, bin) == 1 && ok){
+            Crop next = copy.getNextCrop();
+            ok = rec[5] == 3 && priorityFn1(Crop(rec[0], rec[1], rec[2], rec[3], rec[4])) == priorityFn1(next);
+            records++;
+        }
+        if (bin) fclose(bin);
+        remove(path);
+        ok = ok && records == 2000;
+
+        // a whole irrigator, every region under its regPrior
+        Irrigator irr(5);
+        Region a = buildRegion(priorityFn2, MINHEAP, LEFTIST, 7, 300, 291);
+        Region b = buildRegion(priorityFn2, MINHEAP, LEFTIST, 9, 200, 292);
+        irr.addRegion(a);
+        irr.addRegion(b);
+        ostringstream all;
+        CropExporter allOut(CSVRECORD, SORTEDORDER);
+        allOut.attach(all);
+        ok = ok && allOut.writeIrrigator(irr) == 500 && allOut.flush();
+        string text = all.str();
+        int lines = (int)count(text.begin(), text.end(), '\n');
+        int region7 = 0;
+        for (size_t pos = text.find(",7\n"); pos != string::npos; pos = text.find(",7\n", pos + 1)) region7++;
+        return ok && lines == 501 && region7 == 300 && text.compare(0, 3, "id,") == 0
+            && allOut.numWritten() == 500;
+    }
+    // ---------- DOUBLE-ENDED TESTS ----------
+
+    // min-max order below node: a min level holds the smallest key of its
+    // subtree, a max level the largest; low and high get the subtree's range
+    static bool checkMinMax(const Crop* node, bool minLevel, long long& low, long long& high){
+        low = high = node->m_key;
+        const Crop* children[2] = {node->m_left, node->m_right};
+        if (node->m_left == nullptr && node->m_right != nullptr) return false;
+        for (int c = 0; c < 2; c++){
+            if (children[c] == nullptr) continue;
+            long long childLow, childHigh;
+            if (!checkMinMax(children[c], !minLevel, childLow, childHigh)) return false;
+            low = min(low, childLow);
+            high = max(high, childHigh);
+        }
+        return minLevel ? low == node->m_key : high == node->m_key;
+    }
+
+    static bool checkMinMax(const Region& reg){
+        int counted = 0;
+        for (int i = 0; i < reg.numHeaps(); i++){
+            long long low, high;
+            if (reg.heapAt(i) != nullptr && !checkMinMax(reg.heapAt(i), true, low, high)) return false;
+            counted += countNodes(reg.heapAt(i));
+        }
+        return counted == reg.m_size;
+    }
+
+    // pops both ends in turn and checks them against the pop order of a copy
+    static bool checkBothEnds(Region reg, prifn_t pf){
+        vector<int> order;
+        Region drain(reg);
+        Crop crop;
+        while (drain.popNextCrop(crop)) order.push_back(pf(crop));
+        int low = 0, high = (int)order.size() - 1;
+        for (int i = 0; low <= high; i++){
+            if (i % 3 == 1){
+                if (pf(reg.peekLastCrop()) != order[high] || pf(reg.getLastCrop()) != order[high]) return false;
+                high--;
+            }
+            else {
+                if (pf(reg.peekNextCrop()) != order[low] || pf(reg.getNextCrop()) != order[low]) return false;
+                low++;
+            }
+            if (i % 50 == 0 && !checkMinMax(reg)) return false;
+        }
+        return reg.numCrops() == 0;
+    }
+
+    // Test 52: A MINMAX region gives both ends in order, through inserts,
+    // copies, persistent versions, merges, partitions, conversions and replay
+    bool testDoubleEnded(){
+        Region r = buildRegion(priorityFn2, MINHEAP, MINMAX, 1, 1000, 300);
+        bool ok = checkMinMax(r) && checkBothEnds(r, priorityFn2);
+
+        // inserts between pops, a MAXHEAP's last crop is its lowest priority
+        Region mixed(priorityFn1, MAXHEAP, MINMAX, 1);
+        Random gen(MINTEMP, MAXTEMP);
+        gen.setSeed(301);
+        for (int i = 0; i < 600 && ok; i++){
+            mixed.insertCrop(Crop(MINCROPID + i, gen.getRandNum(), 40, i % 4, i % 7));
+            if (i % 5 == 4){
+                int last = priorityFn1(mixed.getLastCrop());
+                ok = checkMinMax(mixed) && last <= priorityFn1(mixed.peekLastCrop());
+            }
+        }
+        ok = ok && checkBothEnds(mixed, priorityFn1);
+
+        // a persistent copy shares nodes, popping either end leaves the other alone
+        Region base = buildRegion(priorityFn2, MINHEAP, MINMAX, 1, 400, 302);
+        base.setPersistent(true);
+        Region version(base);
+        for (int i = 0; i < 100; i++){
+            version.getLastCrop();
+            version.getNextCrop();
+        }
+        ok = ok && base.numCrops() == 400 && version.numCrops() == 200 && checkMinMax(base)
+            && checkMinMax(version) && checkBothEnds(base, priorityFn2);
+
+        // merging a few crops inserts them, many rebuild
+        Region big = buildRegion(priorityFn2, MINHEAP, MINMAX, 1, 2000, 303);
+        Region few = buildRegion(priorityFn2, MINHEAP, MINMAX, 1, 10, 304);
+        Region many = buildRegion(priorityFn2, MINHEAP, MINMAX, 1, 1500, 305);
+        big.mergeWithQueue(few);
+        big.mergeWithQueue(many);
+        ok = ok && big.numCrops() == 3510 && few.numCrops() == 0 && checkMinMax(big)
+            && checkBothEnds(big, priorityFn2);
+
+        // time-window sub-heaps, the last crop comes from whichever holds it
+        Region parts = buildRegion(priorityFn2, MINHEAP, MINMAX, 1, 800, 306);
+        parts.setPartition(BYTIME);
+        ok = ok && checkMinMax(parts) && checkBothEnds(parts, priorityFn2);
+
+        // round trips through the tree structures, a skew heap has no last crop
+        Region round = buildRegion(priorityFn2, MINHEAP, SKEW, 1, 700, 307);
+        round.setStructure(MINMAX);
+        ok = ok && checkMinMax(round) && checkBothEnds(round, priorityFn2);
+        round.setStructure(LEFTIST);
+        ok = ok && checkHeapProperty(round) && checkLeftistProperty(round) && checkRemovalOrder(round);
+        round.setStructure(MINMAX);
+        round.setPriorityFn(priorityFn1, MAXHEAP);
+        ok = ok && checkMinMax(round) && checkBothEnds(round, priorityFn1);
+        round.setStructure(SKEW);
+        try {
+            round.getLastCrop();
+            ok = false;
+        } catch (domain_error&) {}
+        // a rebuild still pending is finished as a skew heap, then turned into a min-max heap
+        Region pending = buildRegion(priorityFn1, MINHEAP, SKEW, 1, 1000, 308);
+        pending.setRebuildBudget(1);
+        pending.setPriorityFn(priorityFn2, MINHEAP);
+        while (pending.numPending() > 5) pending.rebuildStep();
+        pending.setStructure(MINMAX);
+        ok = ok && pending.numPending() == 0 && pending.numCrops() == 1000 && checkMinMax(pending)
+            && checkBothEnds(pending, priorityFn2);
+        Region empty(priorityFn2, MINHEAP, MINMAX, 1);
+        try {
+            empty.getLastCrop();
+            ok = false;
+        } catch (out_of_range&) {}
+
+        // getLastCrop is journaled
+        const char* logPath = "journal_double.log";
+        remove(logPath);
+        Region live(priorityFn2, MINHEAP, MINMAX, 1);
+        {
+            Journal journal;
+            journal.registerPriorityFn(priorityFn2);
+            if (!journal.open(logPath)) return false;
+            live.setJournal(&journal, 0);
+            for (int i = 0; i < 60; i++){
+                live.insertCrop(Crop(MINCROPID + i, 30 + i, 20 + (i * 7) % 50, i % 4, i % 7));
+                if (i % 4 == 3) live.getLastCrop();
+                if (i % 6 == 5) live.getNextCrop();
+            }
+            live.setJournal(nullptr, 0);
+        }
+        Region restored;
+        Region* regions[1] = {&restored};
+        Journal recovery;
+        recovery.registerPriorityFn(priorityFn2);
+        long long replayed = recovery.recover(nullptr, logPath, nullptr, regions, 1);
+        remove(logPath);
+        return ok && replayed > 60 && restored.getStructure() == MINMAX && samePopOrder(live, restored);
+    }
+
+    // Test 53: Deadlines expire in waves through the timer wheel: the wheel on
+    // its own, two million crops, TTLs, copies, merges, both ends, partitions,
+    // an irrigator-wide expire and recovery from a checkpoint and a log
+    bool testExpiry(){
+        // the wheel against a plain count, the steps cross every level
+        TimerWheel wheel;
+        vector<int> deadlines;
+        mt19937 gen(530);
+        for (int i = 0; i < 20000; i++){
+            unsigned int range = (1u << (8 * (1 + i % 4) - 1)) - 1;
+            int deadline = 1 + (int)(gen() % range);
+            wheel.add(deadline);
+            if (i % 7 == 0) wheel.cancel(deadline);
+            else deadlines.push_back(deadline);
+        }
+        bool ok = !wheel.add(0);
+        int steps[] = {100, 255, 256, 300, 70000, 70001, 1 << 24, (1 << 24) + 5, 1 << 30, INT_MAX};
+        int now = 0;
+        for (int step : steps){
+            long long expected = 0;
+            for (int deadline : deadlines) expected += (deadline > now && deadline <= step);
+            ok = ok && wheel.advance(step) == expected;
+            now = step;
+        }
+        ok = ok && wheel.size() == 0 && wheel.now() == INT_MAX;
+
+        // two million crops in eight waves, the ninth part never expires
+        const int total = 2000000, chunk = 100000, waves = 8;
+        Region big(priorityFn2, MINHEAP, LEFTIST, 1);
+        vector<Crop> crops(chunk);
+        long long perWave[waves + 1] = {0};
+        for (int start = 0; start < total; start += chunk){
+            for (int i = 0; i < chunk; i++){
+                int n = start + i;
+                crops[i] = Crop(MINCROPID + n % 800000, MINTEMP + n % 81, MINMOISTURE + n % 97, n % 4, n % 7);
+                int wave = (n * 7 + n / 9) % (waves + 1);
+                crops[i].setDeadline(wave * 1000);
+                perWave[wave]++;
+            }
+            ok = ok && big.insertCrops(crops.data(), chunk) == chunk;
+        }
+        long long popped[waves + 1] = {0};
+        int last = 0;
+        bool lazy = false, purged = false;
+        for (int wave = 1; wave <= waves && ok; wave++){
+            // pops between the waves see only live crops, in priority order
+            for (int i = 0; i < 1000; i++){
+                Crop crop = big.getNextCrop();
+                ok = ok && priorityFn2(crop) >= last
+                    && (crop.getDeadline() == 0 || crop.getDeadline() > big.getTime());
+                last = priorityFn2(crop);
+                popped[crop.getDeadline() / 1000]++;
+            }
+            ok = ok && big.expire(wave * 1000) == perWave[wave] - popped[wave];
+            long long live = perWave[0] - popped[0];
+            for (int later = wave + 1; later <= waves; later++) live += perWave[later] - popped[later];
+            ok = ok && big.numCrops() == live && big.m_size - big.m_expired == live;
+            lazy = lazy || big.m_expired > 0;
+            purged = purged || (wave > 1 && big.m_expired == 0);
+        }
+        Crop crop;
+        long long rest = 0;
+        while (ok && big.popNextCrop(crop)){
+            ok = crop.getDeadline() == 0;
+            rest++;
+        }
+        ok = ok && lazy && purged && rest == perWave[0] - popped[0] && big.m_size == 0;
+
+        // a TTL stamps the crops, a copy keeps its own clock, stale deadlines are refused
+        Region a(priorityFn2, MINHEAP, LEFTIST, 1);
+        a.setTTL(10);
+        for (int i = 0; i < 100; i++) a.insertCrop(Crop(MINCROPID + i, 60, 1 + i, i % 4, i % 7));
+        a.expire(5);
+        Crop late(MINCROPID + 500, 60, 50, NOON, BEAN);
+        late.setDeadline(3);
+        ok = ok && !a.insertCrop(late);
+        late.setDeadline(20);
+        ok = ok && a.insertCrop(late) && a.peekNextCrop().getDeadline() == 10;
+        Region copy(a);
+        ok = ok && a.expire(10) == 100 && a.numCrops() == 1 && copy.numCrops() == 101
+            && copy.getTime() == 5 && a.stats().count == 1;
+
+        // crops of a region with an older clock expire on arrival
+        Region behind(priorityFn2, MINHEAP, LEFTIST, 1);
+        for (int i = 0; i < 40; i++){
+            Crop c(MINCROPID + 600 + i, 60, 1 + i, i % 4, i % 7);
+            c.setDeadline(i < 30 ? 8 : 40);
+            behind.insertCrop(c);
+        }
+        a.mergeWithQueue(behind);
+        ok = ok && a.numCrops() == 11 && behind.numCrops() == 0 && a.m_size == 11
+            && a.expire(20) == 1 && a.expire(40) == 10 && a.numCrops() == 0;
+
+        // both ends of a min-max heap skip expired crops, so do sub-heap pops
+        Region mm(priorityFn2, MINHEAP, MINMAX, 1);
+        Region parts(priorityFn2, MINHEAP, SKEW, 1);
+        parts.setPartition(BYTIME);
+        for (int i = 0; i < 500; i++){
+            Crop c(MINCROPID + i, 60, 1 + (i * 37) % 100, i % 4, i % 7);
+            c.setDeadline(i % 3 == 0 ? 50 : 0);
+            mm.insertCrop(c);
+            c.setDeadline(i % 5 == 0 ? 50 : 0);
+            parts.insertCrop(c);
+        }
+        ok = ok && mm.expire(50) == 167 && mm.m_expired > 0 && mm.numCrops() == 333
+            && checkMinMax(mm) && checkBothEnds(mm, priorityFn2);
+        ok = ok && parts.expire(50) == 100;
+        Crop window[500];
+        int count = 0;
+        for (int key = MORNING; key <= NIGHT; key++){
+            int got = parts.getNextCrops(key, 500, window);
+            for (int i = 0; i < got; i++) ok = ok && window[i].getDeadline() == 0;
+            count += got;
+        }
+        ok = ok && count == 400 && parts.numCrops() == 0;
+
+        // GLOBAL serves region 1's driest crops until they expire
+        Irrigator irr(10, GLOBAL);
+        for (int r = 1; r <= 3; r++){
+            Region reg(priorityFn2, MINHEAP, SKEW, r);
+            reg.setTTL(100 * r);
+            for (int i = 0; i < 50; i++){
+                reg.insertCrop(Crop(MINCROPID + 100 * r + i, 60, 1 + (r - 1) * 33 + i % 33, MORNING, BEAN));
+            }
+            irr.addRegion(reg);
+        }
+        int served[4] = {0};
+        for (int i = 0; i < 20; i++){
+            irr.getCrop(crop);
+            served[(crop.getCropID() - MINCROPID) / 100]++;
+        }
+        ok = ok && served[1] == 20 && irr.expire(150) == 30;
+        for (int i = 0; i < 20; i++){
+            irr.getCrop(crop);
+            served[(crop.getCropID() - MINCROPID) / 100]++;
+        }
+        ok = ok && served[2] == 20 && irr.expire(250) == 30;
+        int rest3 = 0;
+        while (irr.getCrop(crop)) rest3 += (crop.getCropID() - MINCROPID) / 100 == 3;
+        ok = ok && rest3 == 50;
+
+        // deadlines, TTLs and expiries survive a checkpoint and the log after it
+        const char* snapPath = "journal_expiry.snap";
+        const char* logPath = "journal_expiry.log";
+        remove(snapPath);
+        remove(logPath);
+        Region live(priorityFn2, MINHEAP, LEFTIST, 1);
+        Irrigator liveIrr(10, FAIRSHARE);
+        Region* liveRegions[1] = {&live};
+        {
+            Journal journal;
+            journal.registerPriorityFn(priorityFn2);
+            if (!journal.open(logPath)) return false;
+            live.setJournal(&journal, 0);
+            liveIrr.setJournal(&journal);
+            live.setTTL(25);
+            Crop batch[40];
+            for (int i = 0; i < 40; i++){
+                batch[i] = Crop(MINCROPID + 900 + i, 70, 1 + (i * 13) % 100, i % 4, i % 7);
+                batch[i].setDeadline(i % 2 == 0 ? 30 + i : 0);
+            }
+            live.insertCrops(batch, 40);
+            for (int i = 0; i < 200; i++){
+                Crop c(MINCROPID + i, 30 + i % 80, 1 + (i * 7) % 100, i % 4, i % 7);
+                if (i % 3 == 0) c.setDeadline(i + 10);
+                live.insertCrop(c);
+                if (i % 10 == 9) live.expire(i);
+                if (i % 7 == 6 && live.numCrops() > 0) live.getNextCrop();
+                if (i == 100 && !journal.checkpoint(snapPath, &liveIrr, liveRegions, 1)) return false;
+                if (i % 40 == 0){
+                    Region reg(priorityFn2, MINHEAP, SKEW, 1 + i / 40);
+                    reg.expire(i);
+                    reg.setTTL(50);
+                    for (int k = 0; k < 10; k++) reg.insertCrop(Crop(MINCROPID + 300 + i + k, 60, 1 + k * 9, k % 4, k % 7));
+                    liveIrr.addRegion(reg);
+                    liveIrr.expire(i);
+                    liveIrr.getCrop(crop);
+                }
+            }
+            live.setJournal(nullptr, 0);
+            liveIrr.setJournal(nullptr);
+        }
+        Region restored;
+        Irrigator restoredIrr(10, FAIRSHARE);
+        Region* regions[1] = {&restored};
+        Journal recovery;
+        recovery.registerPriorityFn(priorityFn2);
+        long long replayed = recovery.recover(snapPath, logPath, &restoredIrr, regions, 1);
+        remove(snapPath);
+        remove(logPath);
+        ok = ok && replayed > 100 && restored.getTime() == live.getTime() && restored.getTTL() == 25
+            && restored.m_expired == live.m_expired && samePopOrder(live, restored)
+            && restored.expire(1000) == live.expire(1000) && samePopOrder(live, restored);
+        return ok && sameDispatchOrder(liveIrr, restoredIrr);
+    }
+
+    // ---------- IRRIGATOR MERGE TESTS ----------
+
+    // every region entry is served no later than its children
+    static bool checkRegionHeap(const Irrigator& irr){
+        for (int i = ROOTINDEX + 1; i <= irr.m_size; i++){
+            if (irr.before(irr.m_heap[i], irr.m_heap[i / 2])) return false;
+        }
+        return true;
+    }
+
+    // the crop IDs of every region, in no particular order
+    static void collectIDs(const Crop* node, vector<int>& ids){
+        if (node == nullptr) return;
+        ids.push_back(node->getCropID());
+        collectIDs(node->m_left, ids);
+        collectIDs(node->m_right, ids);
+    }
+
+    // Test 54: mergeWith joins regions with the same regPrior and configuration,
+    // moves the others without copying a crop and heapifies the entries once
+    bool testIrrigatorMerge(){
+        Irrigator a(20, GLOBAL);
+        Irrigator b(20, GLOBAL);
+        vector<int> expected;
+        for (int p = 1; p <= 6; p++){
+            Region r = buildRegion(priorityFn2, MINHEAP, SKEW, p, 40, 500 + p);
+            collectIDs(r.m_heap, expected);
+            a.addRegion(r);
+        }
+        // 4 and 5 join the regions there, 6 is leftist and moves like 7 to 9
+        const int priors[5] = {4, 5, 6, 7, 8};
+        for (int i = 0; i < 5; i++){
+            Region r = buildRegion(priorityFn2, MINHEAP, priors[i] == 6 ? LEFTIST : SKEW, priors[i], 30, 600 + i);
+            collectIDs(r.m_heap, expected);
+            b.addRegion(r);
+        }
+        Region big = buildRegion(priorityFn2, MINHEAP, SKEW, 9, 2000, 700);
+        collectIDs(big.m_heap, expected);
+        b.addRegion(big);
+        const Crop* bigRoot = nullptr;
+        for (int i = ROOTINDEX; i <= b.m_size; i++){
+            if (b.regionAt(i).getRegPrior() == 9) bigRoot = b.regionAt(i).m_heap;
+        }
+        long long copies = a.counters().regionCopies + b.counters().regionCopies;
+
+        bool ok = !a.mergeWith(a) && a.mergeWith(b);
+        ok = ok && a.m_size == 10 && b.m_size == 0 && checkRegionHeap(a)
+            && a.counters().regionCopies + b.counters().regionCopies == copies;
+        bool moved = false;
+        int sixes = 0;
+        for (int i = ROOTINDEX; i <= a.m_size; i++){
+            const Region& r = a.regionAt(i);
+            if (r.getRegPrior() == 9) moved = r.m_heap == bigRoot && r.numCrops() == 2000;
+            if (r.getRegPrior() == 6) sixes++;
+            if (r.getRegPrior() == 4 && r.numCrops() != 70) ok = false;
+        }
+        ok = ok && moved && sixes == 2;
+        Crop crop;
+        ok = ok && !b.getCrop(crop);
+
+        // no room for both regions: neither irrigator changes
+        Irrigator small(4, GLOBAL);
+        Irrigator two(10, GLOBAL);
+        for (int p = 1; p <= 2; p++){
+            Region r = buildRegion(priorityFn2, MINHEAP, SKEW, p, 5, 800 + p);
+            small.addRegion(r);
+            Region other = buildRegion(priorityFn2, MINHEAP, SKEW, 10 + p, 5, 810 + p);
+            two.addRegion(other);
+        }
+        ok = ok && !small.mergeWith(two) && small.m_size == 2 && two.m_size == 2;
+
+        // every crop comes out once, in global priority order
+        vector<int> served;
+        int last = 0;
+        while (a.getCrop(crop)){
+            int p = priorityFn2(crop);
+            if (p < last) ok = false;
+            last = p;
+            served.push_back(crop.getCropID());
+        }
+        sort(expected.begin(), expected.end());
+        sort(served.begin(), served.end());
+        ok = ok && served == expected;
+
+        // the merge is replayed from the log, the merged irrigator is logged with it
+        const char* logPath = "journal_merge.log";
+        remove(logPath);
+        Irrigator liveIrr(10, FAIRSHARE);
+        {
+            Journal journal;
+            journal.registerPriorityFn(priorityFn2);
+            if (!journal.open(logPath)) return false;
+            liveIrr.setJournal(&journal);
+            Irrigator other(10, FAIRSHARE);
+            for (int p = 1; p <= 3; p++){
+                Region r = buildRegion(priorityFn2, MINHEAP, SKEW, p, 20, 900 + p);
+                liveIrr.addRegion(r);
+                Region s = buildRegion(priorityFn2, MINHEAP, p == 2 ? LEFTIST : SKEW, p + 1, 20, 910 + p);
+                other.addRegion(s);
+            }
+            for (int i = 0; i < 15; i++){
+                liveIrr.getCrop(crop);
+                other.getCrop(crop);
+            }
+            if (!liveIrr.mergeWith(other)) return false;
+            for (int i = 0; i < 10; i++) liveIrr.getCrop(crop);
+            liveIrr.setJournal(nullptr);
+        }
+        Irrigator restoredIrr(10, FAIRSHARE);
+        Region* regions[1] = {nullptr};
+        Journal recovery;
+        recovery.registerPriorityFn(priorityFn2);
+        long long replayed = recovery.recover(nullptr, logPath, &restoredIrr, regions, 0);
+        remove(logPath);
+        return ok && replayed == 1 + 3 + 15 + 1 + 10 && sameDispatchOrder(liveIrr, restoredIrr);
+    }
+
+    // ---------- AGING TESTS ----------
+
+    // Test 55: an old crop is not starved by a steady inflow of better ones, a
+    // tick touches no node, and the rate holds through re-keys, merges and the log
+    bool testAging(){
+        // one crop of priority 103 against ten crops of priority 1 every tick
+        int servedAt[2] = {-1, -1};
+        for (int rate = 0; rate <= 1; rate++){
+            Region reg(priorityFn2, MINHEAP, LEFTIST, 1);
+            reg.setAging(rate);
+            reg.insertCrop(Crop(MINCROPID, 70, MAXMOISTURE, NIGHT, 0));
+            for (int tick = 1; tick <= 300 && servedAt[rate] < 0; tick++){
+                reg.expire(tick);
+                for (int i = 0; i < 10; i++) reg.insertCrop(Crop(MINCROPID + tick * 10 + i, 70, MINMOISTURE, MORNING, 0));
+                for (int i = 0; i < 10; i++){
+                    if (reg.getNextCrop().getCropID() == MINCROPID) servedAt[rate] = tick;
+                }
+            }
+        }
+        bool ok = servedAt[0] < 0 && servedAt[1] >= 102 && servedAt[1] <= 103;
+
+        // the clock moves, no key changes; drained at one clock the aged priorities never drop
+        Region aged(priorityFn2, MINHEAP, SKEW, 1);
+        aged.setAging(3);
+        Random moistureGen(MINMOISTURE, MAXMOISTURE);
+        for (int tick = 0; tick < 50; tick++){
+            aged.expire(tick);
+            for (int i = 0; i < 40; i++) aged.insertCrop(Crop(MINCROPID + tick * 40 + i, 70, moistureGen.getRandNum(), i % 4, i % 7));
+        }
+        const Crop* root = aged.m_heap;
+        long long rootKey = root->m_key;
+        aged.expire(1000);
+        ok = ok && aged.m_heap == root && root->m_key == rootKey && aged.getTime() == 1000;
+        Region drain(aged);
+        long long last = LLONG_MIN;
+        while (drain.numCrops() > 0){
+            Crop c = drain.getNextCrop();
+            long long p = drain.agedPriority(c);
+            if (p < last || c.getEpoch() != (c.getCropID() - MINCROPID) / 40) ok = false;
+            last = p;
+        }
+        // without aging the crops are re-keyed by priority alone
+        Region plain(aged);
+        plain.setAging(0);
+        ok = ok && plain.getAging() == 0 && checkHeapProperty(plain) && checkRemovalOrder(plain);
+
+        // MAXHEAP ages upward; flipping the heap type re-keys instead of negating
+        Region hot(priorityFn1, MAXHEAP, LEFTIST, 1);
+        hot.setAging(2);
+        for (int tick = 0; tick < 20; tick++){
+            hot.expire(tick);
+            for (int i = 0; i < 10; i++) hot.insertCrop(Crop(MINCROPID + tick * 10 + i, 30 + (tick * 17 + i * 7) % 80, 50, NOON, i % 7));
+        }
+        Region hotCopy(hot);
+        last = LLONG_MAX;
+        while (hotCopy.numCrops() > 0){
+            long long p = hotCopy.agedPriority(hotCopy.getNextCrop());
+            if (p > last) ok = false;
+            last = p;
+        }
+        hot.setPriorityFn(priorityFn1, MINHEAP);
+        last = LLONG_MIN;
+        while (hot.numCrops() > 0){
+            long long p = hot.agedPriority(hot.getNextCrop());
+            if (p < last) ok = false;
+            last = p;
+        }
+
+        // regions merge only at the same rate
+        Region other(priorityFn2, MINHEAP, SKEW, 1);
+        other.insertCrop(Crop(MINCROPID + 5, 70, 10, MORNING, 0));
+        try {
+            aged.mergeWithQueue(other);
+            ok = false;
+        } catch (const domain_error&) {}
+        other.setAging(3);
+        aged.mergeWithQueue(other);
+        ok = ok && aged.numCrops() == 50 * 40 + 1 && other.numCrops() == 0;
+
+        // GLOBAL compares aged top crops: the old crop overtakes after 50 ticks
+        Irrigator irr(5, GLOBAL);
+        Region old(priorityFn2, MINHEAP, LEFTIST, 1);
+        old.setAging(1);
+        old.insertCrop(Crop(MINCROPID + 1, 70, 60, MORNING, 0));
+        Region fresh(priorityFn2, MINHEAP, LEFTIST, 2);
+        for (int i = 0; i < 5; i++) fresh.insertCrop(Crop(MINCROPID + 10 + i, 70, 20, MORNING, 0));
+        irr.addRegion(old);
+        irr.addRegion(fresh);
+        Crop crop;
+        irr.getCrop(crop);
+        ok = ok && crop.getCropID() != MINCROPID + 1;
+        irr.expire(50);
+        irr.getCrop(crop);
+        ok = ok && crop.getCropID() == MINCROPID + 1;
+
+        // epochs and the rate survive a checkpoint and the log after it
+        const char* snapPath = "journal_aging.snap";
+        const char* logPath = "journal_aging.log";
+        remove(snapPath);
+        remove(logPath);
+        Region live(priorityFn2, MINHEAP, LEFTIST, 1);
+        Region* liveRegions[1] = {&live};
+        {
+            Journal journal;
+            journal.registerPriorityFn(priorityFn2);
+            if (!journal.open(logPath)) return false;
+            live.setJournal(&journal, 0);
+            live.setAging(2);
+            for (int tick = 1; tick <= 60; tick++){
+                live.expire(tick);
+                live.insertCrop(Crop(MINCROPID + tick, 70, 1 + (tick * 37) % 100, tick % 4, tick % 7));
+                if (tick % 3 == 0) live.getNextCrop();
+                if (tick == 30 && !journal.checkpoint(snapPath, nullptr, liveRegions, 1)) return false;
+                if (tick == 45) live.setAging(1);
+            }
+            live.setJournal(nullptr, 0);
+        }
+        Region restored;
+        Region* regions[1] = {&restored};
+        Journal recovery;
+        recovery.registerPriorityFn(priorityFn2);
+        long long replayed = recovery.recover(snapPath, logPath, nullptr, regions, 1);
+        remove(snapPath);
+        remove(logPath);
+        return ok && replayed > 30 && restored.getAging() == 1 && restored.getTime() == live.getTime()
+            && samePopOrder(live, restored);
+    }
+
+    // ---------- RELAXED REGION TESTS ----------
+
+    // Drains a relaxed region holding the IDs first..first+count-1 and returns
+    // the mean rank error: how many better crops were still queued at each pop.
+    // max gets the largest; -1 if a crop is missing, doubled or unknown.
+    static double rankError(RelaxedRegion& relaxed, int first, int count, int& max){
+        vector<int> tree(count + 1, 0);     // Fenwick tree of the crops still queued
+        for (int i = 1; i <= count; i++){
+            for (int k = i; k <= count; k += k & -k) tree[k]++;
+        }
+        long long total = 0;
+        int popped = 0;
+        max = 0;
+        Crop crop;
+        while (relaxed.getNextCrop(crop)){
+            int pos = crop.getCropID() - first + 1;
+            if (pos < 1 || pos > count) return -1;
+            int better = 0, here = 0;
+            for (int k = pos - 1; k > 0; k -= k & -k) better += tree[k];
+            for (int k = pos; k > 0; k -= k & -k) here += tree[k];
+            if (here == better) return -1;  // popped before
+            for (int k = pos; k <= count; k += k & -k) tree[k]--;
+            total += better;
+            if (better > max) max = better;
+            popped++;
+        }
+        return (popped == count) ? (double)total / count : -1;
+    }
+
+    // Test 56: the relaxed region serves every crop once, close to priority
+    // order, and keeps that under concurrent inserts and pops
+    bool testRelaxedRegion(){
+        bool ok = false;
+        try {
+            RelaxedRegion bad(idPriority, MINHEAP, SKEW, 0);
+        } catch (const invalid_argument&) { ok = true; }
+        try {
+            RelaxedRegion bad(nullptr, MINHEAP, SKEW, 2);
+            ok = false;
+        } catch (const invalid_argument&) {}
+
+        // one queue is a plain region: no rank error
+        const int count = 20000;
+        vector<int> ids(count);
+        for (int i = 0; i < count; i++) ids[i] = MINCROPID + i;
+        shuffle(ids.begin(), ids.end(), mt19937(56));
+        RelaxedRegion exact(idPriority, MINHEAP, LEFTIST, 1, 1);
+        for (int i = 0; i < count; i++) exact.insertCrop(Crop(ids[i], 70, 50, NOON, 0));
+        int max = 0;
+        ok = ok && exact.numQueues() == 1 && exact.numCrops() == count
+            && !exact.insertCrop(Crop(0, 70, 50, NOON, 0)) && rankError(exact, MINCROPID, count, max) == 0.0;
+
+        // 4 threads * 2 queues: a pop is a few ranks off, never far
+        RelaxedRegion relaxed(idPriority, MINHEAP, SKEW, 4);
+        for (int i = 0; i < count; i++) relaxed.insertCrop(Crop(ids[i], 70, 50, NOON, 0));
+        double mean = rankError(relaxed, MINCROPID, count, max);
+        ok = ok && relaxed.numQueues() == 8 && mean >= 0 && mean < 2 * relaxed.numQueues()
+            && max < 50 * relaxed.numQueues() && relaxed.numCrops() == 0;
+
+        // threads insert their own IDs and pop as they go, every crop comes out once
+        const int threads = 4, perThread = 5000;
+        RelaxedRegion shared(idPriority, MAXHEAP, LEFTIST, threads);
+        vector<vector<int> > served(threads);
+        vector<thread> workers;
+        for (int t = 0; t < threads; t++){
+            workers.push_back(thread([&shared, &served, t](){
+                Crop crop;
+                for (int i = 0; i < perThread; i++){
+                    shared.insertCrop(Crop(MINCROPID + t * perThread + i, 70, 50, NOON, 0));
+                    if (i % 2 == 1 && shared.getNextCrop(crop)) served[t].push_back(crop.getCropID());
+                }
+            }));
+        }
+        for (int t = 0; t < threads; t++) workers[t].join();
+        vector<int> all;
+        Crop crop;
+        while (shared.getNextCrop(crop)) all.push_back(crop.getCropID());
+        for (int t = 0; t < threads; t++) all.insert(all.end(), served[t].begin(), served[t].end());
+        sort(all.begin(), all.end());
+        bool once = (int)all.size() == threads * perThread;
+        for (int i = 0; once && i < (int)all.size(); i++) once = all[i] == MINCROPID + i;
+        return ok && once && shared.numCrops() == 0 && !shared.getNextCrop(crop);
+    }
+
+    // Test 57: empty and expired regions the irrigator drops without serving
+    // a crop are dropped again on recovery, the heaps stay the same
+    bool testJournalDropsEmpty(){
+        const char* logPath = "journal_test.log";
+        remove(logPath);
+        Irrigator live(10);
+        bool ok = true;
+        {
+            Journal journal;
+            journal.registerPriorityFn(priorityFn2);
+            if (!journal.open(logPath)) return false;
+            live.setJournal(&journal);
+            Crop c;
+            // an empty region alone, getCrop finds nothing but drops it
+            Region empty(priorityFn2, MINHEAP, SKEW, 1);
+            live.addRegion(empty);
+            ok = ok && !live.getCrop(c) && live.m_size == 0;
+
+            // an expired region alone, the same
+            Region timed(priorityFn2, MINHEAP, LEFTIST, 2);
+            timed.setTTL(10);
+            for (int i = 0; i < 5; i++) timed.insertCrop(Crop(MINCROPID + i, 70, 10 + i, i % 4, 0));
+            live.addRegion(timed);
+            live.expire(20);
+            ok = ok && !live.getCrop(c) && live.m_size == 0;
+
+            // an expired region ahead of a live one, topRegion drops it
+            Region later = buildRegion(priorityFn2, MINHEAP, SKEW, 3, 20, 570);
+            live.addRegion(timed);
+            live.addRegion(later);
+            live.expire(40);
+            ok = ok && live.topRegion() != nullptr && live.m_size == 1;
+
+            // what is left is served in the same order after recovery
+            live.addRegion(empty);
+            Region last = buildRegion(priorityFn2, MINHEAP, LEFTIST, 4, 20, 571);
+            live.addRegion(last);
+            live.setJournal(nullptr);
+        }
+
+        Irrigator restored(10);
+        Journal recovery;
+        recovery.registerPriorityFn(priorityFn2);
+        long long replayed = recovery.recover(nullptr, logPath, &restored, nullptr, 0);
+        remove(logPath);
+        return ok && replayed > 0 && restored.m_size == live.m_size
+            && sameDispatchOrder(live, restored);
+    }
 };
 
 // ------------------------------
-// Main: run all 29 tests
+// Main: run all 57 tests
 // ------------------------------
 int main(){
     Tester T;
     int passed = 0;
-    int total = 29;
+    int total = 57;
 
     cout << "========================================" << endl;
     cout << "  COMPREHENSIVE TEST SUITE - PROJECT 3" << endl;
@@ -694,6 +2583,78 @@ int main(){
     cout << "28. Set priority function on region: " << (T.testIrrigatorSetPriorityFn() ? (passed++, "PASSED") : "FAILED") << endl;
     cout << "29. Set structure on region: " << (T.testIrrigatorSetStructure() ? (passed++, "PASSED") : "FAILED") << endl;
 
+    cout << endl << "CROP LOADER TESTS:" << endl;
+    cout << "30. Loader CSV routing and clamping: " << (T.testLoaderCSV() ? (passed++, "PASSED") : "FAILED") << endl;
+    cout << "31. Loader binary records: " << (T.testLoaderBinary() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "JOURNAL TESTS:" << endl;
+    cout << "32. Journal replay rebuilds state: " << (T.testJournalReplay() ? (passed++, "PASSED") : "FAILED") << endl;
+    cout << "33. Journal checkpoint and torn tail: " << (T.testJournalCheckpoint() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "COUNTER TESTS:" << endl;
+    cout << "34. Hot-path counters: " << (T.testCounters() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "TRACING TESTS:" << endl;
+    cout << "35. Latency histogram percentiles: " << (T.testLatencyHistogram() ? (passed++, "PASSED") : "FAILED") << endl;
+    cout << "36. Tracer merges thread histograms: " << (T.testTracerMerge() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "PERSISTENT REGION TESTS:" << endl;
+    cout << "37. Persistent versions share nodes: " << (T.testPersistentVersions() ? (passed++, "PASSED") : "FAILED") << endl;
+    cout << "38. Persistent rebuild, merge and delete: " << (T.testPersistentRebuild() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "SCHEDULING TESTS:" << endl;
+    cout << "39. Global crop order across regions: " << (T.testGlobalSchedule() ? (passed++, "PASSED") : "FAILED") << endl;
+    cout << "40. Fair-share service proportions: " << (T.testFairShare() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "PARTITION TESTS:" << endl;
+    cout << "41. Time-window partitions: " << (T.testTimePartition() ? (passed++, "PASSED") : "FAILED") << endl;
+    cout << "42. Plant-type sub-queues and batches: " << (T.testTypeBatches() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "CROP ORDER TESTS:" << endl;
+    cout << "43. Lexicographic order matches a sort: " << (T.testCropOrder() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "AGGREGATE TESTS:" << endl;
+    cout << "44. Region stats stay in sync: " << (T.testRegionStats() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "SHARD TESTS:" << endl;
+    cout << "45. Sharded irrigator merges shards: " << (T.testShardedIrrigator() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "PIPELINE TESTS:" << endl;
+    cout << "46. Pipeline backpressure and dispatch order: " << (T.testPipeline() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "LAYOUT TESTS:" << endl;
+    cout << "47. Compaction into preorder runs: " << (T.testCompaction() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "INCREMENTAL REBUILD TESTS:" << endl;
+    cout << "48. Budgeted priority change: " << (T.testIncrementalRebuild() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "CONVERSION TESTS:" << endl;
+    cout << "49. Conversion without re-merging: " << (T.testFastConversion() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "ALLOCATION TESTS:" << endl;
+    cout << "50. Allocation-free insert and pop: " << (T.testAllocationFree() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "EXPORT TESTS:" << endl;
+    cout << "51. Buffered export: " << (T.testExport() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "DOUBLE-ENDED TESTS:" << endl;
+    cout << "52. Min-max region, both ends: " << (T.testDoubleEnded() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "EXPIRY TESTS:" << endl;
+    cout << "53. Timer-wheel expiry in waves: " << (T.testExpiry() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "IRRIGATOR MERGE TESTS:" << endl;
+    cout << "54. Irrigator merge and heapify: " << (T.testIrrigatorMerge() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "AGING TESTS:" << endl;
+    cout << "55. Priority aging without rebuilds: " << (T.testAging() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "RELAXED REGION TESTS:" << endl;
+    cout << "56. Relaxed concurrent region: " << (T.testRelaxedRegion() ? (passed++, "PASSED") : "FAILED") << endl;
+
+    cout << endl << "RECOVERY TESTS:" << endl;
+    cout << "57. Recovery drops empty regions: " << (T.testJournalDropsEmpty() ? (passed++, "PASSED") : "FAILED") << endl;
+
     cout << endl << "========================================" << endl;
     cout << "       FINAL TEST RESULTS" << endl;
     cout << "========================================" << endl;
@@ -0,0 +1,205 @@
+// CMSC 341 - Fall 2025 - Project 3
+#include "pipeline.h"
+#include <unordered_map>
+
+// constructor - starts the prioritize, heap and valve threads
+IrrigationPipeline::IrrigationPipeline(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure,
+                                       valvefn_t valve, int valves, int batchSize, int queueCapacity)
+  : m_ingest(queueCapacity),
+    m_batches(queueCapacity / (batchSize < 1 ? 1 : batchSize) + 1),
+    m_dispatch(valves < 1 ? 1 : valves) {
+  if (priFn == nullptr || valve == nullptr || heapType == NOTYPE || structure == NOSTRUCT) {
+    throw invalid_argument("IrrigationPipeline needs a priority function, heap type, structure and valve");
+  }
+  m_priorFunc = priFn;
+  m_heapType = heapType;
+  m_structure = structure;
+  m_valve = valve;
+  m_batchSize = (batchSize < 1) ? 1 : batchSize;
+  m_numValves = (valves < 1) ? 1 : valves;
+  m_finished = false;
+  m_submitted = 0;
+  m_rejected = 0;
+  m_dispatched = 0;
+  m_numBatches = 0;
+
+  m_prioritizer = thread(&IrrigationPipeline::prioritize, this);
+  m_heapWorker = thread(&IrrigationPipeline::maintainHeap, this);
+  m_valves = new thread[m_numValves];
+  for (int i = 0; i < m_numValves; i++) {
+    m_valves[i] = thread(&IrrigationPipeline::dispatch, this);
+  }
+}
+
+IrrigationPipeline::~IrrigationPipeline(){
+  finish();
+  delete[] m_valves;
+}
+
+// submit - stamps the reading and queues it for the prioritize stage
+bool IrrigationPipeline::submit(const Crop& reading){
+  Reading item;
+  item.m_crop = reading;
+  item.m_submitted = now();
+  if (!m_ingest.push(item)) {
+    return false;
+  }
+  lock_guard<mutex> guard(m_statsLock);
+  m_submitted++;
+  return true;
+}
+
+// finish - closing the ingest queue drains the stages one after the other,
+// every stage closes the queue behind it when its input is drained
+void IrrigationPipeline::finish(){
+  lock_guard<mutex> guard(m_finishLock);
+  if (m_finished) {
+    return;
+  }
+  m_finished = true;
+  m_ingest.close();
+  m_prioritizer.join();
+  m_heapWorker.join();
+  for (int i = 0; i < m_numValves; i++) {
+    m_valves[i].join();
+  }
+}
+
+PipelineStats IrrigationPipeline::stats() const {
+  lock_guard<mutex> guard(m_statsLock);
+  PipelineStats result;
+  result.submitted = m_submitted;
+  result.rejected = m_rejected;
+  result.dispatched = m_dispatched;
+  result.batches = m_numBatches;
+  result.p50 = m_latency.percentile(50);
+  result.p99 = m_latency.percentile(99);
+  result.maxLatency = m_latency.maxValue();
+  result.meanLatency = m_latency.mean();
+  return result;
+}
+
+/******************************************
+* Private function *
+******************************************/
+// prioritize - takes the readings that are waiting (up to a batch), drops the
+// ones the priority function refuses and builds the rest into one heap in
+// linear time, so the heap stage only merges
+void IrrigationPipeline::prioritize(){
+  Reading reading;
+  while (m_ingest.pop(reading)) {
+    Batch batch;
+    batch.m_readings = new Reading[m_batchSize];
+    batch.m_count = 0;
+    int rejected = 0;
+    do {
+      if (m_priorFunc(reading.m_crop) > 0) {
+        batch.m_readings[batch.m_count++] = reading;
+      }
+      else {
+        rejected++;
+      }
+    } while (batch.m_count < m_batchSize && m_ingest.tryPop(reading));
+
+    if (batch.m_count > 0) {
+      Crop* crops = new Crop[batch.m_count];
+      for (int i = 0; i < batch.m_count; i++) {
+        crops[i] = batch.m_readings[i].m_crop;
+      }
+      batch.m_heap = new Region(m_priorFunc, m_heapType, m_structure, 1);
+      batch.m_heap->insertCrops(crops, batch.m_count);
+      delete[] crops;
+      m_batches.push(batch);
+    }
+    else {
+      delete[] batch.m_readings;
+    }
+
+    lock_guard<mutex> guard(m_statsLock);
+    m_rejected += rejected;
+    m_numBatches += (batch.m_count > 0) ? 1 : 0;
+  }
+  m_batches.close();
+}
+
+// maintainHeap - merges every waiting batch before handing the best crop to
+// the valves. The crop it holds while the valves are busy goes back into the
+// heap when a batch arrives, so a more urgent new crop can overtake it.
+void IrrigationPipeline::maintainHeap(){
+  Region heap(m_priorFunc, m_heapType, m_structure, 1);
+  unordered_multimap<int, long long> submitted;   // crop ID -> submit time
+  Reading held;
+  bool holding = false;
+
+  while (true) {
+    Batch batch;
+    bool got = false;
+    if (!holding && heap.numCrops() == 0) {
+      got = m_batches.pop(batch);
+    }
+    else if (holding) {
+      got = m_batches.popFor(batch, chrono::microseconds(100));
+    }
+    else {
+      got = m_batches.tryPop(batch);
+    }
+
+    if (got) {
+      if (holding) {
+        heap.insertCrop(held.m_crop);
+        submitted.insert(make_pair(held.m_crop.getCropID(), held.m_submitted));
+        holding = false;
+      }
+      for (int i = 0; i < batch.m_count; i++) {
+        submitted.insert(make_pair(batch.m_readings[i].m_crop.getCropID(),
+                                   batch.m_readings[i].m_submitted));
+      }
+      heap.mergeWithQueue(*batch.m_heap);
+      delete batch.m_heap;
+      delete[] batch.m_readings;
+      continue;
+    }
+
+    if (!holding && heap.numCrops() > 0) {
+      heap.popNextCrop(held.m_crop);
+      unordered_multimap<int, long long>::iterator stamp = submitted.find(held.m_crop.getCropID());
+      held.m_submitted = stamp->second;
+      submitted.erase(stamp);
+      holding = true;
+    }
+    if (holding) {
+      // no batch can arrive any more, waiting for a valve is all that is left
+      bool sent = m_batches.drained() ? m_dispatch.push(held) : m_dispatch.tryPush(held);
+      if (sent) {
+        holding = false;
+      }
+      continue;
+    }
+    if (m_batches.drained()) {
+      break;
+    }
+  }
+  m_dispatch.close();
+}
+
+// dispatch - one valve: opens it for every crop it gets and records how long
+// the crop took from submit until the valve returned
+void IrrigationPipeline::dispatch(){
+  LatencyHistogram latency;
+  long long dispatched = 0;
+  Reading reading;
+  while (m_dispatch.pop(reading)) {
+    m_valve(reading.m_crop);
+    latency.record(now() - reading.m_submitted);
+    dispatched++;
+  }
+
+  lock_guard<mutex> guard(m_statsLock);
+  m_latency.add(latency);
+  m_dispatched += dispatched;
+}
+
+long long IrrigationPipeline::now(){
+  return chrono::duration_cast<chrono::nanoseconds>(
+    chrono::steady_clock::now().time_since_epoch()).count();
+}
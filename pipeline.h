@@ -0,0 +1,176 @@
+// CMSC 341 - Fall 2025 - Project 3
+// Asynchronous irrigation pipeline. Sensor readings pass through bounded
+// queues between four stages, each on its own thread(s):
+//   ingest (submit) -> prioritize (batched heap builds) -> heap -> dispatch (valves)
+// A full queue blocks the stage before it, and the heap stage keeps taking
+// readings while the valves are busy, so slow valve I/O does not stall ingest.
+#ifndef PIPELINE_H
+#define PIPELINE_H
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include "irrigator.h"
+#include "tracing.h"
+
+#define DEFAULTPIPELINEBATCH 256    // readings prioritized together
+#define DEFAULTPIPELINEQUEUE 4096   // capacity of the ingest queue
+
+// opens the valve for a crop, may take as long as the valve I/O takes
+typedef void (*valvefn_t)(const Crop&);
+
+// A FIFO of at most capacity items shared by threads. push blocks while the
+// queue is full, pop while it is empty; after close() pushes fail and pop
+// returns the remaining items, then false.
+template <class T>
+class BoundedQueue{
+    public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // for testing purposes
+    explicit BoundedQueue(int capacity) : m_capacity(capacity < 1 ? 1 : capacity), m_closed(false) {}
+    BoundedQueue(const BoundedQueue& rhs) = delete;
+    BoundedQueue& operator=(const BoundedQueue& rhs) = delete;
+    bool push(const T& item){
+        unique_lock<mutex> guard(m_lock);
+        m_notFull.wait(guard, [this]{ return m_closed || (int)m_items.size() < m_capacity; });
+        if (m_closed) return false;
+        m_items.push_back(item);
+        m_notEmpty.notify_one();
+        return true;
+    }
+    bool tryPush(const T& item){  // false instead of waiting
+        lock_guard<mutex> guard(m_lock);
+        if (m_closed || (int)m_items.size() >= m_capacity) return false;
+        m_items.push_back(item);
+        m_notEmpty.notify_one();
+        return true;
+    }
+    bool pop(T& item){
+        unique_lock<mutex> guard(m_lock);
+        m_notEmpty.wait(guard, [this]{ return m_closed || !m_items.empty(); });
+        return take(item);
+    }
+    bool tryPop(T& item){
+        lock_guard<mutex> guard(m_lock);
+        return take(item);
+    }
+    // waits at most timeout for an item
+    bool popFor(T& item, chrono::microseconds timeout){
+        unique_lock<mutex> guard(m_lock);
+        m_notEmpty.wait_for(guard, timeout, [this]{ return m_closed || !m_items.empty(); });
+        return take(item);
+    }
+    void close(){
+        lock_guard<mutex> guard(m_lock);
+        m_closed = true;
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+    bool closed() const {
+        lock_guard<mutex> guard(m_lock);
+        return m_closed;
+    }
+    // closed and nothing left to pop
+    bool drained() const {
+        lock_guard<mutex> guard(m_lock);
+        return m_closed && m_items.empty();
+    }
+    int size() const {
+        lock_guard<mutex> guard(m_lock);
+        return (int)m_items.size();
+    }
+    int capacity() const {return m_capacity;}
+
+    private:
+    mutable mutex m_lock;
+    condition_variable m_notEmpty;
+    condition_variable m_notFull;
+    deque<T> m_items;
+    int m_capacity;
+    bool m_closed;
+
+    // the lock is held
+    bool take(T& item){
+        if (m_items.empty()) return false;
+        item = m_items.front();
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+};
+
+// Counts of a pipeline run. Latency is from submit() until the valve
+// returned, in nanoseconds.
+struct PipelineStats{
+    long long submitted;
+    long long rejected;       // readings the priority function refused
+    long long dispatched;
+    long long batches;        // heaps built by the prioritize stage
+    long long p50, p99, maxLatency;
+    double meanLatency;
+};
+
+class IrrigationPipeline{
+    public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // for testing purposes
+    // Crops are ordered like a Region(priFn, heapType, structure, 1) orders them.
+    // valves dispatch threads call valve, up to valves crops are in flight.
+    // Throws invalid_argument for a nullptr priority function or valve.
+    IrrigationPipeline(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure, valvefn_t valve,
+                       int valves = 1, int batchSize = DEFAULTPIPELINEBATCH,
+                       int queueCapacity = DEFAULTPIPELINEQUEUE);
+    ~IrrigationPipeline();  // finishes the run
+    IrrigationPipeline(const IrrigationPipeline& rhs) = delete;
+    IrrigationPipeline& operator=(const IrrigationPipeline& rhs) = delete;
+    // Hands a reading to the pipeline, blocks while the ingest queue is full.
+    // Any thread may submit. Returns false after finish().
+    bool submit(const Crop& reading);
+    // Stops ingest, waits until every accepted crop went through a valve
+    void finish();
+    PipelineStats stats() const;   // complete after finish()
+
+    private:
+    // a reading and when it was submitted
+    struct Reading{
+        Crop m_crop;
+        long long m_submitted;
+    };
+    // readings built into one heap by the prioritize stage
+    struct Batch{
+        Region* m_heap;
+        Reading* m_readings;  // the accepted readings, for their submit times
+        int m_count;
+    };
+
+    prifn_t m_priorFunc;
+    HEAPTYPE m_heapType;
+    STRUCTURE m_structure;
+    valvefn_t m_valve;
+    int m_batchSize;
+
+    BoundedQueue<Reading> m_ingest;
+    BoundedQueue<Batch> m_batches;
+    BoundedQueue<Reading> m_dispatch;   // small, the heap decides late
+
+    thread m_prioritizer;
+    thread m_heapWorker;
+    thread * m_valves;
+    int m_numValves;
+    bool m_finished;
+    mutex m_finishLock;
+
+    mutable mutex m_statsLock;
+    long long m_submitted;
+    long long m_rejected;
+    long long m_dispatched;
+    long long m_numBatches;
+    LatencyHistogram m_latency;
+
+    void prioritize();
+    void maintainHeap();
+    void dispatch();
+    static long long now();
+};
+#endif
@@ -0,0 +1,131 @@
+// CMSC 341 - Fall 2025 - Project 3
+#include "relaxed.h"
+#include <climits>
+#include <functional>
+#include <thread>
+
+// the random choices of one thread, xorshift64* seeded from the thread id
+static thread_local unsigned long long s_state = 0;
+
+static unsigned int nextRandom(){
+  if (s_state == 0) {
+    static atomic<unsigned long long> seeds(0x9E3779B97F4A7C15ULL);
+    s_state = hash<thread::id>()(this_thread::get_id()) ^ seeds.fetch_add(0x9E3779B97F4A7C15ULL);
+    if (s_state == 0) {
+      s_state = 1;
+    }
+  }
+  s_state ^= s_state >> 12;
+  s_state ^= s_state << 25;
+  s_state ^= s_state >> 27;
+  return (unsigned int)((s_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+// queue - an empty region, no top crop
+RelaxedRegion::Queue::Queue(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure)
+  : m_region(priFn, heapType, structure, 1), m_top(LLONG_MAX) {
+}
+
+RelaxedRegion::RelaxedRegion(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure,
+                             int numThreads, int queuesPerThread) : m_size(0) {
+  if (priFn == nullptr || heapType == NOTYPE || structure == NOSTRUCT) {
+    throw invalid_argument("RelaxedRegion needs a priority function, a heap type and a structure");
+  }
+  if (numThreads <= 0 || queuesPerThread <= 0) {
+    throw invalid_argument("RelaxedRegion needs at least one thread and one queue per thread");
+  }
+  m_numQueues = numThreads * queuesPerThread;
+  m_queues = new Queue*[m_numQueues];
+  for (int i = 0; i < m_numQueues; i++) {
+    m_queues[i] = new Queue(priFn, heapType, structure);
+  }
+}
+
+RelaxedRegion::~RelaxedRegion(){
+  for (int i = 0; i < m_numQueues; i++) {
+    delete m_queues[i];
+  }
+  delete[] m_queues;
+}
+
+// insertCrop - a busy region is skipped for another random one instead of waited on
+bool RelaxedRegion::insertCrop(const Crop& crop){
+  while (true) {
+    Queue* queue = m_queues[pick()];
+    if (!queue->m_lock.try_lock()) {
+      continue;
+    }
+    bool inserted = queue->m_region.insertCrop(crop);
+    if (inserted) {
+      m_size++;
+      queue->m_top.store(queue->m_region.topKey(), memory_order_relaxed);
+    }
+    queue->m_lock.unlock();
+    return inserted;
+  }
+}
+
+// getNextCrop - the tops are compared without locks, the better region is
+// locked and popped; if it changed meanwhile or is busy, two others are drawn.
+// Both empty happens when few crops are left, any region holding one is taken.
+bool RelaxedRegion::getNextCrop(Crop& crop){
+  while (m_size.load() > 0) {
+    int first = pick();
+    int second = pick();
+    long long firstTop = m_queues[first]->m_top.load(memory_order_relaxed);
+    long long secondTop = m_queues[second]->m_top.load(memory_order_relaxed);
+    Queue* queue = m_queues[(secondTop < firstTop) ? second : first];
+    long long other = (secondTop < firstTop) ? firstTop : secondTop;
+    if (firstTop == LLONG_MAX && secondTop == LLONG_MAX) {
+      queue = nonEmpty(first);
+      if (queue == nullptr) {
+        continue;   // the last crops are still being inserted
+      }
+    }
+    if (!queue->m_lock.try_lock()) {
+      continue;
+    }
+    // another thread popped here since the tops were read, the other one is better now
+    if (queue->m_region.topKey() > other) {
+      queue->m_lock.unlock();
+      continue;
+    }
+    bool popped = queue->m_region.popNextCrop(crop);
+    if (popped) {
+      m_size--;
+      queue->m_top.store(queue->m_region.topKey(), memory_order_relaxed);
+    }
+    queue->m_lock.unlock();
+    if (popped) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int RelaxedRegion::numQueues() const {
+  return m_numQueues;
+}
+
+int RelaxedRegion::numCrops() const {
+  return m_size.load();
+}
+
+/******************************************
+* Private function *
+******************************************/
+// a random region, every thread draws from its own generator
+int RelaxedRegion::pick() const {
+  return (int)(nextRandom() % (unsigned int)m_numQueues);
+}
+
+// the first region from index from on (wrapping) with a top crop, nullptr if none
+RelaxedRegion::Queue* RelaxedRegion::nonEmpty(int from) const {
+  for (int i = 0; i < m_numQueues; i++) {
+    Queue* queue = m_queues[(from + i) % m_numQueues];
+    if (queue->m_top.load(memory_order_relaxed) != LLONG_MAX) {
+      return queue;
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,52 @@
+// CMSC 341 - Fall 2025 - Project 3
+// Relaxed Region (MultiQueue): the crops are spread over c*threads regions,
+// each behind a lock of its own. An insert goes to a random region whose lock
+// is free, a pop takes the better top of two random regions. Threads rarely
+// wait on one another, so dispatch scales with the cores; in exchange a pop
+// may return a crop a few ranks behind the best one, on average about as many
+// as there are regions, and no crop is passed over for long.
+#ifndef RELAXED_H
+#define RELAXED_H
+#include <atomic>
+#include <mutex>
+#include "irrigator.h"
+
+class RelaxedRegion{
+    public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // for testing purposes
+    // numThreads * queuesPerThread regions of the given configuration.
+    // Throws invalid_argument for a missing priority function, heap type or
+    // structure, or if numThreads or queuesPerThread is not positive.
+    RelaxedRegion(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure,
+                  int numThreads, int queuesPerThread = 2);
+    ~RelaxedRegion();
+    RelaxedRegion(const RelaxedRegion& rhs) = delete;
+    RelaxedRegion& operator=(const RelaxedRegion& rhs) = delete;
+    // Inserts into a random region. False (nothing inserted) if the crop has
+    // no valid priority. Safe to call from any number of threads.
+    bool insertCrop(const Crop& crop);
+    // Removes the better top crop of two random regions into crop; if that
+    // region is busy, or its top got worse than the other one's before the
+    // lock was taken, two others are drawn. False if every region was empty.
+    // Safe to call from any number of threads.
+    bool getNextCrop(Crop& crop);
+    int numQueues() const;
+    int numCrops() const;   // exact when no other thread is inside
+
+    private:
+    struct Queue{
+        Queue(prifn_t priFn, HEAPTYPE heapType, STRUCTURE structure);
+        Region m_region;
+        mutex m_lock;               // guards m_region, only ever tried
+        atomic<long long> m_top;    // key of the top crop, LLONG_MAX if empty; read without the lock
+    };
+
+    Queue ** m_queues;      // each allocated on its own
+    int m_numQueues;
+    atomic<int> m_size;     // crops in every region, changed under the lock of one
+
+    int pick() const;
+    Queue* nonEmpty(int from) const;
+};
+#endif
@@ -0,0 +1,229 @@
+// CMSC 341 - Fall 2025 - Project 3
+#include "sharded.h"
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// shard - an empty irrigator, its arena gets its first chunk from the worker
+ShardedIrrigator::Shard::Shard(int regions, SCHEDULE schedule)
+  : m_irrigator(regions + 1, schedule) {
+  m_busy = true;    // until the worker is set up
+  m_stop = false;
+  m_pinned = false;
+}
+
+// constructor - starts one worker per shard and waits until they are running
+ShardedIrrigator::ShardedIrrigator(int numShards, int regionsPerShard, SCHEDULE schedule,
+                                   bool pinThreads){
+  if (numShards <= 0 || regionsPerShard <= 0) {
+    throw invalid_argument("ShardedIrrigator needs at least one shard and one region per shard");
+  }
+  m_numShards = numShards;
+  m_regionsPerShard = regionsPerShard;
+  m_next = 0;
+  m_schedule = schedule;
+
+  m_shards = new Shard*[m_numShards];
+  for (int i = 0; i < m_numShards; i++) {
+    m_shards[i] = new Shard(m_regionsPerShard, m_schedule);
+  }
+  for (int i = 0; i < m_numShards; i++) {
+    m_shards[i]->m_worker = thread(&ShardedIrrigator::work, this, i, pinThreads);
+  }
+  flush();
+}
+
+// destructor - stops and joins every worker before its shard goes away
+ShardedIrrigator::~ShardedIrrigator(){
+  for (int i = 0; i < m_numShards; i++) {
+    Shard* shard = m_shards[i];
+    {
+      lock_guard<mutex> guard(shard->m_lock);
+      shard->m_stop = true;
+    }
+    shard->m_wake.notify_all();
+    shard->m_worker.join();
+    while (!shard->m_queue.empty()) {
+      delete shard->m_queue.front();
+      shard->m_queue.pop_front();
+    }
+    delete shard;
+  }
+  delete[] m_shards;
+}
+
+// addRegion - the copy is made here, the worker moves it into its shard
+bool ShardedIrrigator::addRegion(const Region & aRegion){
+  // the copy must not share nodes or an arena with the caller's regions,
+  // the worker frees its nodes on another thread
+  Region* copy = new Region(aRegion);
+  CropArena* arena = copy->m_arena;
+  copy->m_arena = nullptr;
+  if (copy->m_persistent) {
+    // pending subtrees are shared too, the rebuild is finished here so the
+    // worker never touches a reference count the caller can reach
+    copy->settle();
+    copy->m_persistent = false;
+    for (int i = 0; i < copy->numHeaps(); i++) {
+      copy->heapAt(i) = copy->ownTree(copy->heapAt(i));
+    }
+  }
+  if (arena != nullptr) {
+    copy->setArena(nullptr);
+  }
+
+  Shard* shard = m_shards[m_next];
+  m_next = (m_next + 1) % m_numShards;
+  {
+    lock_guard<mutex> guard(shard->m_lock);
+    int queued = (int)shard->m_queue.size() + (shard->m_busy ? 1 : 0);
+    if (shard->m_irrigator.m_size + queued >= m_regionsPerShard) {
+      delete copy;
+      return false;
+    }
+    shard->m_queue.push_back(copy);
+  }
+  shard->m_wake.notify_one();
+  return true;
+}
+
+// flush - waits for every queue to drain
+void ShardedIrrigator::flush(){
+  for (int i = 0; i < m_numShards; i++) {
+    Shard* shard = m_shards[i];
+    unique_lock<mutex> guard(shard->m_lock);
+    shard->m_idle.wait(guard, [shard]{ return shard->m_queue.empty() && !shard->m_busy; });
+  }
+}
+
+// getCrop - locks every shard (always in index order), finds the shard whose
+// top region is served first and takes the crop from it
+bool ShardedIrrigator::getCrop(Crop & aCrop){
+  vector<unique_lock<mutex> > guards;
+  guards.reserve(m_numShards);
+  for (int i = 0; i < m_numShards; i++) {
+    guards.push_back(unique_lock<mutex>(m_shards[i]->m_lock));
+  }
+
+  int best = -1;
+  const Region* bestTop = nullptr;
+  for (int i = 0; i < m_numShards; i++) {
+    const Region* top = m_shards[i]->m_irrigator.topRegion();
+    if (top != nullptr && (bestTop == nullptr || ahead(*top, *bestTop))) {
+      best = i;
+      bestTop = top;
+    }
+  }
+  if (best < 0) {
+    return false;
+  }
+  Irrigator& served = m_shards[best]->m_irrigator;
+  bool result = served.getCrop(aCrop);
+  if (m_schedule == FAIRSHARE) {
+    // one virtual time for all shards: a region arriving in an idle shard
+    // starts at the passes of the busy ones, not at that shard's old clock
+    for (int i = 0; i < m_numShards; i++) {
+      m_shards[i]->m_irrigator.m_virtualTime = served.m_virtualTime;
+    }
+  }
+  return result;
+}
+
+int ShardedIrrigator::numShards() const {
+  return m_numShards;
+}
+
+// numRegions - the regions of every shard, including those still queued
+int ShardedIrrigator::numRegions(){
+  int total = 0;
+  for (int i = 0; i < m_numShards; i++) {
+    Shard* shard = m_shards[i];
+    lock_guard<mutex> guard(shard->m_lock);
+    total += shard->m_irrigator.m_size + (int)shard->m_queue.size() + (shard->m_busy ? 1 : 0);
+  }
+  return total;
+}
+
+SCHEDULE ShardedIrrigator::getSchedule() const {
+  return m_schedule;
+}
+
+bool ShardedIrrigator::isPinned() const {
+  for (int i = 0; i < m_numShards; i++) {
+    Shard* shard = m_shards[i];
+    lock_guard<mutex> guard(shard->m_lock);
+    if (!shard->m_pinned) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/******************************************
+* Private function *
+******************************************/
+// the worker of one shard: pins itself, touches the arena's first chunk so it
+// is placed near its cores, then adds the queued regions until it is stopped
+void ShardedIrrigator::work(int index, bool pinThread){
+  Shard* shard = m_shards[index];
+  int cores = (int)thread::hardware_concurrency();
+  if (cores < 1) {
+    cores = 1;
+  }
+  int firstCore = (int)((long long)index * cores / m_numShards);
+  int lastCore = (int)((long long)(index + 1) * cores / m_numShards);
+  bool pinned = pinThread && pin(firstCore, (lastCore > firstCore) ? lastCore - firstCore : 1);
+
+  unique_lock<mutex> guard(shard->m_lock);
+  shard->m_pinned = pinned;
+  shard->m_arena.reserve(DEFAULTARENACHUNK);
+  while (true) {
+    shard->m_busy = false;
+    shard->m_idle.notify_all();
+    shard->m_wake.wait(guard, [shard]{ return shard->m_stop || !shard->m_queue.empty(); });
+    if (shard->m_stop) {
+      break;
+    }
+    Region* region = shard->m_queue.front();
+    shard->m_queue.pop_front();
+    shard->m_busy = true;
+
+    // the nodes are copied into the arena once, then moved into the heap slot
+    region->setArena(&shard->m_arena);
+    shard->m_irrigator.addRegion(move(*region));
+    delete region;
+  }
+}
+
+// ahead - true if region a of one shard is served before region b of another,
+// the shards' schedule decides and the top crop breaks its ties
+bool ShardedIrrigator::ahead(const Region & a, const Region & b) const {
+  const Irrigator& order = m_shards[0]->m_irrigator;
+  if (order.before(a, b)) {
+    return true;
+  }
+  if (order.before(b, a)) {
+    return false;
+  }
+  return a.topKey() < b.topKey();
+}
+
+// pin - binds the calling thread to numCores cores from firstCore on,
+// false where thread affinity is not available
+bool ShardedIrrigator::pin(int firstCore, int numCores){
+#ifdef __linux__
+  cpu_set_t cores;
+  CPU_ZERO(&cores);
+  for (int i = firstCore; i < firstCore + numCores; i++) {
+    CPU_SET(i, &cores);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores) == 0;
+#else
+  (void)firstCore;
+  (void)numCores;
+  return false;
+#endif
+}
@@ -0,0 +1,67 @@
+// CMSC 341 - Fall 2025 - Project 3
+// Sharded Irrigator: the regions are spread over several shards, each with
+// its own region heap, node arena and worker thread pinned to a group of
+// cores. getCrop merges the shards and returns the next crop of all of them.
+#ifndef SHARDED_H
+#define SHARDED_H
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "irrigator.h"
+#include "croparena.h"
+
+class ShardedIrrigator{
+    public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // for testing purposes
+    // Every shard holds up to regionsPerShard regions. With pinThreads the
+    // worker of shard i runs on cores [i*cores/numShards, (i+1)*cores/numShards),
+    // so on a NUMA machine its arena lives in that core group's memory.
+    // Throws invalid_argument if numShards or regionsPerShard is not positive.
+    ShardedIrrigator(int numShards, int regionsPerShard, SCHEDULE schedule = STRICT,
+                     bool pinThreads = true);
+    ~ShardedIrrigator();  // stops the workers, queued regions are dropped
+    ShardedIrrigator(const ShardedIrrigator& rhs) = delete;
+    ShardedIrrigator& operator=(const ShardedIrrigator& rhs) = delete;
+    // Queues a copy of the region for the next shard in turn, whose worker
+    // moves it into the shard's arena and heap. Returns false if that shard is full.
+    // A persistent region is copied deep, shards never share nodes.
+    bool addRegion(const Region & aRegion);
+    void flush();   // waits until the workers have added every queued region
+    // The next crop over all shards: the shard heaps are compared under their
+    // schedule (regPrior for STRICT, the top crop for GLOBAL, the pass for
+    // FAIRSHARE, against one virtual time kept by all shards) and the best
+    // one pops. Queued regions take part once added.
+    bool getCrop(Crop & aCrop);
+    int numShards() const;
+    int numRegions();       // regions in the shards and in their queues
+    SCHEDULE getSchedule() const;
+    bool isPinned() const;  // every worker runs on its core group
+
+    private:
+    struct Shard{
+        Shard(int regions, SCHEDULE schedule);
+        CropArena m_arena;          // nodes of every region in the shard, outlives the irrigator
+        Irrigator m_irrigator;
+        mutex m_lock;               // guards the irrigator, arena and queue
+        condition_variable m_wake;  // a region was queued or the shard stops
+        condition_variable m_idle;  // the queue became empty
+        deque<Region*> m_queue;     // copies waiting for the worker
+        bool m_busy;                // the worker is adding a region
+        bool m_stop;
+        bool m_pinned;
+        thread m_worker;
+    };
+
+    Shard ** m_shards;
+    int m_numShards;
+    int m_regionsPerShard;
+    int m_next;             // shard of the next addRegion
+    SCHEDULE m_schedule;
+
+    void work(int index, bool pinThread);
+    bool ahead(const Region & a, const Region & b) const;
+    static bool pin(int firstCore, int numCores);
+};
+#endif
@@ -0,0 +1,194 @@
+// CMSC 341 - Fall 2025 - Project 3
+#include "timerwheel.h"
+
+TimerWheel::TimerWheel(){
+  m_now = 0;
+  m_size = 0;
+  m_slots = nullptr;
+}
+
+TimerWheel::~TimerWheel(){
+  delete m_slots;
+}
+
+TimerWheel::TimerWheel(const TimerWheel& rhs){
+  m_now = rhs.m_now;
+  m_size = rhs.m_size;
+  m_slots = (rhs.m_slots != nullptr) ? new Slots(*rhs.m_slots) : nullptr;
+}
+
+TimerWheel& TimerWheel::operator=(const TimerWheel& rhs){
+  if (this != &rhs) {
+    Slots* slots = (rhs.m_slots != nullptr) ? new Slots(*rhs.m_slots) : nullptr;
+    delete m_slots;
+    m_slots = slots;
+    m_now = rhs.m_now;
+    m_size = rhs.m_size;
+  }
+  return *this;
+}
+
+bool TimerWheel::add(int deadline){
+  if (deadline <= m_now) {
+    return false;
+  }
+  if (m_slots == nullptr) {
+    m_slots = new Slots();
+  }
+  place(deadline);
+  return true;
+}
+
+void TimerWheel::cancel(int deadline){
+  if (deadline > m_now && m_slots != nullptr) {
+    m_slots->m_cancelled[deadline]++;
+  }
+}
+
+// advance - with H the highest byte where the clock and now differ, every
+// deadline below level H and those on level H before now's slot pass; the
+// slot now lands in is spread over the lower levels. Higher levels keep
+// their place, the clock and now agree above H.
+long long TimerWheel::advance(int now){
+  if (now <= m_now) {
+    return 0;
+  }
+  if (m_size == 0) {
+    m_now = now;
+    return 0;
+  }
+  int high = levelOf(now, m_now);
+  int fromSlot = (m_now >> (high * WHEELBITS)) & (WHEELSLOTS - 1);
+  int toSlot = (now >> (high * WHEELBITS)) & (WHEELSLOTS - 1);
+  long long fired = 0;
+  for (int level = 0; level < high; level++) {
+    for (int slot = 0; slot < WHEELSLOTS; slot++) {
+      fired += fireSlot(m_slots->m_slot[level][slot]);
+    }
+  }
+  for (int slot = fromSlot + 1; slot < toSlot; slot++) {
+    fired += fireSlot(m_slots->m_slot[high][slot]);
+  }
+
+  vector<int> landing;
+  landing.swap(m_slots->m_slot[high][toSlot]);
+  m_now = now;
+  m_size -= (long long)landing.size();
+  for (size_t i = 0; i < landing.size(); i++) {
+    if (landing[i] <= m_now) {
+      fired += fire(landing[i]);
+    }
+    else {
+      place(landing[i]);
+    }
+  }
+  return fired;
+}
+
+// take - the cancellations come along, they belong to other's deadlines
+long long TimerWheel::take(TimerWheel& other){
+  if (other.m_slots == nullptr || &other == this) {
+    return 0;
+  }
+  if (m_slots == nullptr) {
+    m_slots = new Slots();
+  }
+  unordered_map<int, int>& cancelled = other.m_slots->m_cancelled;
+  for (unordered_map<int, int>::iterator it = cancelled.begin(); it != cancelled.end(); ++it) {
+    m_slots->m_cancelled[it->first] += it->second;
+  }
+
+  long long fired = 0;
+  for (int level = 0; level < WHEELLEVELS; level++) {
+    for (int slot = 0; slot < WHEELSLOTS; slot++) {
+      vector<int>& deadlines = other.m_slots->m_slot[level][slot];
+      for (size_t i = 0; i < deadlines.size(); i++) {
+        if (deadlines[i] <= m_now) {
+          fired += fire(deadlines[i]);
+        }
+        else {
+          place(deadlines[i]);
+        }
+      }
+    }
+  }
+  other.clear();
+  return fired;
+}
+
+void TimerWheel::swap(TimerWheel& other){
+  int now = m_now;
+  long long size = m_size;
+  Slots* slots = m_slots;
+  m_now = other.m_now;
+  m_size = other.m_size;
+  m_slots = other.m_slots;
+  other.m_now = now;
+  other.m_size = size;
+  other.m_slots = slots;
+}
+
+void TimerWheel::clear(){
+  delete m_slots;
+  m_slots = nullptr;
+  m_size = 0;
+}
+
+void TimerWheel::reset(int now){
+  clear();
+  m_now = now;
+}
+
+int TimerWheel::now() const {
+  return m_now;
+}
+
+long long TimerWheel::size() const {
+  return m_size;
+}
+
+/******************************************
+* Private function *
+******************************************/
+// adds a deadline after the clock to the level of its highest differing byte
+void TimerWheel::place(int deadline){
+  int level = levelOf(deadline, m_now);
+  int slot = (deadline >> (level * WHEELBITS)) & (WHEELSLOTS - 1);
+  m_slots->m_slot[level][slot].push_back(deadline);
+  m_size++;
+}
+
+// a deadline that left the wheel: 1 if it passed, 0 if it was cancelled
+long long TimerWheel::fire(int deadline){
+  if (!m_slots->m_cancelled.empty()) {
+    unordered_map<int, int>::iterator it = m_slots->m_cancelled.find(deadline);
+    if (it != m_slots->m_cancelled.end()) {
+      if (--it->second == 0) {
+        m_slots->m_cancelled.erase(it);
+      }
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// fires every deadline of a slot, the slot keeps its memory for the next round
+long long TimerWheel::fireSlot(vector<int>& slot){
+  long long fired = 0;
+  for (size_t i = 0; i < slot.size(); i++) {
+    fired += fire(slot[i]);
+  }
+  m_size -= (long long)slot.size();
+  slot.clear();
+  return fired;
+}
+
+// level of the highest byte where deadline and now differ
+int TimerWheel::levelOf(int deadline, int now){
+  unsigned int differ = (unsigned int)deadline ^ (unsigned int)now;
+  int level = 0;
+  while (level < WHEELLEVELS - 1 && (differ >> ((level + 1) * WHEELBITS)) != 0) {
+    level++;
+  }
+  return level;
+}
@@ -0,0 +1,60 @@
+// CMSC 341 - Fall 2025 - Project 3
+// Hierarchical timer wheel over integer ticks. It keeps deadlines, not the
+// crops that carry them: advance() says how many deadlines passed, so a
+// Region counts its stale crops without looking for them in the heaps.
+// Four levels of 256 slots cover every non-negative int. A deadline sits on
+// the level of the highest byte where it differs from the clock and moves
+// down at most three levels before it fires, so add, cancel and each expiry
+// are amortized O(1); one advance() scans at most the slots it passes.
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+#include <vector>
+#include <unordered_map>
+using namespace std;
+
+#define WHEELLEVELS 4
+#define WHEELBITS 8
+#define WHEELSLOTS (1 << WHEELBITS)
+
+class TimerWheel{
+    public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // for testing purposes
+    TimerWheel();       // clock at tick 0, no deadlines
+    ~TimerWheel();
+    TimerWheel(const TimerWheel& rhs);
+    TimerWheel& operator=(const TimerWheel& rhs);
+    // Adds a deadline after the clock. False (nothing added) if it already passed.
+    bool add(int deadline);
+    // Withdraws a deadline that was added and has not passed yet; it is
+    // skipped when the clock gets there
+    void cancel(int deadline);
+    // Moves the clock forward to now (never back). Returns the number of
+    // deadlines that passed, cancelled ones are not counted.
+    long long advance(int now);
+    // Moves every deadline of other here and empties other. Returns the
+    // number that already passed on this clock.
+    long long take(TimerWheel& other);
+    void swap(TimerWheel& other);   // exchanges clocks and deadlines, O(1)
+    void clear();           // drops every deadline, the clock stays
+    void reset(int now);    // drops every deadline and sets the clock
+    int now() const;
+    long long size() const; // deadlines waiting, cancelled ones until they are skipped
+
+    private:
+    // the slots are allocated with the first deadline, an idle wheel is small
+    struct Slots{
+        vector<int> m_slot[WHEELLEVELS][WHEELSLOTS];
+        unordered_map<int, int> m_cancelled;    // deadline -> withdrawn count
+    };
+
+    int m_now;
+    long long m_size;
+    Slots * m_slots;
+
+    void place(int deadline);
+    long long fire(int deadline);
+    long long fireSlot(vector<int>& slot);
+    static int levelOf(int deadline, int now);
+};
+#endif
@@ -0,0 +1,300 @@
+// CMSC 341 - Fall 2025 - Project 3
+#include "tracing.h"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+// constructor - every bucket starts empty
+LatencyHistogram::LatencyHistogram(){
+  clear();
+}
+
+// copy constructor - copies a consistent-enough view of the counters
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& rhs){
+  clear();
+  add(rhs);
+}
+
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& rhs){
+  if (this != &rhs) {
+    clear();
+    add(rhs);
+  }
+  return *this;
+}
+
+// record - adds one value, negative values count as 0
+void LatencyHistogram::record(long long value){
+  if (value < 0) {
+    value = 0;
+  }
+  int bucket = bucketOf(value);
+  m_buckets[bucket].store(m_buckets[bucket].load(memory_order_relaxed) + 1, memory_order_relaxed);
+  m_count.store(m_count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+  m_sum.store(m_sum.load(memory_order_relaxed) + value, memory_order_relaxed);
+  if (value > m_max.load(memory_order_relaxed)) {
+    m_max.store(value, memory_order_relaxed);
+  }
+}
+
+// add - merges the counters of rhs into this histogram
+void LatencyHistogram::add(const LatencyHistogram& rhs){
+  for (int i = 0; i < NUMBUCKETS; i++) {
+    long long count = rhs.m_buckets[i].load(memory_order_relaxed);
+    if (count != 0) {
+      m_buckets[i].fetch_add(count, memory_order_relaxed);
+    }
+  }
+  m_count.fetch_add(rhs.m_count.load(memory_order_relaxed), memory_order_relaxed);
+  m_sum.fetch_add(rhs.m_sum.load(memory_order_relaxed), memory_order_relaxed);
+  long long max = rhs.m_max.load(memory_order_relaxed);
+  if (max > m_max.load(memory_order_relaxed)) {
+    m_max.store(max, memory_order_relaxed);
+  }
+}
+
+void LatencyHistogram::clear(){
+  for (int i = 0; i < NUMBUCKETS; i++) {
+    m_buckets[i].store(0, memory_order_relaxed);
+  }
+  m_count.store(0, memory_order_relaxed);
+  m_sum.store(0, memory_order_relaxed);
+  m_max.store(0, memory_order_relaxed);
+}
+
+long long LatencyHistogram::count() const {
+  return m_count.load(memory_order_relaxed);
+}
+
+long long LatencyHistogram::maxValue() const {
+  return m_max.load(memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const {
+  long long count = m_count.load(memory_order_relaxed);
+  return (count == 0) ? 0.0 : (double)m_sum.load(memory_order_relaxed) / count;
+}
+
+// percentile - walks the buckets until p percent of the values are covered
+long long LatencyHistogram::percentile(double p) const {
+  long long count = m_count.load(memory_order_relaxed);
+  if (count == 0) {
+    return 0;
+  }
+  if (p < 0.0) p = 0.0;
+  if (p > 100.0) p = 100.0;
+
+  // the rank of the value we are looking for, at least the first value
+  long long rank = (long long)((p / 100.0) * count + 0.5);
+  if (rank < 1) {
+    rank = 1;
+  }
+
+  long long seen = 0;
+  long long max = m_max.load(memory_order_relaxed);
+  for (int i = 0; i < NUMBUCKETS; i++) {
+    seen += m_buckets[i].load(memory_order_relaxed);
+    if (seen >= rank) {
+      long long high = bucketHigh(i);
+      return (high < max) ? high : max;
+    }
+  }
+  return max;
+}
+
+// bucketOf - small values get a bucket each, larger ones share a power of two
+// between SUBBUCKETS linear sub-buckets
+int LatencyHistogram::bucketOf(long long value){
+  if (value < SUBBUCKETS) {
+    return (int)value;
+  }
+  int exponent = 63 - __builtin_clzll((unsigned long long)value);
+  int shift = exponent - SUBBUCKETBITS;
+  int sub = (int)((value >> shift) & (SUBBUCKETS - 1));
+  return (shift + 1) * SUBBUCKETS + sub;
+}
+
+long long LatencyHistogram::bucketLow(int bucket){
+  if (bucket < SUBBUCKETS) {
+    return bucket;
+  }
+  int shift = bucket / SUBBUCKETS - 1;
+  int sub = bucket % SUBBUCKETS;
+  return (long long)(SUBBUCKETS + sub) << shift;
+}
+
+long long LatencyHistogram::bucketHigh(int bucket){
+  if (bucket < SUBBUCKETS) {
+    return bucket;
+  }
+  int shift = bucket / SUBBUCKETS - 1;
+  return bucketLow(bucket) + (1LL << shift) - 1;
+}
+
+//////////////////////////////////////////////////////////////
+
+// every thread records into its own set of histograms, the registry is only
+// locked when a thread records for the first time, exits, or a reader merges
+struct ThreadTrace{
+  LatencyHistogram points[NUMTRACEPOINTS];
+};
+
+static atomic<bool> s_enabled(false);
+
+static mutex& registryLock(){
+  static mutex lock;
+  return lock;
+}
+
+static vector<ThreadTrace*>& registry(){
+  static vector<ThreadTrace*> threads;
+  return threads;
+}
+
+// histograms of threads that have exited
+static LatencyHistogram* retired(){
+  static LatencyHistogram histograms[NUMTRACEPOINTS];
+  return histograms;
+}
+
+// registers the thread's histograms on first use and retires them on thread exit
+class ThreadTraceOwner{
+  public:
+  ThreadTraceOwner(){
+    m_trace = new ThreadTrace;
+    lock_guard<mutex> guard(registryLock());
+    registry().push_back(m_trace);
+  }
+  ~ThreadTraceOwner(){
+    lock_guard<mutex> guard(registryLock());
+    vector<ThreadTrace*>& threads = registry();
+    for (size_t i = 0; i < threads.size(); i++) {
+      if (threads[i] == m_trace) {
+        threads[i] = threads.back();
+        threads.pop_back();
+        break;
+      }
+    }
+    for (int i = 0; i < NUMTRACEPOINTS; i++) {
+      retired()[i].add(m_trace->points[i]);
+    }
+    delete m_trace;
+  }
+  ThreadTrace* m_trace;
+};
+
+static ThreadTrace* threadTrace(){
+  static thread_local ThreadTraceOwner owner;
+  return owner.m_trace;
+}
+
+static long long nowNs(){
+  return chrono::duration_cast<chrono::nanoseconds>(
+    chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::enable(bool on){
+  s_enabled.store(on, memory_order_relaxed);
+}
+
+bool Tracer::enabled(){
+  return s_enabled.load(memory_order_relaxed);
+}
+
+void Tracer::record(TRACEPOINT point, long long ns){
+  if (point < 0 || point >= NUMTRACEPOINTS) {
+    return;
+  }
+  threadTrace()->points[point].record(ns);
+}
+
+// histogram - merges the live threads and the retired ones
+LatencyHistogram Tracer::histogram(TRACEPOINT point){
+  LatencyHistogram result;
+  if (point < 0 || point >= NUMTRACEPOINTS) {
+    return result;
+  }
+  lock_guard<mutex> guard(registryLock());
+  vector<ThreadTrace*>& threads = registry();
+  for (size_t i = 0; i < threads.size(); i++) {
+    result.add(threads[i]->points[point]);
+  }
+  result.add(retired()[point]);
+  return result;
+}
+
+long long Tracer::percentile(TRACEPOINT point, double p){
+  return histogram(point).percentile(p);
+}
+
+const char* Tracer::name(TRACEPOINT point){
+  switch (point) {
+  case TRACEGETCROP: return "Irrigator::getCrop";
+  case TRACEADDREGION: return "Irrigator::addRegion";
+  case TRACEGETREGION: return "Irrigator::getRegion";
+  case TRACEINSERTCROP: return "Region::insertCrop";
+  case TRACENEXTCROP: return "Region::getNextCrop";
+  default: return "UNKNOWN";
+  }
+}
+
+// dump - one summary line per point, then the buckets, all in nanoseconds
+bool Tracer::dump(const char* path){
+  FILE* out = fopen(path, "w");
+  if (out == nullptr) {
+    return false;
+  }
+
+  fprintf(out, "point,count,mean_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n");
+  LatencyHistogram merged[NUMTRACEPOINTS];
+  for (int i = 0; i < NUMTRACEPOINTS; i++) {
+    merged[i] = histogram((TRACEPOINT)i);
+    const LatencyHistogram& h = merged[i];
+    fprintf(out, "%s,%lld,%.1f,%lld,%lld,%lld,%lld,%lld\n", name((TRACEPOINT)i), h.count(),
+            h.mean(), h.percentile(50), h.percentile(90), h.percentile(99),
+            h.percentile(99.9), h.maxValue());
+  }
+
+  fprintf(out, "\npoint,low_ns,high_ns,count\n");
+  for (int i = 0; i < NUMTRACEPOINTS; i++) {
+    for (int b = 0; b < NUMBUCKETS; b++) {
+      long long count = merged[i].m_buckets[b].load(memory_order_relaxed);
+      if (count != 0) {
+        fprintf(out, "%s,%lld,%lld,%lld\n", name((TRACEPOINT)i), LatencyHistogram::bucketLow(b),
+                LatencyHistogram::bucketHigh(b), count);
+      }
+    }
+  }
+
+  bool ok = ferror(out) == 0;
+  fclose(out);
+  return ok;
+}
+
+// reset - meant for quiet periods, a value recorded concurrently may be lost
+void Tracer::reset(){
+  lock_guard<mutex> guard(registryLock());
+  vector<ThreadTrace*>& threads = registry();
+  for (size_t i = 0; i < threads.size(); i++) {
+    for (int p = 0; p < NUMTRACEPOINTS; p++) {
+      threads[i]->points[p].clear();
+    }
+  }
+  for (int p = 0; p < NUMTRACEPOINTS; p++) {
+    retired()[p].clear();
+  }
+}
+
+//////////////////////////////////////////////////////////////
+
+TraceScope::TraceScope(TRACEPOINT point){
+  m_point = point;
+  m_start = Tracer::enabled() ? nowNs() : 0;
+}
+
+TraceScope::~TraceScope(){
+  if (m_start != 0) {
+    Tracer::record(m_point, nowNs() - m_start);
+  }
+}
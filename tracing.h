@@ -0,0 +1,83 @@
+// CMSC 341 - Fall 2025 - Project 3
+// Opt-in latency tracing. Built with -DIRRIGATOR_TRACE, the Irrigator and
+// Region hot paths time every call into per-thread log-bucket histograms;
+// readers merge the histograms of all threads. Recording takes no locks.
+#ifndef TRACING_H
+#define TRACING_H
+#include <atomic>
+#include "irrigator.h"
+
+// traced operations
+enum TRACEPOINT {TRACEGETCROP, TRACEADDREGION, TRACEGETREGION, TRACEINSERTCROP,
+                 TRACENEXTCROP, NUMTRACEPOINTS};
+
+// HDR-style buckets: every power of two is split into 2^SUBBUCKETBITS linear
+// sub-buckets, so a value is known to within about 6%
+#define SUBBUCKETBITS 4
+const int SUBBUCKETS = 1 << SUBBUCKETBITS;
+const int NUMBUCKETS = (64 - SUBBUCKETBITS + 1) * SUBBUCKETS;
+
+class LatencyHistogram{
+    public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // for testing purposes
+    friend class Tracer;
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram& rhs);
+    LatencyHistogram& operator=(const LatencyHistogram& rhs);
+    // Only the owning thread records, so plain relaxed stores are enough
+    // and a concurrent reader sees every counter whole.
+    void record(long long value);
+    void add(const LatencyHistogram& rhs);  // merges rhs into this histogram
+    void clear();
+    long long count() const;
+    long long maxValue() const;
+    double mean() const;
+    // The highest value of the bucket holding the p-th percentile (0-100),
+    // capped by the largest recorded value
+    long long percentile(double p) const;
+    static int bucketOf(long long value);
+    static long long bucketLow(int bucket);
+    static long long bucketHigh(int bucket);
+
+    private:
+    atomic<long long> m_buckets[NUMBUCKETS];
+    atomic<long long> m_count;
+    atomic<long long> m_sum;
+    atomic<long long> m_max;
+};
+
+class Tracer{
+    public:
+    friend class Grader; // for grading purposes
+    friend class Tester; // for testing purposes
+    static void enable(bool on);  // tracing starts disabled
+    static bool enabled();
+    // records a latency (ns) in the calling thread's histogram
+    static void record(TRACEPOINT point, long long ns);
+    // merged histogram of every thread, including threads that have exited
+    static LatencyHistogram histogram(TRACEPOINT point);
+    static long long percentile(TRACEPOINT point, double p);
+    static const char* name(TRACEPOINT point);
+    // writes count, mean, p50, p90, p99, p999 and max of every point,
+    // followed by the non-empty buckets. Returns false if the file cannot be written.
+    static bool dump(const char* path);
+    static void reset();  // clears every thread's histograms
+};
+
+// times its own lifetime when tracing is enabled
+class TraceScope{
+    public:
+    explicit TraceScope(TRACEPOINT point);
+    ~TraceScope();
+    private:
+    TRACEPOINT m_point;
+    long long m_start;    // 0 when tracing was disabled at construction
+};
+
+#ifdef IRRIGATOR_TRACE
+#define TRACE_SCOPE(point) TraceScope traceScope(point)
+#else
+#define TRACE_SCOPE(point)
+#endif
+#endif